@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#include "base/debug/forensic_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <sstream>
+
+#include "base/bind.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/memory/singleton.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/time/time.h"
+
+#if defined(OS_ANDROID)
+#include <android/log.h>
+#endif
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// Per-process buffer between the logging threads and the drain thread.
+const uint32_t kLocalRingCapacity = 256 * 1024;
+const int kDrainIntervalMs = 50;
+
+const uint32_t kWrapMarker = 0xffffffff;
+
+uint32_t AlignRecord(uint32_t length) {
+  return (length + 3) & ~3u;
+}
+
+}  // namespace
+
+// Each index sits on its own cache line so the two sides do not contend. The
+// offsets only grow and are masked on use.
+struct ForensicLogRing::Header {
+  subtle::Atomic32 write_offset;
+  char write_padding[64 - sizeof(subtle::Atomic32)];
+  subtle::Atomic32 read_offset;
+  char read_padding[64 - sizeof(subtle::Atomic32)];
+  subtle::Atomic32 dropped;
+  uint32_t capacity;
+};
+
+// static
+size_t ForensicLogRing::RequiredSize(uint32_t capacity) {
+  return sizeof(Header) + capacity;
+}
+
+ForensicLogRing::ForensicLogRing(void* memory, size_t size)
+    : header_(static_cast<Header*>(memory)),
+      data_(static_cast<char*>(memory) + sizeof(Header)),
+      capacity_(static_cast<uint32_t>(size - sizeof(Header))),
+      read_(0),
+      corrupt_(false) {
+  DCHECK_GT(size, sizeof(Header));
+  DCHECK_EQ(0u, capacity_ & (capacity_ - 1));
+}
+
+void ForensicLogRing::Initialize() {
+  memset(header_, 0, sizeof(Header));
+  header_->capacity = capacity_;
+}
+
+bool ForensicLogRing::Write(const char* data, size_t length) {
+  // Records must leave room for a wrap marker, so a quarter of the ring is
+  // plenty for one line.
+  if (length > capacity_ / 4) {
+    subtle::NoBarrier_AtomicIncrement(&header_->dropped, 1);
+    return false;
+  }
+  uint32_t write =
+      static_cast<uint32_t>(subtle::NoBarrier_Load(&header_->write_offset));
+  uint32_t read =
+      static_cast<uint32_t>(subtle::Acquire_Load(&header_->read_offset));
+  uint32_t index = write & (capacity_ - 1);
+  uint32_t record_size = sizeof(uint32_t) + AlignRecord(length);
+  uint32_t padding = index + record_size > capacity_ ? capacity_ - index : 0;
+  if (capacity_ - (write - read) < padding + record_size) {
+    subtle::NoBarrier_AtomicIncrement(&header_->dropped, 1);
+    return false;
+  }
+
+  if (padding) {
+    memcpy(data_ + index, &kWrapMarker, sizeof(kWrapMarker));
+    write += padding;
+    index = 0;
+  }
+  uint32_t length32 = static_cast<uint32_t>(length);
+  memcpy(data_ + index, &length32, sizeof(length32));
+  memcpy(data_ + index + sizeof(length32), data, length);
+  subtle::Release_Store(&header_->write_offset,
+                        static_cast<subtle::Atomic32>(write + record_size));
+  return true;
+}
+
+bool ForensicLogRing::ReadAll(std::string* out) {
+  if (corrupt_)
+    return false;
+  // The other side of a shared ring is another process that can write the
+  // header and the records at any time, so |write| is loaded once and every
+  // length is checked against the ring before it is used. Each record moves
+  // |read| forward without passing |write|, so this reads at most
+  // |capacity_| bytes.
+  uint32_t write =
+      static_cast<uint32_t>(subtle::Acquire_Load(&header_->write_offset));
+  uint32_t read = read_;
+  if (write - read > capacity_ || write & 3) {
+    corrupt_ = true;
+    return false;
+  }
+  while (read != write) {
+    uint32_t index = read & (capacity_ - 1);
+    uint32_t length;
+    if (index & 3 || index + sizeof(length) > capacity_) {
+      corrupt_ = true;
+      break;
+    }
+    memcpy(&length, data_ + index, sizeof(length));
+    uint32_t step;
+    if (length == kWrapMarker) {
+      // Only a record that does not fit before the end wraps.
+      step = capacity_ - index;
+      if (!index) {
+        corrupt_ = true;
+        break;
+      }
+    } else {
+      if (length > capacity_ - index - sizeof(length)) {
+        corrupt_ = true;
+        break;
+      }
+      step = sizeof(length) + AlignRecord(length);
+    }
+    if (step > write - read) {
+      corrupt_ = true;
+      break;
+    }
+    if (length != kWrapMarker) {
+      out->append(data_ + index + sizeof(length), length);
+      out->push_back('\n');
+    }
+    read += step;
+  }
+  read_ = read;
+  subtle::Release_Store(&header_->read_offset,
+                        static_cast<subtle::Atomic32>(read));
+  return !corrupt_;
+}
+
+int ForensicLogRing::TakeDropped() {
+  return subtle::NoBarrier_AtomicExchange(&header_->dropped, 0);
+}
+
+// static
+ForensicLogSink* ForensicLogSink::GetInstance() {
+  return Singleton<ForensicLogSink,
+                   LeakySingletonTraits<ForensicLogSink>>::get();
+}
+
+ForensicLogSink::ForensicLogSink()
+    : drain_thread_("ForensicLog"),
+      local_memory_(ForensicLogRing::RequiredSize(kLocalRingCapacity)) {
+  local_ring_.reset(
+      new ForensicLogRing(local_memory_.data(), local_memory_.size()));
+  local_ring_->Initialize();
+  drain_thread_.Start();
+  drain_thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, Bind(&ForensicLogSink::DrainAndReschedule, Unretained(this)),
+      TimeDelta::FromMilliseconds(kDrainIntervalMs));
+}
+
+ForensicLogSink::~ForensicLogSink() {
+  // Leaky; never destroyed.
+  NOTREACHED();
+}
+
+void ForensicLogSink::Write(ForensicLogCategory category,
+                            const char* line,
+                            size_t length) {
+  AutoLock lock(write_lock_);
+  local_ring_->Write(line, length);
+}
+
+void ForensicLogSink::AttachSharedRing(scoped_ptr<SharedMemory> memory,
+                                       size_t size) {
+  if (!memory->Map(size)) {
+    WriteForensicLog(FORENSIC_LOG_CATEGORY_DEBUG,
+                     "ForensicLogSink:: Could not map the shared log ring",
+                     false);
+    return;
+  }
+  AutoLock lock(sources_lock_);
+  shared_ring_.reset(new ForensicLogRing(memory->memory(), size));
+  shared_memory_ = std::move(memory);
+}
+
+void ForensicLogSink::AddSource(ForensicLogRing* ring,
+                                const std::string& prefix) {
+  AutoLock lock(sources_lock_);
+  Source source = {ring, prefix};
+  sources_.push_back(source);
+}
+
+void ForensicLogSink::RemoveSource(ForensicLogRing* ring) {
+  AutoLock lock(sources_lock_);
+  for (auto it = sources_.begin(); it != sources_.end(); ++it) {
+    if (it->ring != ring)
+      continue;
+    std::string lines;
+    if (!ring->ReadAll(&lines))
+      lines += "ForensicLogSink:: Corrupt log ring, lines lost\n";
+    for (size_t start = 0; start < lines.size();) {
+      size_t end = lines.find('\n', start);
+      removed_lines_ += it->prefix;
+      removed_lines_.append(lines, start, end + 1 - start);
+      start = end + 1;
+    }
+    sources_.erase(it);
+    return;
+  }
+}
+
+void ForensicLogSink::Flush() {
+  drain_thread_.task_runner()->PostTask(
+      FROM_HERE, Bind(&ForensicLogSink::Drain, Unretained(this)));
+}
+
+void ForensicLogSink::FlushForTesting() {
+  WaitableEvent drained(false, false);
+  Flush();
+  drain_thread_.task_runner()->PostTask(
+      FROM_HERE, Bind(&WaitableEvent::Signal, Unretained(&drained)));
+  drained.Wait();
+}
+
+bool ForensicLogSink::HasSourceForTesting(ForensicLogRing* ring) {
+  AutoLock lock(sources_lock_);
+  for (const Source& source : sources_) {
+    if (source.ring == ring)
+      return true;
+  }
+  return false;
+}
+
+void ForensicLogSink::DrainAndReschedule() {
+  Drain();
+  drain_thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, Bind(&ForensicLogSink::DrainAndReschedule, Unretained(this)),
+      TimeDelta::FromMilliseconds(kDrainIntervalMs));
+}
+
+void ForensicLogSink::Drain() {
+  std::string lines;
+  local_ring_->ReadAll(&lines);
+  int dropped = local_ring_->TakeDropped();
+  if (dropped) {
+    std::ostringstream ss;
+    ss << "ForensicLogSink:: Dropped lines: " << dropped << "\n";
+    lines += ss.str();
+  }
+
+  AutoLock lock(sources_lock_);
+  if (shared_ring_) {
+    // Lines the browser has no room for yet are dropped and counted in the
+    // shared ring, which the browser reports.
+    for (size_t start = 0; start < lines.size();) {
+      size_t end = lines.find('\n', start);
+      shared_ring_->Write(lines.data() + start, end - start);
+      start = end + 1;
+    }
+    return;
+  }
+
+  std::string output;
+  output.swap(removed_lines_);
+  for (auto it = sources_.begin(); it != sources_.end();) {
+    const Source& source = *it;
+    std::string source_lines;
+    bool consistent = source.ring->ReadAll(&source_lines);
+    int source_dropped = source.ring->TakeDropped();
+    if (source_dropped) {
+      std::ostringstream ss;
+      ss << "ForensicLogSink:: Dropped lines: " << source_dropped << "\n";
+      source_lines += ss.str();
+    }
+    for (size_t start = 0; start < source_lines.size();) {
+      size_t end = source_lines.find('\n', start);
+      output += source.prefix;
+      output.append(source_lines, start, end + 1 - start);
+      start = end + 1;
+    }
+    if (consistent) {
+      ++it;
+      continue;
+    }
+    // A renderer that breaks its ring is not read again.
+    output += source.prefix;
+    output += "ForensicLogSink:: Corrupt log ring, no longer read\n";
+    it = sources_.erase(it);
+  }
+  output += lines;
+  Output(output);
+}
+
+void ForensicLogSink::Output(const std::string& lines) {
+  if (lines.empty())
+    return;
+  fwrite(lines.data(), 1, lines.size(), stderr);
+#if defined(OS_ANDROID)
+  __android_log_write(ANDROID_LOG_WARN, "Forensics", lines.c_str());
+#endif
+}
+
+ForensicLogMessage::ForensicLogMessage(ForensicLogCategory category)
+    : category_(category) {}
+
+ForensicLogMessage::~ForensicLogMessage() {
+  stream_ << ",\tTime: " << TimeTicks::Now().ToInternalValue();
+  const std::string line = stream_.str();
+  ForensicLogSink::GetInstance()->Write(category_, line.data(), line.size());
+}
+
+void WriteForensicLog(ForensicLogCategory category,
+                      const std::string& line,
+                      bool add_time) {
+  if (!add_time) {
+    ForensicLogSink::GetInstance()->Write(category, line.data(), line.size());
+    return;
+  }
+  std::string timed_line =
+      line + ",\tTime: " + Int64ToString(TimeTicks::Now().ToInternalValue());
+  ForensicLogSink::GetInstance()->Write(category, timed_line.data(),
+                                        timed_line.size());
+}
+
+uint64_t ForensicFlowId(const SnapshotToken& event_id, int snapshot_id) {
+  // Snapshot IDs are only unique within a tab, the event ID names the tab.
+  const uint64_t fields[] = {event_id.site_id,
+                             static_cast<uint64_t>(event_id.trace_id),
+                             static_cast<uint64_t>(event_id.url_id)};
+  return (static_cast<uint64_t>(
+              Hash(reinterpret_cast<const char*>(fields), sizeof(fields)))
+          << 32) |
+         static_cast<uint32_t>(snapshot_id);
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef BASE_DEBUG_FORENSIC_LOG_H_
+#define BASE_DEBUG_FORENSIC_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/debug/snapshot_token.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+
+// ChromePic forensic logging, shared by cc, content and Blink.
+//
+//   FORENSIC_LOG(SNAPSHOT) << "SnapshotHandler:: ..., Event ID: " << event_id;
+//
+// Every process has one ForensicLogSink. Logging a line formats it on the
+// calling thread and copies it into the sink's ring under a lock; a "ForensicLog"
+// thread drains the ring every 50ms. The browser writes the lines to stderr
+// (and the Android log). A child process that has been handed a shared-memory
+// ring by the browser forwards its lines there instead, and the browser writes
+// them out, prefixed with the child's process ID, so the output of all
+// processes comes from one writer and never interleaves mid-line.
+//
+// Categories not in FORENSIC_LOG_ENABLED_CATEGORIES compile to nothing. DEBUG
+// is left out of official builds.
+
+namespace base {
+namespace debug {
+
+enum ForensicLogCategory {
+  // Snapshot pipeline milestones: events, screenshots, DOM snapshots.
+  FORENSIC_LOG_CATEGORY_SNAPSHOT = 1 << 0,
+  // Input routing and latency.
+  FORENSIC_LOG_CATEGORY_INPUT = 1 << 1,
+  // Compositor and GPU readback.
+  FORENSIC_LOG_CATEGORY_COMPOSITOR = 1 << 2,
+  // Tracing of code paths, "DEBUG ..." lines.
+  FORENSIC_LOG_CATEGORY_DEBUG = 1 << 3,
+};
+
+}  // namespace debug
+}  // namespace base
+
+#if !defined(FORENSIC_LOG_ENABLED_CATEGORIES)
+#if defined(OFFICIAL_BUILD)
+#define FORENSIC_LOG_ENABLED_CATEGORIES \
+  (~::base::debug::FORENSIC_LOG_CATEGORY_DEBUG)
+#else
+#define FORENSIC_LOG_ENABLED_CATEGORIES (~0)
+#endif
+#endif
+
+#define FORENSIC_LOG_IS_ENABLED(category)   \
+  ((FORENSIC_LOG_ENABLED_CATEGORIES) &      \
+   ::base::debug::FORENSIC_LOG_CATEGORY_##category)
+
+// The condition is a compile-time constant, so for a disabled category the
+// stream expression, including its arguments, is dropped.
+#define FORENSIC_LOG(category)                                     \
+  !FORENSIC_LOG_IS_ENABLED(category)                               \
+      ? (void)0                                                    \
+      : ::base::debug::ForensicLogMessageVoidify() &               \
+            ::base::debug::ForensicLogMessage(                     \
+                ::base::debug::FORENSIC_LOG_CATEGORY_##category)   \
+                .stream()
+
+namespace base {
+
+template <typename Type>
+struct DefaultSingletonTraits;
+
+namespace debug {
+
+// Single-producer single-consumer ring of text records in caller-provided
+// memory, which may be shared between processes. Records are a uint32 length
+// followed by the bytes, 4-byte aligned; one that does not fit before the end
+// is preceded by a wrap marker and starts over at offset 0.
+class BASE_EXPORT ForensicLogRing {
+ public:
+  // Bytes needed for a ring with |capacity| bytes of records. |capacity| must
+  // be a power of two.
+  static size_t RequiredSize(uint32_t capacity);
+
+  // |memory| must stay valid for the lifetime of the ring.
+  ForensicLogRing(void* memory, size_t size);
+
+  // Formats the memory. Called once, by whoever created it.
+  void Initialize();
+
+  // Producer. Returns false, and counts the record as dropped, if it does not
+  // fit.
+  bool Write(const char* data, size_t length);
+
+  // Consumer. Appends every complete record to |out|. The producer may be
+  // another, untrusted process: returns false, and reads nothing from then
+  // on, once the ring is found inconsistent.
+  bool ReadAll(std::string* out);
+
+  // Consumer. Records dropped since the last call.
+  int TakeDropped();
+
+ private:
+  struct Header;
+
+  Header* header_;
+  char* data_;
+  uint32_t capacity_;
+  // The consumer's own read offset; the one in the header is only published
+  // for the producer, which may overwrite it.
+  uint32_t read_;
+  bool corrupt_;
+
+  DISALLOW_COPY_AND_ASSIGN(ForensicLogRing);
+};
+
+class BASE_EXPORT ForensicLogSink {
+ public:
+  static ForensicLogSink* GetInstance();
+
+  // Appends one line. |line| should not end in a newline.
+  void Write(ForensicLogCategory category, const char* line, size_t length);
+
+  // Child processes: from now on forward lines to the ring in |memory|, which
+  // the browser reads.
+  void AttachSharedRing(scoped_ptr<SharedMemory> memory, size_t size);
+
+  // Browser: also drain |ring|, filled by another process, writing its lines
+  // with |prefix|. RemoveSource() reads |ring| one last time; the caller may
+  // free it afterwards.
+  void AddSource(ForensicLogRing* ring, const std::string& prefix);
+  void RemoveSource(ForensicLogRing* ring);
+
+  // Drains without waiting for the next 50ms tick.
+  void Flush();
+
+  // Drains, and returns once the drain is done.
+  void FlushForTesting();
+
+  // Whether |ring| is still drained.
+  bool HasSourceForTesting(ForensicLogRing* ring);
+
+ private:
+  friend struct DefaultSingletonTraits<ForensicLogSink>;
+
+  struct Source {
+    ForensicLogRing* ring;
+    std::string prefix;
+  };
+
+  ForensicLogSink();
+  ~ForensicLogSink();
+
+  void DrainAndReschedule();
+  void Drain();
+  void Output(const std::string& lines);
+
+  Thread drain_thread_;
+
+  // Guards |local_ring_| for the producers; the drain thread is its only
+  // consumer.
+  Lock write_lock_;
+  std::vector<char> local_memory_;
+  scoped_ptr<ForensicLogRing> local_ring_;
+
+  // Guards everything below.
+  Lock sources_lock_;
+  std::vector<Source> sources_;
+  // Lines of removed sources, written on the next drain.
+  std::string removed_lines_;
+  scoped_ptr<SharedMemory> shared_memory_;
+  scoped_ptr<ForensicLogRing> shared_ring_;
+
+  DISALLOW_COPY_AND_ASSIGN(ForensicLogSink);
+};
+
+// Formats one line, timestamped like Logger::LogLineScreen, and hands it to
+// the sink when destroyed.
+class BASE_EXPORT ForensicLogMessage {
+ public:
+  explicit ForensicLogMessage(ForensicLogCategory category);
+  ~ForensicLogMessage();
+
+  std::ostream& stream() { return stream_; }
+
+ private:
+  ForensicLogCategory category_;
+  std::ostringstream stream_;
+
+  DISALLOW_COPY_AND_ASSIGN(ForensicLogMessage);
+};
+
+// Lets FORENSIC_LOG() be used as a statement in both branches of ?:.
+class ForensicLogMessageVoidify {
+ public:
+  ForensicLogMessageVoidify() {}
+  void operator&(std::ostream&) {}
+};
+
+// For callers that already have the whole line, e.g. Logger::LogLineScreen.
+BASE_EXPORT void WriteForensicLog(ForensicLogCategory category,
+                                  const std::string& line,
+                                  bool add_time);
+
+// Flow ID of a snapshot's "forensics" trace events. Every process that
+// handles the snapshot has its snapshot token and snapshot ID, so the events
+// of browser, renderer and GPU join up into one flow:
+//
+//   TRACE_EVENT_WITH_FLOW1("forensics", "RenderWidget::TakeDOMSnapshot",
+//                          ForensicFlowId(event_id, snapshot_id),
+//                          TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+//                          "snapshot_id", snapshot_id);
+//
+// The trace macros only evaluate the ID when the category is enabled.
+BASE_EXPORT uint64_t ForensicFlowId(const SnapshotToken& event_id,
+                                    int snapshot_id);
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_FORENSIC_LOG_H_
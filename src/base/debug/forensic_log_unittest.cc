@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#include "base/debug/forensic_log.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const uint32_t kCapacity = 256;
+const uint32_t kWrapMarker = 0xffffffff;
+
+// Lines of this length take 56 bytes of the ring, so four fit before the end
+// and the fifth wraps.
+const size_t kLineLength = 50;
+
+std::string Line(char c) {
+  return std::string(kLineLength, c);
+}
+
+class ForensicLogRingTest : public testing::Test {
+ protected:
+  ForensicLogRingTest()
+      : memory_(ForensicLogRing::RequiredSize(kCapacity)),
+        ring_(memory_.data(), memory_.size()) {
+    ring_.Initialize();
+  }
+
+  void TearDown() override {
+    ForensicLogSink* sink = ForensicLogSink::GetInstance();
+    if (sink->HasSourceForTesting(&ring_))
+      sink->RemoveSource(&ring_);
+  }
+
+  bool Write(const std::string& line) {
+    return ring_.Write(line.data(), line.size());
+  }
+
+  // The records follow the header.
+  char* data() { return memory_.data() + memory_.size() - kCapacity; }
+
+  void SetRecordLength(uint32_t index, uint32_t length) {
+    memcpy(data() + index, &length, sizeof(length));
+  }
+
+  // What a misbehaving producer can do; the write offset is the first field
+  // of the header.
+  void SetWriteOffset(uint32_t offset) {
+    memcpy(memory_.data(), &offset, sizeof(offset));
+  }
+
+  // Hands the ring to the sink the way the browser hands it a renderer's,
+  // and checks that the first drain finds it corrupt and stops reading it.
+  void ExpectSinkStopsReading() {
+    ForensicLogSink* sink = ForensicLogSink::GetInstance();
+    sink->AddSource(&ring_, "[test] ");
+    sink->FlushForTesting();
+    EXPECT_FALSE(sink->HasSourceForTesting(&ring_));
+
+    // The ring stays marked corrupt.
+    std::string lines;
+    EXPECT_FALSE(ring_.ReadAll(&lines));
+    EXPECT_TRUE(lines.empty());
+  }
+
+  std::vector<char> memory_;
+  ForensicLogRing ring_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ForensicLogRingTest);
+};
+
+}  // namespace
+
+TEST_F(ForensicLogRingTest, WriteWraps) {
+  for (char c = 'a'; c < 'e'; ++c)
+    ASSERT_TRUE(Write(Line(c)));
+  std::string lines;
+  ASSERT_TRUE(ring_.ReadAll(&lines));
+  EXPECT_EQ(Line('a') + "\n" + Line('b') + "\n" + Line('c') + "\n" +
+                Line('d') + "\n",
+            lines);
+
+  // 32 bytes are left before the end: the fifth line goes after a wrap
+  // marker, at the start of the ring.
+  ASSERT_TRUE(Write(Line('e')));
+  uint32_t marker;
+  memcpy(&marker, data() + 224, sizeof(marker));
+  EXPECT_EQ(kWrapMarker, marker);
+  EXPECT_EQ(0, memcmp(data() + sizeof(uint32_t), Line('e').data(),
+                      kLineLength));
+
+  lines.clear();
+  ASSERT_TRUE(ring_.ReadAll(&lines));
+  EXPECT_EQ(Line('e') + "\n", lines);
+
+  lines.clear();
+  EXPECT_TRUE(ring_.ReadAll(&lines));
+  EXPECT_TRUE(lines.empty());
+}
+
+TEST_F(ForensicLogRingTest, FullRingDropsLines) {
+  for (char c = 'a'; c < 'e'; ++c)
+    ASSERT_TRUE(Write(Line(c)));
+  EXPECT_FALSE(Write(Line('e')));
+  EXPECT_FALSE(Write(Line('f')));
+  EXPECT_EQ(2, ring_.TakeDropped());
+  EXPECT_EQ(0, ring_.TakeDropped());
+
+  std::string lines;
+  ASSERT_TRUE(ring_.ReadAll(&lines));
+  EXPECT_EQ(4 * (kLineLength + 1), lines.size());
+
+  // Reading made room again.
+  EXPECT_TRUE(Write(Line('g')));
+  EXPECT_EQ(0, ring_.TakeDropped());
+}
+
+TEST_F(ForensicLogRingTest, DropsLinesLongerThanAQuarter) {
+  EXPECT_FALSE(Write(std::string(kCapacity / 4 + 1, 'x')));
+  EXPECT_EQ(1, ring_.TakeDropped());
+
+  EXPECT_TRUE(Write(std::string(kCapacity / 4, 'x')));
+  std::string lines;
+  ASSERT_TRUE(ring_.ReadAll(&lines));
+  EXPECT_EQ(std::string(kCapacity / 4, 'x') + "\n", lines);
+}
+
+TEST_F(ForensicLogRingTest, WriteOffsetTooFarAhead) {
+  ASSERT_TRUE(Write(Line('a')));
+  SetWriteOffset(kCapacity + 8);
+  ExpectSinkStopsReading();
+}
+
+TEST_F(ForensicLogRingTest, WriteOffsetNotAligned) {
+  ASSERT_TRUE(Write(Line('a')));
+  SetWriteOffset(2);
+  ExpectSinkStopsReading();
+}
+
+TEST_F(ForensicLogRingTest, RecordLengthPastRingEnd) {
+  ASSERT_TRUE(Write(Line('a')));
+  SetRecordLength(0, kCapacity);
+  ExpectSinkStopsReading();
+}
+
+TEST_F(ForensicLogRingTest, RecordLengthPastWriteOffset) {
+  ASSERT_TRUE(Write(Line('a')));
+  SetRecordLength(0, kLineLength + 8);
+  ExpectSinkStopsReading();
+}
+
+TEST_F(ForensicLogRingTest, WrapMarkerAtIndexZero) {
+  SetRecordLength(0, kWrapMarker);
+  SetWriteOffset(8);
+  ExpectSinkStopsReading();
+}
+
+}  // namespace debug
+}  // namespace base
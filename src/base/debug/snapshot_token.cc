@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#include "base/debug/snapshot_token.h"
+
+#include <ostream>
+#include <sstream>
+
+namespace base {
+namespace debug {
+
+std::string SnapshotToken::ToString() const {
+  if (is_null())
+    return std::string();
+  std::ostringstream out;
+  out << *this;
+  return out.str();
+}
+
+std::ostream& operator<<(std::ostream& out, const SnapshotToken& token) {
+  if (token.is_null())
+    return out;
+  // The site ID used to be the SnapshotHandler pointer streamed as text.
+  return out << "0x" << std::hex << token.site_id << std::dec << "_"
+             << token.url_id << "_" << token.trace_id;
+}
+
+}  // namespace debug
+}  // namespace base
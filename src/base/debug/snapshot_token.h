@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef BASE_DEBUG_SNAPSHOT_TOKEN_H_
+#define BASE_DEBUG_SNAPSHOT_TOKEN_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <string>
+
+#include "base/base_export.h"
+
+namespace base {
+namespace debug {
+
+// Event ID of an input event and of the snapshots taken for it, as carried
+// from the browser to the renderer and through the GPU readback. Plain data,
+// so it is copied into every gfx::Size, copy request and IPC message without
+// an allocation; it is only turned into text when logged, as the
+// "<site ID>_<URL ID>_<trace ID>" event IDs of the logs and the archive. The
+// snapshot ID travels next to it.
+struct SnapshotToken {
+  SnapshotToken() : site_id(0), trace_id(-1), url_id(-1) {}
+  SnapshotToken(uint64_t site_id, int32_t url_id, int64_t trace_id)
+      : site_id(site_id), trace_id(trace_id), url_id(url_id) {}
+
+  // No input event, e.g. a screenshot request not made by SnapshotHandler.
+  bool is_null() const { return !site_id; }
+
+  // Empty for a null token.
+  BASE_EXPORT std::string ToString() const;
+
+  // Address of the tab's SnapshotHandler, which also names its directory.
+  uint64_t site_id;
+  // LatencyInfo trace ID of the event.
+  int64_t trace_id;
+  // Page of the tab, counted by SnapshotHandler.
+  int32_t url_id;
+};
+
+inline bool operator==(const SnapshotToken& a, const SnapshotToken& b) {
+  return a.site_id == b.site_id && a.trace_id == b.trace_id &&
+         a.url_id == b.url_id;
+}
+
+inline bool operator!=(const SnapshotToken& a, const SnapshotToken& b) {
+  return !(a == b);
+}
+
+// Writes ToString() without building the string.
+BASE_EXPORT std::ostream& operator<<(std::ostream& out,
+                                     const SnapshotToken& token);
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_SNAPSHOT_TOKEN_H_
@@ -34,9 +34,6 @@ bool ThreadRestrictions::SetIOAllowed(bool allowed) {
 
 // static
 void ThreadRestrictions::AssertIOAllowed() {
-  //ChromePic
-  return;
-  //ChromePic
   if (g_io_disallowed.Get().Get()) {
     LOG(FATAL) <<
         "Function marked as IO-only was called from a thread that "
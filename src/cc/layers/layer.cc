@@ -41,17 +41,7 @@
 #include "ui/gfx/geometry/vector2d_conversions.h"
 
 //ChromePic
-#include "base/threading/platform_thread.h"
-#include "base/files/file.h"
-#include "base/files/file_path.h"
-#include "base/files/file_util.h"
-#include "base/path_service.h"
-#include "base/time/time.h"
-#if defined(OS_ANDROID)
-#include <android/log.h>
-#endif
-using base::TimeTicks;
-using base::Time;
+#include "base/debug/forensic_log.h"
 //ChromePic
 
 //ChromePic
@@ -431,9 +421,7 @@ bool Layer::HasAncestor(const Layer* ancestor) const {
 void Layer::RequestCopyOfOutput(
     scoped_ptr<CopyOutputRequest> request) {
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG Layer::RequestCopyOfOutput,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  LogLineScreen(ss.str(), true);
+  FORENSIC_LOG(DEBUG) << "DEBUG Layer::RequestCopyOfOutput,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
   //ChromePic
   DCHECK(IsPropertyChangeAllowed());
   if (void* source = request->source()) {
@@ -2049,24 +2037,6 @@ bool Layer::sorted_for_recursion() {
          layer_tree_host()->meta_information_sequence_number();
 }
 
-//ChromePic
-//TODO: Remove this and use the one in content/browser/renderer_host/snapshot/logger.cc
-void Layer::LogLineScreen(std::string log_string, bool add_time){
-    std::stringstream log_stream_screen;
-    if (add_time){
-        int64_t us = TimeTicks::Now().ToInternalValue();
-        log_stream_screen << log_string << ",\tTime: " << us << "\n";
-    }
-    else
-        log_stream_screen << log_string << "\n"; 
-    fprintf(stderr, "%s", log_stream_screen.str().c_str());
-    #if defined(OS_ANDROID)
-      va_list args;
-      __android_log_vprint(ANDROID_LOG_WARN, "Forensics", log_stream_screen.str().c_str(),args);
-    #endif
-}
-//ChromePic
-
 gfx::Transform Layer::draw_transform() const {
   DCHECK_NE(transform_tree_index_, -1);
   return DrawTransformFromPropertyTrees(
@@ -580,10 +580,6 @@ class CC_EXPORT Layer : public base::RefCounted<Layer>,
   void OnTransformIsPotentiallyAnimatingChanged(bool is_animating) override;
   bool IsActive() const override;
 
-  //ChromePic
-  static void LogLineScreen(std::string log_string, bool add_time=false);
-  //ChromePic
-
  protected:
   friend class LayerImpl;
   friend class TreeSynchronizer;
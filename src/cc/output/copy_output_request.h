@@ -12,6 +12,10 @@
 #include "cc/resources/texture_mailbox.h"
 #include "ui/gfx/geometry/rect.h"
 
+//ChromePic
+#include "base/debug/snapshot_token.h"
+//ChromePic
+
 class SkBitmap;
 
 namespace cc {
@@ -78,7 +82,7 @@ class CC_EXPORT CopyOutputRequest {
   int routing_id;
   int process_id; 
   int snapshot_id; 
-  std::string event_id;
+  base::debug::SnapshotToken event_id;
   //ChromePic
 
  private:
@@ -58,17 +58,8 @@
 #include "ui/gfx/geometry/rect_conversions.h"
 
 //ChromePic
+#include "base/debug/forensic_log.h"
 #include "base/threading/platform_thread.h"
-#include "base/files/file.h"
-#include "base/files/file_path.h"
-#include "base/files/file_util.h"
-#include "base/path_service.h"
-#include "base/time/time.h"
-#if defined(OS_ANDROID)
-#include <android/log.h>
-#endif
-using base::TimeTicks;
-using base::Time;
 //ChromePic
 
 //ChromePic
@@ -2694,6 +2685,15 @@ void GLRenderer::GetFramebufferPixelsAsync(
     const DrawingFrame* frame,
     const gfx::Rect& rect,
     scoped_ptr<CopyOutputRequest> request) {
+  //ChromePic
+  TRACE_EVENT_WITH_FLOW1("forensics", "GLRenderer::GetFramebufferPixelsAsync",
+                         base::debug::ForensicFlowId(request->event_id,
+                                                     request->snapshot_id),
+                         request->snapshot_id != -1
+                             ? TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT
+                             : TRACE_EVENT_FLAG_NONE,
+                         "snapshot_id", request->snapshot_id);
+  //ChromePic
 
   DCHECK(!request->IsEmpty());
   if (request->IsEmpty())
@@ -2758,12 +2758,9 @@ void GLRenderer::GetFramebufferPixelsAsync(
                                std::move(release_callback));
     //ChromePic
     //The code is not calling a bitmap request so this is fine:
-    std::ostringstream ss;
-    ss << "DEBUG GLRenderer::GetFramebufferPixelsAsync,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId()
+    FORENSIC_LOG(DEBUG) << "DEBUG GLRenderer::GetFramebufferPixelsAsync,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId()
        << "Process ID: " << request->process_id << ", Routing ID: " << request->routing_id << ", Snapshot ID: " << request->snapshot_id << 
        ", Event ID: " << request->event_id;
-    LogLineScreen(ss.str(), true);
-    ss.str("");
       
     if (request->snapshot_id != -1) {
       output_surface_->SendScreenshotAck(request->routing_id, request->process_id, request->snapshot_id, request->event_id);
@@ -3623,21 +3620,4 @@ void GLRenderer::ScheduleOverlays(DrawingFrame* frame) {
   }
 }
 
-//ChromePic
-//TODO: Remove this and use the one in content/browser/renderer_host/snapshot/logger.cc
-void GLRenderer::LogLineScreen(std::string log_string, bool add_time){
-    std::stringstream log_stream_screen;
-    if (add_time){
-        int64_t us = TimeTicks::Now().ToInternalValue();
-        log_stream_screen << log_string << ",\tTime: " << us << "\n";
-    }
-    else
-        log_stream_screen << log_string << "\n"; 
-    fprintf(stderr, "%s", log_stream_screen.str().c_str());
-    #if defined(OS_ANDROID)
-      va_list args;
-      __android_log_vprint(ANDROID_LOG_WARN, "Forensics", log_stream_screen.str().c_str(),args);
-    #endif
-}
-//ChromePic
 }  // namespace cc
@@ -69,10 +69,6 @@ class CC_EXPORT GLRenderer : public DirectRenderer {
 
   virtual bool IsContextLost();
 
-  //ChromePic
-  static void LogLineScreen(std::string log_string, bool add_time=false);
-  //ChromePic
-
  protected:
   GLRenderer(RendererClient* client,
              const RendererSettings* settings,
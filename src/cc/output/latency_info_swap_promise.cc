@@ -10,16 +10,7 @@
 #include "base/trace_event/trace_event.h"
 
 //ChromePic
-#include "base/files/file.h"
-#include "base/files/file_path.h"
-#include "base/files/file_util.h"
-#include "base/path_service.h"
-#include "base/time/time.h"
-#if defined(OS_ANDROID)
-#include <android/log.h>
-#endif
-using base::TimeTicks;
-using base::Time;
+#include "base/debug/forensic_log.h"
 //ChromePic
 
 namespace {
@@ -55,9 +46,7 @@ void LatencyInfoSwapPromise::DidSwap(CompositorFrameMetadata* metadata) {
 
 void LatencyInfoSwapPromise::DidNotSwap(DidNotSwapReason reason) {
   //ChromePic
-  std::stringstream log_stream;
-  log_stream << "LatencyInfoSwapPromise:: INPUT_EVENT_LATENCY_TERMINATED_DID_NOT_SWAP_COMPONENT" << ", Trace ID: " <<  latency_.trace_id();
-  LogLineScreen(log_stream.str(), true);
+  FORENSIC_LOG(INPUT) << "LatencyInfoSwapPromise:: INPUT_EVENT_LATENCY_TERMINATED_DID_NOT_SWAP_COMPONENT" << ", Trace ID: " <<  latency_.trace_id();
   //ChromePic
   latency_.AddLatencyNumber(DidNotSwapReasonToLatencyComponentType(reason), 0,
                             0);
@@ -80,22 +69,4 @@ void LatencyInfoSwapPromise::OnCommit() {
 }
 
 
-//ChromePic
-//TODO: Remove this and use the one in content/browser/renderer_host/snapshot/logger.cc
-void LatencyInfoSwapPromise::LogLineScreen(std::string log_string, bool add_time){
-    std::stringstream log_stream_screen;
-    if (add_time){
-        int64_t us = TimeTicks::Now().ToInternalValue();
-        log_stream_screen << log_string << ",\tTime: " << us << "\n";
-    }
-    else
-        log_stream_screen << log_string << "\n"; 
-    fprintf(stderr, "%s", log_stream_screen.str().c_str());
-    #if defined(OS_ANDROID)
-      va_list args;
-      __android_log_vprint(ANDROID_LOG_WARN, "Forensics", log_stream_screen.str().c_str(),args);
-    #endif
-}
-//ChromePic
-
 }  // namespace cc
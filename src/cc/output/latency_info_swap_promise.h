@@ -24,10 +24,6 @@ class CC_EXPORT LatencyInfoSwapPromise : public SwapPromise {
   void OnCommit() override;
 
   int64_t TraceId() const override;
-  //ChromePic
-  static void LogLineScreen(std::string log_string, bool add_time=false);
-  //ChromePic
-
  private:
   ui::LatencyInfo latency_;
 };
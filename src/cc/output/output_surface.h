@@ -17,6 +17,10 @@
 #include "cc/output/overlay_candidate_validator.h"
 #include "cc/output/software_output_device.h"
 
+//ChromePic
+#include "base/debug/snapshot_token.h"
+//ChromePic
+
 namespace base { class SingleThreadTaskRunner; }
 
 namespace ui {
@@ -173,7 +177,8 @@ class CC_EXPORT OutputSurface : public base::trace_event::MemoryDumpProvider {
                     base::trace_event::ProcessMemoryDump* pmd) override;
 
   //ChromePic
-  virtual void SendScreenshotAck(int routing_id, int process_id, int snapshot_id, std::string event_id) {} 
+  virtual void SendScreenshotAck(int routing_id, int process_id, int snapshot_id,
+                                 const base::debug::SnapshotToken& event_id) {}
   //ChromePic
 
  protected:
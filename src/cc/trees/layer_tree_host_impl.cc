@@ -89,17 +89,7 @@
 #include "ui/gfx/geometry/vector2d_conversions.h"
 
 //ChromePic
-#include "base/threading/platform_thread.h"
-#include "base/files/file.h"
-#include "base/files/file_path.h"
-#include "base/files/file_util.h"
-#include "base/path_service.h"
-#include "base/time/time.h"
-#if defined(OS_ANDROID)
-#include <android/log.h>
-#endif
-using base::TimeTicks;
-using base::Time;
+#include "base/debug/forensic_log.h"
 //ChromePic
 
 namespace cc {
@@ -830,9 +820,7 @@ DrawResult LayerTreeHostImpl::CalculateRenderPasses(
                             active_tree_->hud_layer()->IsAnimatingHUDContents();
 
   //ChromePic
-  //std::stringstream log_stream;
-  //log_stream << "LayerTreeHostImpl:: CalculateRenderPasses, empty output request?: " << active_tree_->LayersWithCopyOutputRequest().empty();
-  //LogLineScreen(log_stream.str(), true);
+  //FORENSIC_LOG(DEBUG) << "LayerTreeHostImpl:: CalculateRenderPasses, empty output request?: " << active_tree_->LayersWithCopyOutputRequest().empty();
   //ChromePic
 
   if (root_surface_has_contributing_layers &&
@@ -930,9 +918,7 @@ DrawResult LayerTreeHostImpl::CalculateRenderPasses(
     if (it.represents_target_render_surface()) {
       if (it->HasCopyRequest()) {
       //ChromePic
-      //std::stringstream log_stream;
-      //log_stream << "LayerTreeHostImpl:: Has copy request. Calling TakeCopyRequestAndTransformToTarget ";
-      //LogLineScreen(log_stream.str(), true);
+      //FORENSIC_LOG(DEBUG) << "LayerTreeHostImpl:: Has copy request. Calling TakeCopyRequestAndTransformToTarget ";
       //ChromePic
         have_copy_request = true;
         it->TakeCopyRequestsAndTransformToTarget(
@@ -1152,11 +1138,7 @@ DrawResult LayerTreeHostImpl::PrepareToDraw(FrameData* frame) {
 
   //ChromePic
   //This showed that PrepareToDraw is called several time before a screenshot is actually taken
-  //std::stringstream log_stream;
-  ////if (event.type != WebInputEvent::MouseMove) {
-      //log_stream << "LayerTreeHostImpl:: PrepareToDraw, Thread ID:" << base::PlatformThread::CurrentId();
-      //LogLineScreen(log_stream.str(), true);
-  //}
+  //FORENSIC_LOG(DEBUG) << "LayerTreeHostImpl:: PrepareToDraw, Thread ID:" << base::PlatformThread::CurrentId();
   //ChromePic
 
   TRACE_EVENT1("cc",
@@ -3938,22 +3920,4 @@ bool LayerTreeHostImpl::CommitToActiveTree() const {
   return !task_runner_provider_->HasImplThread();
 }
 
-//ChromePic
-//TODO: Remove this and use the one in content/browser/renderer_host/snapshot/logger.cc
-void LayerTreeHostImpl::LogLineScreen(std::string log_string, bool add_time){
-    std::stringstream log_stream_screen;
-    if (add_time){
-        int64_t us = TimeTicks::Now().ToInternalValue();
-        log_stream_screen << log_string << ",\tTime: " << us << "\n";
-    }
-    else
-        log_stream_screen << log_string << "\n"; 
-    fprintf(stderr, "%s", log_stream_screen.str().c_str());
-    #if defined(OS_ANDROID)
-      va_list args;
-      __android_log_vprint(ANDROID_LOG_WARN, "Forensics", log_stream_screen.str().c_str(),args);
-    #endif
-}
-//ChromePic
-
 }  // namespace cc
@@ -708,10 +708,6 @@ class CC_EXPORT LayerTreeHostImpl
                                    const gfx::Vector2dF& scroll_delta);
 
 
-  //ChromePic
-  static void LogLineScreen(std::string log_string, bool add_time=false);
-  //ChromePic
-
   typedef base::hash_map<UIResourceId, UIResourceData>
       UIResourceMap;
   UIResourceMap ui_resource_map_;
@@ -17,7 +17,9 @@
 
 //ChromePic
 #include "content/common/input_messages.h"
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "base/debug/forensic_log.h"
+#include "base/trace_event/trace_event.h"
+#include "content/common/snapshot/event_journal.h"
 #include "content/public/browser/render_view_host.h"
 //ChromePic
 
@@ -112,11 +114,18 @@ void BrowserCompositorOutputSurface::SetReflector(ReflectorImpl* reflector) {
 
 
 //ChromePic
-void BrowserCompositorOutputSurface::SendScreenshotAck(int routing_id, int process_id, int snapshot_id, std::string event_id) {
-  std::stringstream log_stream;
-  log_stream << "DEBUG BrowserCompositorOutputSurface::SendScreenshotAck, Event ID: " << event_id;
-  Logger::LogLineScreen(log_stream.str(), true);
-  log_stream.str("");
+void BrowserCompositorOutputSurface::SendScreenshotAck(int routing_id, int process_id, int snapshot_id,
+                                                       const base::debug::SnapshotToken& event_id) {
+  TRACE_EVENT_WITH_FLOW1("forensics",
+                         "BrowserCompositorOutputSurface::SendScreenshotAck",
+                         base::debug::ForensicFlowId(event_id, snapshot_id),
+                         TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+                         "snapshot_id", snapshot_id);
+  FORENSIC_LOG(DEBUG) << "DEBUG BrowserCompositorOutputSurface::SendScreenshotAck, Event ID: " << event_id;
+  JournalEntry journal_entry(JOURNAL_STAGE_SCREENSHOT_ACK_SENT);
+  SetJournalEventId(event_id, &journal_entry);
+  journal_entry.snapshot_id = snapshot_id;
+  EventJournal::Record(&journal_entry);
   content::RenderViewHost* rvh;
   rvh = content::RenderViewHost::FromID(process_id, routing_id);
   if (rvh)
@@ -63,7 +63,8 @@ class CONTENT_EXPORT BrowserCompositorOutputSurface
 #endif
 
   //ChromePic
-  void SendScreenshotAck(int routing_id, int process_id, int snapshot_id, std::string event_id) override; 
+  void SendScreenshotAck(int routing_id, int process_id, int snapshot_id,
+                         const base::debug::SnapshotToken& event_id) override;
   //ChromePic
 
  protected:
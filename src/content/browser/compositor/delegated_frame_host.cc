@@ -36,7 +36,11 @@
 #include "ui/gfx/geometry/dip_util.h"
 
 //ChromePic
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/common/snapshot/event_journal.h"
+#include "content/browser/renderer_host/snapshot/screenshot_buffer_pool.h"
+#include "base/debug/forensic_log.h"
+#include "base/trace_event/trace_event.h"
+#include "ui/gfx/geometry/size_conversions.h"
 //ChromePic
 
 namespace content {
@@ -143,6 +147,16 @@ void DelegatedFrameHost::CopyFromCompositingSurface(
     const gfx::Size& output_size,
     const ReadbackRequestCallback& callback,
     const SkColorType preferred_color_type) {
+  //ChromePic
+  TRACE_EVENT_WITH_FLOW1("forensics",
+                         "DelegatedFrameHost::CopyFromCompositingSurface",
+                         base::debug::ForensicFlowId(output_size.event_id,
+                                                     output_size.snapshot_id),
+                         output_size.snapshot_id != -1
+                             ? TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT
+                             : TRACE_EVENT_FLAG_NONE,
+                         "snapshot_id", output_size.snapshot_id);
+  //ChromePic
   // Only ARGB888 and RGB565 supported as of now.
   bool format_support = ((preferred_color_type == kAlpha_8_SkColorType) ||
                          (preferred_color_type == kRGB_565_SkColorType) ||
@@ -165,11 +179,14 @@ void DelegatedFrameHost::CopyFromCompositingSurface(
   request->snapshot_id = output_size.snapshot_id;
   request->event_id = output_size.event_id;
 
-  std::ostringstream ss;
-  ss << "DEBUG DelegatedFrameHost::CopyFromCompositingSurface: " << "Process ID: " << output_size.process_id << ", Routing ID: " << output_size.routing_id << ", Snapshot ID: " << request->snapshot_id
+  FORENSIC_LOG(DEBUG) << "DEBUG DelegatedFrameHost::CopyFromCompositingSurface: " << "Process ID: " << output_size.process_id << ", Routing ID: " << output_size.routing_id << ", Snapshot ID: " << request->snapshot_id
      << ", Event ID: " << request->event_id;
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  if (request->snapshot_id != -1) {
+    JournalEntry journal_entry(JOURNAL_STAGE_SCREENSHOT_COPY_REQUEST);
+    SetJournalEventId(request->event_id, &journal_entry);
+    journal_entry.snapshot_id = request->snapshot_id;
+    EventJournal::Record(&journal_entry);
+  }
   //ChromePic
   RequestCopyOfOutput(std::move(request));
 }
@@ -608,12 +625,119 @@ void DelegatedFrameHost::EvictDelegatedFrame() {
   delegated_frame_evictor_->DiscardedFrame();
 }
 
+//ChromePic
+static void CopyFromCompositingSurfaceFinishedForI420(
+    const ReadbackRequestCallback& callback,
+    scoped_ptr<cc::SingleReleaseCallback> release_callback,
+    scoped_ptr<ReadbackYUVInterface> yuv_readback_pipeline,
+    const scoped_refptr<media::VideoFrame>& video_frame,
+    bool result) {
+  gpu::SyncToken sync_token;
+  if (result) {
+    GLHelper* gl_helper = ImageTransportFactory::GetInstance()->GetGLHelper();
+    if (gl_helper)
+      gl_helper->GenerateSyncToken(&sync_token);
+  }
+  const bool lost_resource = !sync_token.HasData();
+  release_callback->Run(sync_token, lost_resource);
+
+  if (!result) {
+    callback.Run(SkBitmap(), content::READBACK_FAILED);
+    return;
+  }
+
+  // Hand the planes over as one A8 bitmap holding a plain I420 image: the Y
+  // plane followed by the U and V planes, each tightly packed.
+  const gfx::Size size = video_frame->visible_rect().size();
+  SkBitmap bitmap;
+  if (!ScreenshotBufferPool::GetInstance()->AllocPixels(
+          SkImageInfo::MakeA8(size.width(), size.height() * 3 / 2), &bitmap)) {
+    callback.Run(SkBitmap(), content::READBACK_BITMAP_ALLOCATION_FAILURE);
+    return;
+  }
+  SkAutoLockPixels bitmap_lock(bitmap);
+  uint8_t* dest = static_cast<uint8_t*>(bitmap.getPixels());
+  const size_t planes[] = {media::VideoFrame::kYPlane,
+                           media::VideoFrame::kUPlane,
+                           media::VideoFrame::kVPlane};
+  for (size_t plane : planes) {
+    const int width = plane == media::VideoFrame::kYPlane ? size.width() : size.width() / 2;
+    const int height = plane == media::VideoFrame::kYPlane ? size.height() : size.height() / 2;
+    for (int y = 0; y < height; y++, dest += width)
+      memcpy(dest, video_frame->visible_data(plane) + y * video_frame->stride(plane), width);
+  }
+  callback.Run(bitmap, content::READBACK_SUCCESS);
+}
+
+// Like PrepareTextureCopyOutputResult, but scales and converts to I420 on the
+// GPU, so only 1.5 bytes per pixel are read back.
+static void PrepareTextureI420CopyOutputResult(
+    const gfx::Size& dst_size_in_pixel,
+    const ReadbackRequestCallback& callback,
+    scoped_ptr<cc::CopyOutputResult> result) {
+  base::ScopedClosureRunner scoped_callback_runner(
+      base::Bind(callback, SkBitmap(), content::READBACK_FAILED));
+
+  // Chroma is subsampled 2x2, so keep the frame size even.
+  gfx::Size dst_size(dst_size_in_pixel.width() & ~1,
+                     dst_size_in_pixel.height() & ~1);
+  if (dst_size.IsEmpty())
+    return;
+
+  GLHelper* gl_helper = ImageTransportFactory::GetInstance()->GetGLHelper();
+  if (!gl_helper)
+    return;
+
+  scoped_refptr<media::VideoFrame> video_frame = media::VideoFrame::CreateFrame(
+      media::PIXEL_FORMAT_I420, dst_size, gfx::Rect(dst_size), dst_size,
+      base::TimeDelta());
+  if (!video_frame)
+    return;
+
+  cc::TextureMailbox texture_mailbox;
+  scoped_ptr<cc::SingleReleaseCallback> release_callback;
+  result->TakeTexture(&texture_mailbox, &release_callback);
+  DCHECK(texture_mailbox.IsTexture());
+
+  // Unlike the frame subscriber's yuv_readback_pipeline_, this one is not
+  // cached: this function is static and snapshots are far less frequent than
+  // video frames. GLHelper keeps the compiled scaler shaders either way.
+  scoped_ptr<ReadbackYUVInterface> yuv_readback_pipeline(
+      gl_helper->CreateReadbackPipelineYUV(GLHelper::SCALER_QUALITY_GOOD,
+                                           result->size(),
+                                           gfx::Rect(result->size()),
+                                           dst_size,
+                                           true,
+                                           true));
+  ReadbackYUVInterface* pipeline = yuv_readback_pipeline.get();
+
+  ignore_result(scoped_callback_runner.Release());
+  pipeline->ReadbackYUV(
+      texture_mailbox.mailbox(), texture_mailbox.sync_token(),
+      video_frame.get(), gfx::Point(),
+      base::Bind(&CopyFromCompositingSurfaceFinishedForI420, callback,
+                 base::Passed(&release_callback),
+                 base::Passed(&yuv_readback_pipeline), video_frame));
+}
+//ChromePic
+
 // static
 void DelegatedFrameHost::CopyFromCompositingSurfaceHasResult(
     const gfx::Size& dst_size_in_pixel,
     const SkColorType color_type,
     const ReadbackRequestCallback& callback,
     scoped_ptr<cc::CopyOutputResult> result) {
+  //ChromePic
+  // The readback, up to the SnapshotHandler callback.
+  TRACE_EVENT_WITH_FLOW1("forensics",
+                         "DelegatedFrameHost::CopyFromCompositingSurfaceHasResult",
+                         base::debug::ForensicFlowId(dst_size_in_pixel.event_id,
+                                                     dst_size_in_pixel.snapshot_id),
+                         dst_size_in_pixel.snapshot_id != -1
+                             ? TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT
+                             : TRACE_EVENT_FLAG_NONE,
+                         "snapshot_id", dst_size_in_pixel.snapshot_id);
+  //ChromePic
   if (result->IsEmpty() || result->size().IsEmpty()) {
     callback.Run(SkBitmap(), content::READBACK_FAILED);
     return;
@@ -625,6 +749,28 @@ void DelegatedFrameHost::CopyFromCompositingSurfaceHasResult(
   else
     output_size_in_pixel = dst_size_in_pixel;
 
+  //ChromePic
+  // Covers the draw and GLRenderer's copy of the frame.
+  if (dst_size_in_pixel.snapshot_id != -1) {
+    JournalEntry journal_entry(JOURNAL_STAGE_SCREENSHOT_COPY_RESULT);
+    SetJournalEventId(dst_size_in_pixel.event_id, &journal_entry);
+    journal_entry.snapshot_id = dst_size_in_pixel.snapshot_id;
+    EventJournal::Record(&journal_entry);
+  }
+  if (dst_size_in_pixel.IsEmpty() && dst_size_in_pixel.snapshot_scale < 1.f) {
+    output_size_in_pixel = gfx::ScaleToRoundedSize(
+        result->size(), dst_size_in_pixel.snapshot_scale);
+    output_size_in_pixel.SetToMax(gfx::Size(2, 2));
+  }
+  // Snapshot readbacks go to pooled buffers; see below.
+  output_size_in_pixel.snapshot_id = dst_size_in_pixel.snapshot_id;
+  if (result->HasTexture() && dst_size_in_pixel.snapshot_i420) {
+    PrepareTextureI420CopyOutputResult(output_size_in_pixel, callback,
+                                       std::move(result));
+    return;
+  }
+  //ChromePic
+
   if (result->HasTexture()) {
     // GPU-accelerated path
     PrepareTextureCopyOutputResult(output_size_in_pixel, color_type, callback,
@@ -666,10 +812,8 @@ void DelegatedFrameHost::PrepareTextureCopyOutputResult(
     const ReadbackRequestCallback& callback,
     scoped_ptr<cc::CopyOutputResult> result) {
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG DelegatedFrameHost::PrepareTextureCopyOutputResult BEGIN" << ", Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  JournalEntry journal_entry(JOURNAL_STAGE_COPY_OUTPUT_RESULT_BEGIN);
+  EventJournal::Record(&journal_entry);
   //ChromePic
   DCHECK(result->HasTexture());
   base::ScopedClosureRunner scoped_callback_runner(
@@ -679,9 +823,16 @@ void DelegatedFrameHost::PrepareTextureCopyOutputResult(
   // GLHelper::IsReadbackConfigSupported before we processs the result.
   // See crbug.com/415682 and crbug.com/415131.
   scoped_ptr<SkBitmap> bitmap(new SkBitmap);
-  if (!bitmap->tryAllocPixels(SkImageInfo::Make(
-          dst_size_in_pixel.width(), dst_size_in_pixel.height(), color_type,
-          kOpaque_SkAlphaType))) {
+  //ChromePic
+  // A snapshot's pixels are read back into a reused shared memory buffer,
+  // which the screenshot encoder then reads in place.
+  const SkImageInfo info = SkImageInfo::Make(
+      dst_size_in_pixel.width(), dst_size_in_pixel.height(), color_type,
+      kOpaque_SkAlphaType);
+  if (dst_size_in_pixel.snapshot_id != -1
+          ? !ScreenshotBufferPool::GetInstance()->AllocPixels(info, bitmap.get())
+          : !bitmap->tryAllocPixels(info)) {
+  //ChromePic
     scoped_callback_runner.Reset(base::Bind(
         callback, SkBitmap(), content::READBACK_BITMAP_ALLOCATION_FAILURE));
     return;
@@ -711,9 +862,8 @@ void DelegatedFrameHost::PrepareTextureCopyOutputResult(
                  base::Passed(&bitmap_pixels_lock)),
       GLHelper::SCALER_QUALITY_GOOD);
   //ChromePic
-  ss << "DEBUG DelegatedFrameHost::PrepareTextureCopyOutputResult END" << ", Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  journal_entry.stage = JOURNAL_STAGE_COPY_OUTPUT_RESULT_END;
+  EventJournal::Record(&journal_entry);
   //ChromePic
 }
 
@@ -20,7 +20,7 @@
 #include "ui/gfx/vsync_provider.h"
 
 //ChromePic
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/common/snapshot/event_journal.h"
 //ChromePic
 
 namespace content {
@@ -45,9 +45,9 @@ void SoftwareBrowserCompositorOutputSurface::SwapBuffers(
         ui::INPUT_EVENT_LATENCY_TERMINATED_FRAME_SWAP_COMPONENT, 0, 0,
         swap_time, 1);
     //ChromePic
-    std::stringstream log_stream;
-    log_stream << "SoftwareBrowserCompositorOutputSurface: SwapBuffers, Trace ID: " <<  latency.trace_id();
-    Logger::LogLineScreen(log_stream.str(), true);
+    JournalEntry journal_entry(JOURNAL_STAGE_FRAME_SWAP);
+    journal_entry.trace_id = latency.trace_id();
+    EventJournal::Record(&journal_entry);
     //ChromePic
   }
   base::ThreadTaskRunnerHandle::Get()->PostTask(
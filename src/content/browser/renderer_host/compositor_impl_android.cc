@@ -69,7 +69,7 @@
 
 //ChromePic
 #include "content/common/input_messages.h"
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "base/debug/forensic_log.h"
 #include "content/public/browser/render_view_host.h"
 //ChromePic
 
@@ -129,11 +129,9 @@ class OutputSurfaceWithoutParent : public cc::OutputSurface,
   }
  
 //ChromePic
-void SendScreenshotAck(int routing_id, int process_id, int snapshot_id, int event_id) override {
-  std::stringstream log_stream;
-  log_stream << "DEBUG OutputSurfaceWithoutParent::SendScreenshotAck, Event ID: " << event_id;
-  Logger::LogLineScreen(log_stream.str(), true);
-  log_stream.str("");
+void SendScreenshotAck(int routing_id, int process_id, int snapshot_id,
+                       const base::debug::SnapshotToken& event_id) override {
+  FORENSIC_LOG(DEBUG) << "DEBUG OutputSurfaceWithoutParent::SendScreenshotAck, Event ID: " << event_id;
   content::RenderViewHost* rvh;
   rvh = content::RenderViewHost::FromID(process_id, routing_id);
   rvh->Send(new InputMsg_ScreenshotCaptured(routing_id, snapshot_id, event_id, true)); 
@@ -12,6 +12,7 @@
 #include "third_party/WebKit/public/web/WebInputEvent.h"
 
 //ChromePic
+#include "content/browser/renderer_host/snapshot/snapshot_priority.h"
 #include "content/public/browser/readback_types.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 //ChromePic
@@ -67,6 +68,8 @@ class CONTENT_EXPORT InputRouterClient {
                                     const gfx::Size& accelerated_dst_size,
                                     const ReadbackRequestCallback& callback,
                                     const SkColorType color_type) = 0;
+  // Where the widget's snapshots go in the SnapshotScheduler queues.
+  virtual SnapshotPriority GetSnapshotPriority() = 0;
 
 
 };
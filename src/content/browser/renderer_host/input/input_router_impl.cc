@@ -93,6 +93,8 @@ InputRouterImpl::InputRouterImpl(IPC::Sender* sender,
 
 InputRouterImpl::~InputRouterImpl() {
   //ChromePic
+  snapshot_handler_->DumpIPCMessageStats();
+  snapshot_handler_->CancelScheduledSnapshots();
   snapshot_handler_->logger_->Flush();
   //ChromePic
   STLDeleteElements(&pending_select_messages_);
@@ -286,6 +288,12 @@ bool InputRouterImpl::OnMessageReceived(const IPC::Message& message) {
     IPC_MESSAGE_HANDLER(InputHostMsg_SetTouchAction,
                         OnSetTouchAction)
     IPC_MESSAGE_HANDLER(InputHostMsg_DidStopFlinging, OnDidStopFlinging)
+    //ChromePic
+    IPC_MESSAGE_HANDLER(InputHostMsg_StoreSnapshotResource,
+                        OnStoreSnapshotResource)
+    IPC_MESSAGE_HANDLER(InputHostMsg_DOMSnapshotCaptured,
+                        OnDOMSnapshotCaptured)
+    //ChromePic
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
 
@@ -533,6 +541,17 @@ void InputRouterImpl::OnDidStopFlinging() {
   client_->DidStopFlinging();
 }
 
+//ChromePic
+void InputRouterImpl::OnStoreSnapshotResource(const std::string& digest,
+                                              const std::vector<char>& data) {
+  snapshot_handler_->StoreResource(digest, data);
+}
+
+void InputRouterImpl::OnDOMSnapshotCaptured(int snapshot_id, int64_t size) {
+  snapshot_handler_->DOMSnapshotCaptured(snapshot_id, size);
+}
+//ChromePic
+
 void InputRouterImpl::ProcessInputEventAck(WebInputEvent::Type event_type,
                                            InputEventAckState ack_result,
                                            const ui::LatencyInfo& latency_info,
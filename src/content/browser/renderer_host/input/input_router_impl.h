@@ -129,6 +129,11 @@ private:
   void OnHasTouchEventHandlers(bool has_handlers);
   void OnSetTouchAction(TouchAction touch_action);
   void OnDidStopFlinging();
+  //ChromePic
+  void OnStoreSnapshotResource(const std::string& digest,
+                               const std::vector<char>& data);
+  void OnDOMSnapshotCaptured(int snapshot_id, int64_t size);
+  //ChromePic
 
   // Indicates the source of an ack provided to |ProcessInputEventAck()|.
   // The source is tracked by |current_ack_source_|, which aids in ack routing.
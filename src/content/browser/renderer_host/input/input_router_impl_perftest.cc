@@ -100,6 +100,9 @@ class NullInputRouterClient : public InputRouterClient {
                                     const gfx::Size& accelerated_dst_size,
                                     const ReadbackRequestCallback& callback,
                                     const SkColorType color_type) override{} 
+  virtual SnapshotPriority GetSnapshotPriority() override {
+    return SNAPSHOT_PRIORITY_FOCUSED;
+  }
 
   //ChromePic
 };
@@ -44,6 +44,9 @@ class MockInputRouterClient : public InputRouterClient {
                                     const gfx::Size& accelerated_dst_size,
                                     const ReadbackRequestCallback& callback,
                                     const SkColorType color_type) override{} 
+  virtual SnapshotPriority GetSnapshotPriority() override {
+    return SNAPSHOT_PRIORITY_FOCUSED;
+  }
 
   //ChromePic
 
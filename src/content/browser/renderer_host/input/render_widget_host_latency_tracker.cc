@@ -12,7 +12,7 @@
 #include "content/browser/renderer_host/render_widget_host_impl.h"
 
 //ChromePic
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/common/snapshot/event_journal.h"
 //ChromePic
 
 using blink::WebGestureEvent;
@@ -349,10 +349,11 @@ void RenderWidgetHostLatencyTracker::OnInputEvent(
   UpdateLatencyCoordinates(event, device_scale_factor_, latency);
 
   //ChromePic
-  std::stringstream log_stream;
+  JournalEntry journal_entry(JOURNAL_STAGE_LATENCY_BEGIN_RWH);
   //if (event.type != WebInputEvent::MouseMove) {
-      log_stream << "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_BEGIN_RWH_COMPONENT, Name: " << WebInputEventTraits::GetName(event.type) << ", Trace ID: " <<  latency->trace_id();
-      Logger::LogLineScreen(log_stream.str(), true);
+      journal_entry.trace_id = latency->trace_id();
+      journal_entry.event_type = event.type;
+      EventJournal::Record(&journal_entry);
   //}
   //ChromePic
 
@@ -391,9 +392,10 @@ void RenderWidgetHostLatencyTracker::OnInputEventAck(
   if (WebInputEvent::isGestureEventType(event.type)) {
     if (!rendering_scheduled) {
       //ChromePic
-      std::stringstream log_stream;
-      log_stream << "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_GESTURE_COMPONENT, Name: " << WebInputEventTraits::GetName(event.type) << ", Trace ID: " <<  latency->trace_id();
-      Logger::LogLineScreen(log_stream.str(), true);
+      JournalEntry journal_entry(JOURNAL_STAGE_LATENCY_TERMINATED_GESTURE);
+      journal_entry.trace_id = latency->trace_id();
+      journal_entry.event_type = event.type;
+      EventJournal::Record(&journal_entry);
       //ChromePic
       latency->AddLatencyNumber(
           ui::INPUT_EVENT_LATENCY_TERMINATED_GESTURE_COMPONENT, 0, 0);
@@ -406,9 +408,10 @@ void RenderWidgetHostLatencyTracker::OnInputEventAck(
     latency->AddLatencyNumber(ui::INPUT_EVENT_LATENCY_ACK_RWH_COMPONENT, 0, 0);
     if (!rendering_scheduled) {
       //ChromePic
-      std::stringstream log_stream;
-      log_stream << "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_TOUCH_COMPONENT, Name: " << WebInputEventTraits::GetName(event.type) << ", Trace ID: " <<  latency->trace_id();
-      Logger::LogLineScreen(log_stream.str(), true);
+      JournalEntry journal_entry(JOURNAL_STAGE_LATENCY_TERMINATED_TOUCH);
+      journal_entry.trace_id = latency->trace_id();
+      journal_entry.event_type = event.type;
+      EventJournal::Record(&journal_entry);
       //ChromePic
       latency->AddLatencyNumber(
           ui::INPUT_EVENT_LATENCY_TERMINATED_TOUCH_COMPONENT, 0, 0);
@@ -422,9 +425,10 @@ void RenderWidgetHostLatencyTracker::OnInputEventAck(
     latency->AddLatencyNumber(ui::INPUT_EVENT_LATENCY_ACK_RWH_COMPONENT, 0, 0);
     if (!rendering_scheduled) {
       //ChromePic
-      std::stringstream log_stream;
-      log_stream << "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_MOUSE_WHEEL_COMPONENT, Name: " << WebInputEventTraits::GetName(event.type) << ", Trace ID: " <<  latency->trace_id();
-      Logger::LogLineScreen(log_stream.str(), true);
+      JournalEntry journal_entry(JOURNAL_STAGE_LATENCY_TERMINATED_MOUSE_WHEEL);
+      journal_entry.trace_id = latency->trace_id();
+      journal_entry.event_type = event.type;
+      EventJournal::Record(&journal_entry);
       //ChromePic
       latency->AddLatencyNumber(
           ui::INPUT_EVENT_LATENCY_TERMINATED_MOUSE_WHEEL_COMPONENT, 0, 0);
@@ -436,9 +440,10 @@ void RenderWidgetHostLatencyTracker::OnInputEventAck(
 
   if (WebInputEvent::isMouseEventType(event.type) && !rendering_scheduled) {
       //ChromePic
-      std::stringstream log_stream;
-      log_stream << "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_MOUSE_COMPONENT, Name: " << WebInputEventTraits::GetName(event.type) << ", Trace ID: " <<  latency->trace_id();
-      Logger::LogLineScreen(log_stream.str(), true);
+      JournalEntry journal_entry(JOURNAL_STAGE_LATENCY_TERMINATED_MOUSE);
+      journal_entry.trace_id = latency->trace_id();
+      journal_entry.event_type = event.type;
+      EventJournal::Record(&journal_entry);
       //ChromePic
       latency->AddLatencyNumber(
           ui::INPUT_EVENT_LATENCY_TERMINATED_MOUSE_COMPONENT, 0, 0);
@@ -447,9 +452,10 @@ void RenderWidgetHostLatencyTracker::OnInputEventAck(
 
   if (WebInputEvent::isKeyboardEventType(event.type) && !rendering_scheduled) {
       //ChromePic
-      std::stringstream log_stream;
-      log_stream << "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_KEYBOARD_COMPONENT, Name: " << WebInputEventTraits::GetName(event.type) << ", Trace ID: " <<  latency->trace_id();
-      Logger::LogLineScreen(log_stream.str(), true);
+      JournalEntry journal_entry(JOURNAL_STAGE_LATENCY_TERMINATED_KEYBOARD);
+      journal_entry.trace_id = latency->trace_id();
+      journal_entry.event_type = event.type;
+      EventJournal::Record(&journal_entry);
       //ChromePic
       latency->AddLatencyNumber(
           ui::INPUT_EVENT_LATENCY_TERMINATED_KEYBOARD_COMPONENT, 0, 0);
@@ -808,6 +808,12 @@ void RenderWidgetHostImpl::TakeDOMSnapshot(
     }
     web_contents->GenerateMHTML(path, callback);
 }
+
+SnapshotPriority RenderWidgetHostImpl::GetSnapshotPriority() {
+    if (is_hidden_)
+        return SNAPSHOT_PRIORITY_HIDDEN;
+    return is_focused_ ? SNAPSHOT_PRIORITY_FOCUSED : SNAPSHOT_PRIORITY_VISIBLE;
+}
 //ChromePic
 
 void RenderWidgetHostImpl::CopyFromBackingStore(
@@ -146,6 +146,7 @@ class CONTENT_EXPORT RenderWidgetHostImpl : public RenderWidgetHost,
                                 const gfx::Size& accelerated_dst_size,
                                 const ReadbackRequestCallback& callback,
                                 const SkColorType preferred_color_type) override;
+  SnapshotPriority GetSnapshotPriority() override;
   void CopyFromBackingStore(const gfx::Rect& src_rect,
                             const gfx::Size& accelerated_dst_size,
                             const ReadbackRequestCallback& callback,
@@ -93,7 +93,9 @@
 #include "ui/touch_selection/touch_selection_controller.h"
 
 //ChromePic
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "base/debug/forensic_log.h"
+#include "base/trace_event/trace_event.h"
+#include "content/common/snapshot/event_journal.h"
 //ChromePic
 
 namespace content {
@@ -880,6 +882,16 @@ void RenderWidgetHostViewAndroid::CopyFromCompositingSurface(
     const ReadbackRequestCallback& callback,
     const SkColorType preferred_color_type) {
   TRACE_EVENT0("cc", "RenderWidgetHostViewAndroid::CopyFromCompositingSurface");
+  //ChromePic
+  TRACE_EVENT_WITH_FLOW1("forensics",
+                         "RenderWidgetHostViewAndroid::CopyFromCompositingSurface",
+                         base::debug::ForensicFlowId(dst_size.event_id,
+                                                     dst_size.snapshot_id),
+                         dst_size.snapshot_id != -1
+                             ? TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT
+                             : TRACE_EVENT_FLAG_NONE,
+                         "snapshot_id", dst_size.snapshot_id);
+  //ChromePic
   if (!host_ || host_->is_hidden()) {
     callback.Run(SkBitmap(), READBACK_SURFACE_UNAVAILABLE);
     return;
@@ -896,6 +908,15 @@ void RenderWidgetHostViewAndroid::CopyFromCompositingSurface(
       gfx::ConvertRectToPixel(device_scale_factor, gfx::Rect(dst_size)).size();
   gfx::Rect src_subrect_in_pixel =
       gfx::ConvertRectToPixel(device_scale_factor, src_subrect);
+  //ChromePic
+  // I420 readback is only wired up for DelegatedFrameHost; Android snapshots
+  // get the GPU downscale but stay BGRA.
+  if (dst_size_in_pixel.IsEmpty() && dst_size.snapshot_scale < 1.f) {
+    dst_size_in_pixel = gfx::ScaleToRoundedSize(src_subrect_in_pixel.size(),
+                                                dst_size.snapshot_scale);
+    dst_size_in_pixel.SetToMax(gfx::Size(2, 2));
+  }
+  //ChromePic
 
   if (!using_browser_compositor_) {
     SynchronousCopyContents(src_subrect_in_pixel, dst_size_in_pixel, callback,
@@ -903,10 +924,7 @@ void RenderWidgetHostViewAndroid::CopyFromCompositingSurface(
     UMA_HISTOGRAM_TIMES("Compositing.CopyFromSurfaceTimeSynchronous",
                         base::TimeTicks::Now() - start_time);
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG RenderWidgetHostViewAndroid::CopyFromCompositingSurface: UNEXPECTED!";
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  FORENSIC_LOG(DEBUG) << "DEBUG RenderWidgetHostViewAndroid::CopyFromCompositingSurface: UNEXPECTED!";
   //ChromePic
     return;
   }
@@ -937,11 +955,14 @@ void RenderWidgetHostViewAndroid::CopyFromCompositingSurface(
   request->snapshot_id = dst_size.snapshot_id;
   request->event_id = output_size.event_id;
 
-  std::ostringstream ss;
-  ss << "DEBUG RenderWidgetHostViewAndroid::CopyFromCompositingSurface: " << "Process ID: " << dst_size.process_id << ", Routing ID: " << dst_size.routing_id << ", Snapshot ID: " 
+  FORENSIC_LOG(DEBUG) << "DEBUG RenderWidgetHostViewAndroid::CopyFromCompositingSurface: " << "Process ID: " << dst_size.process_id << ", Routing ID: " << dst_size.routing_id << ", Snapshot ID: " 
       << request->snapshot_id <<", Event ID: " << request->event_id;
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  if (request->snapshot_id != -1) {
+    JournalEntry journal_entry(JOURNAL_STAGE_SCREENSHOT_COPY_REQUEST);
+    SetJournalEventId(request->event_id, &journal_entry);
+    journal_entry.snapshot_id = request->snapshot_id;
+    EventJournal::Record(&journal_entry);
+  }
   //ChromePic
   readback_layer->RequestCopyOfOutput(std::move(request));
 }
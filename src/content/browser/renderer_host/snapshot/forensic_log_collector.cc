@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/forensic_log_collector.h"
+
+#include <sstream>
+
+#include "base/debug/forensic_log.h"
+#include "base/memory/shared_memory.h"
+#include "base/memory/singleton.h"
+#include "base/process/process_handle.h"
+#include "content/common/input_messages.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/browser/render_process_host.h"
+
+using base::debug::ForensicLogRing;
+using base::debug::ForensicLogSink;
+
+namespace content {
+
+namespace {
+
+// Per renderer. Lines that do not fit before the next drain are dropped and
+// counted.
+const uint32_t kProcessRingCapacity = 256 * 1024;
+
+}  // namespace
+
+struct ForensicLogCollector::ProcessRing {
+  base::SharedMemory memory;
+  scoped_ptr<ForensicLogRing> ring;
+};
+
+// static
+ForensicLogCollector* ForensicLogCollector::GetInstance() {
+  return base::Singleton<ForensicLogCollector>::get();
+}
+
+ForensicLogCollector::ForensicLogCollector() {}
+
+ForensicLogCollector::~ForensicLogCollector() {
+  for (const auto& entry : rings_) {
+    ForensicLogSink::GetInstance()->RemoveSource(entry.second->ring.get());
+    delete entry.second;
+  }
+}
+
+void ForensicLogCollector::AttachProcess(int process_id, int routing_id) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (rings_.find(process_id) != rings_.end())
+    return;
+  RenderProcessHost* host = RenderProcessHost::FromID(process_id);
+  if (!host || !host->HasConnection())
+    return;
+
+  size_t size = ForensicLogRing::RequiredSize(kProcessRingCapacity);
+  scoped_ptr<ProcessRing> process_ring(new ProcessRing);
+  if (!process_ring->memory.CreateAndMapAnonymous(size))
+    return;
+  base::SharedMemoryHandle handle;
+  if (!process_ring->memory.ShareToProcess(host->GetHandle(), &handle))
+    return;
+  process_ring->ring.reset(
+      new ForensicLogRing(process_ring->memory.memory(), size));
+  process_ring->ring->Initialize();
+
+  std::ostringstream prefix;
+  prefix << "[pid " << base::GetProcId(host->GetHandle()) << "] ";
+  ForensicLogSink::GetInstance()->AddSource(process_ring->ring.get(),
+                                            prefix.str());
+  host->Send(new InputMsg_AttachForensicLog(routing_id, handle,
+                                            static_cast<uint32_t>(size)));
+  host->AddObserver(this);
+  rings_[process_id] = process_ring.release();
+}
+
+void ForensicLogCollector::RenderProcessExited(RenderProcessHost* host,
+                                               base::TerminationStatus status,
+                                               int exit_code) {
+  // A relaunched renderer writes its lines to stderr itself until a
+  // SnapshotHandler attaches it again.
+  DetachProcess(host);
+}
+
+void ForensicLogCollector::RenderProcessHostDestroyed(RenderProcessHost* host) {
+  DetachProcess(host);
+}
+
+void ForensicLogCollector::DetachProcess(RenderProcessHost* host) {
+  auto it = rings_.find(host->GetID());
+  if (it == rings_.end())
+    return;
+  host->RemoveObserver(this);
+  ForensicLogSink::GetInstance()->RemoveSource(it->second->ring.get());
+  delete it->second;
+  rings_.erase(it);
+}
+
+}  // namespace content
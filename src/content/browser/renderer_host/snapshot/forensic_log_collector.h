@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_FORENSIC_LOG_COLLECTOR_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_FORENSIC_LOG_COLLECTOR_H_
+
+#include <map>
+
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "content/public/browser/render_process_host_observer.h"
+
+namespace base {
+template <typename T> struct DefaultSingletonTraits;
+class SharedMemory;
+namespace debug {
+class ForensicLogRing;
+}
+}
+
+namespace content {
+
+// Gives every renderer a shared-memory ring for its forensic log lines and
+// registers the ring with the browser's ForensicLogSink, so that the lines of
+// all processes are written by one thread. UI thread only.
+class ForensicLogCollector : public RenderProcessHostObserver {
+ public:
+  static ForensicLogCollector* GetInstance();
+
+  // Does nothing if the process already has a ring. |routing_id| is any
+  // route of the process's InputEventFilter.
+  void AttachProcess(int process_id, int routing_id);
+
+  // RenderProcessHostObserver:
+  void RenderProcessExited(RenderProcessHost* host,
+                           base::TerminationStatus status,
+                           int exit_code) override;
+  void RenderProcessHostDestroyed(RenderProcessHost* host) override;
+
+ private:
+  friend struct base::DefaultSingletonTraits<ForensicLogCollector>;
+
+  struct ProcessRing;
+
+  ForensicLogCollector();
+  ~ForensicLogCollector() override;
+
+  void DetachProcess(RenderProcessHost* host);
+
+  std::map<int, ProcessRing*> rings_;
+
+  DISALLOW_COPY_AND_ASSIGN(ForensicLogCollector);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_FORENSIC_LOG_COLLECTOR_H_
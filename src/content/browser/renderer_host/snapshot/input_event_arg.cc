@@ -7,11 +7,14 @@
  */
 
 
-#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "content/browser/renderer_host/snapshot/input_event_arg.h"
 
+#include "base/logging.h"
+#include "content/common/input/web_input_event_traits.h"
+
 
 using blink::WebGestureEvent;
 using blink::WebInputEvent;
@@ -23,22 +26,57 @@ using blink::WebTouchPoint;
 
 namespace content {
 
+InputEventArg::InputEventArg()
+    : input_event(NULL),
+      latency_info(NULL),
+      status(Ready),
+      is_snapshot_event(false),
+      screenshot_enabled(false),
+      screenshot_received(false),
+      dom_snapshot_enabled(false),
+      dom_snapshot_received(false),
+      snapshot_id(-1) {
+}
+
 InputEventArg::InputEventArg(const WebInputEvent& input_event_src, const ui::LatencyInfo& latency_info,
-            bool is_snapshot_event, bool screenshot_enabled, bool dom_snapshot_enabled, std::string event_id):
-            is_snapshot_event(is_snapshot_event),
-            screenshot_enabled(screenshot_enabled),
-            screenshot_received(false),
-            dom_snapshot_enabled(dom_snapshot_enabled),
-            dom_snapshot_received(false),
-            event_id(event_id) {
+            bool is_snapshot_event, bool screenshot_enabled, bool dom_snapshot_enabled,
+            const base::debug::SnapshotToken& event_id)
+    : input_event(NULL),
+      latency_info(NULL),
+      snapshot_id(-1) {
+    Reset(input_event_src, latency_info, is_snapshot_event, screenshot_enabled, dom_snapshot_enabled,
+          event_id);
+    //fprintf(stderr, "InputEventArg::Created InputEventArg\n");
+}
+
+void InputEventArg::Reset(const WebInputEvent& input_event_src, const ui::LatencyInfo& latency_info_src,
+            bool is_snapshot_event_param, bool screenshot_enabled_param, bool dom_snapshot_enabled_param,
+            const base::debug::SnapshotToken& event_id_param) {
+    Clear();
+    is_snapshot_event = is_snapshot_event_param;
+    screenshot_enabled = screenshot_enabled_param;
+    screenshot_received = false;
+    dom_snapshot_enabled = dom_snapshot_enabled_param;
+    dom_snapshot_received = false;
+    event_id = event_id_param;
     InputEventArg::CopyInputEvent(input_event_src);
-    InputEventArg::CopyLatencyInfo(latency_info);
+    InputEventArg::CopyLatencyInfo(latency_info_src);
     if (is_snapshot_event)
       status = Wait;
     else
       status = Ready;
     InputEventArg::UpdateStatus();
-    //fprintf(stderr, "InputEventArg::Created InputEventArg\n");
+}
+
+void InputEventArg::Clear() {
+    input_event = NULL;
+    latency_info = NULL;
+    status = Ready;
+    is_snapshot_event = false;
+    snapshot_id = -1;
+    event_id = base::debug::SnapshotToken();
+    readback_start_time = base::TimeTicks();
+    dom_snapshot_write_slot.reset();
 }
 
 void InputEventArg::SetSnapshotID(int snapshot_id_param) {
@@ -53,50 +91,19 @@ void InputEventArg::UpdateStatus() {
 }
 
 void InputEventArg::CopyInputEvent(const WebInputEvent& input_event_src) {
-    void* event_copy;
-    WebInputEvent::Type type = input_event_src.type;
-    if (WebInputEvent::isMouseEventType(type)) {
-      //fprintf(stderr, "InputEventArg: Mouse type\n");
-      event_copy = malloc(sizeof(WebMouseEvent));
-      memcpy(event_copy, &input_event_src, sizeof(WebMouseEvent));
-      input_event = static_cast<WebInputEvent*>(event_copy);
-    }
-    else if (type == WebInputEvent::MouseWheel){
-      //fprintf(stderr, "InputEventArg: MouseWheel type\n");
-      event_copy = malloc(sizeof(WebMouseWheelEvent));
-      memcpy(event_copy, &input_event_src, sizeof(WebMouseWheelEvent));
-      input_event = static_cast<WebInputEvent*>(event_copy);
-    }
-    else if (WebInputEvent::isKeyboardEventType(type)) {
-      //fprintf(stderr, "InputEventArg: Keyboard type\n");
-      event_copy = malloc(sizeof(WebKeyboardEvent));
-      memcpy(event_copy, &input_event_src, sizeof(WebKeyboardEvent));
-      input_event = static_cast<WebInputEvent*>(event_copy);
-    }
-    else if (WebInputEvent::isTouchEventType(type)) {
-      //fprintf(stderr, "InputEventArg: Touch type\n");
-      event_copy = malloc(sizeof(WebTouchEvent));
-      memcpy(event_copy, &input_event_src, sizeof(WebTouchEvent));
-      input_event = static_cast<WebInputEvent*>(event_copy);
-    }
-    else if (WebInputEvent::isGestureEventType(type)) {
-      //fprintf(stderr, "InputEventArg: Gesture type\n");
-      event_copy = malloc(sizeof(WebGestureEvent));
-      memcpy(event_copy, &input_event_src, sizeof(WebGestureEvent));
-      input_event = static_cast<WebInputEvent*>(event_copy);
-    }
+    size_t size = WebInputEventTraits::GetSize(input_event_src.type);
+    DCHECK_LE(size, sizeof(event_storage));
+    memcpy(event_storage.void_data(), &input_event_src, size);
+    input_event = event_storage.data_as<WebInputEvent>();
 }
 
 void InputEventArg::CopyLatencyInfo(const ui::LatencyInfo& latency_info_src) {
-        void* copy;
-        copy = malloc(sizeof(ui::LatencyInfo));
-        memcpy(copy, &latency_info_src, sizeof(ui::LatencyInfo));
-        latency_info = static_cast<ui::LatencyInfo*>(copy);
+    latency_info_storage = latency_info_src;
+    latency_info = &latency_info_storage;
 }
 
 InputEventArg::~InputEventArg(){
     //fprintf(stderr, "InputEventArg: In the destructor bruh!\n");
-    free(input_event);
-    free(latency_info);
+    Clear();
 }
 }
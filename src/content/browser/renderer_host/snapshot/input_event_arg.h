@@ -6,13 +6,26 @@
  *
  */
 
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_INPUT_EVENT_ARG_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_INPUT_EVENT_ARG_H_
 
+#include "base/debug/snapshot_token.h"
+#include "base/macros.h"
+#include "base/memory/aligned_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time/time.h"
+#include "content/browser/renderer_host/snapshot/snapshot_scheduler.h"
 #include "third_party/WebKit/public/web/WebInputEvent.h"
 #include "ui/events/latency_info.h"
 
 namespace content {
 
+// The copies of the event and its LatencyInfo live inside the object, so
+// reusing an InputEventArg (as PendingSnapshotTable does) allocates nothing
+// once its event_id and latency components have reached their usual size.
 struct InputEventArg{
+   // Point into |event_storage| and |latency_info_storage|, or NULL when the
+   // entry is unused.
    blink::WebInputEvent* input_event;
    ui::LatencyInfo* latency_info;
 
@@ -25,15 +38,49 @@ struct InputEventArg{
    bool dom_snapshot_enabled; 
    bool dom_snapshot_received;
    int snapshot_id;
-   std::string event_id;
+   base::debug::SnapshotToken event_id;
+   // When SnapshotHandler asked for the snapshot, to measure its cost.
+   base::TimeTicks requested_time;
+   // When the SnapshotScheduler granted the screenshot its readback slot.
+   // Null until then.
+   base::TimeTicks readback_start_time;
+   // Counts the renderer's DOM snapshot file against the browser's writes
+   // until the snapshot is acknowledged or dropped.
+   scoped_ptr<SnapshotScheduler::Slot> dom_snapshot_write_slot;
 
+   // An empty entry, filled in later with Reset(). Used for the preallocated
+   // slots of PendingSnapshotTable.
+   InputEventArg();
    InputEventArg(const blink::WebInputEvent& input_event, const ui::LatencyInfo& latency_info,
-       bool is_snapshot_event, bool screenshot_enabled, bool dom_snapshot_enabled, std::string event_id);
+       bool is_snapshot_event, bool screenshot_enabled, bool dom_snapshot_enabled,
+       const base::debug::SnapshotToken& event_id);
    ~InputEventArg();
+   void Reset(const blink::WebInputEvent& input_event, const ui::LatencyInfo& latency_info,
+       bool is_snapshot_event, bool screenshot_enabled, bool dom_snapshot_enabled,
+       const base::debug::SnapshotToken& event_id);
+   // Drops the event copies and marks the entry as unused.
+   void Clear();
    void SetSnapshotID(int snapshot_id);
    void UpdateStatus();
    void CopyInputEvent(const blink::WebInputEvent& input_event_src);
    void CopyLatencyInfo(const ui::LatencyInfo& latency_info_src);
+
+ private:
+   // Sized for the largest WebInputEvent subtype.
+   union LargestInputEvent {
+     char mouse[sizeof(blink::WebMouseEvent)];
+     char mouse_wheel[sizeof(blink::WebMouseWheelEvent)];
+     char keyboard[sizeof(blink::WebKeyboardEvent)];
+     char touch[sizeof(blink::WebTouchEvent)];
+     char gesture[sizeof(blink::WebGestureEvent)];
+   };
+   base::AlignedMemory<sizeof(LargestInputEvent), 8> event_storage;
+   // Copy-assigned, which reuses the storage of its components.
+   ui::LatencyInfo latency_info_storage;
+
+   DISALLOW_COPY_AND_ASSIGN(InputEventArg);
 };
 
 }
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_INPUT_EVENT_ARG_H_
@@ -12,15 +12,14 @@
 #include <sstream>
 
 #include "content/browser/renderer_host/snapshot/logger.h"
+#include "base/debug/forensic_log.h"
 #include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
-#include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/time/time.h"
+#include "content/common/snapshot/event_journal.h"
 #include "content/public/browser/browser_thread.h"
-#if defined(OS_ANDROID)
-#include <android/log.h>
-#endif
 
 using content::BrowserThread;
 using base::FilePath;
@@ -30,21 +29,31 @@ using base::Time;
 
 namespace content {
 
-Logger::Logger(std::string name) {
+namespace {
 
-        #if defined(OS_ANDROID)
-            PathService::Get(base::DIR_ANDROID_EXTERNAL_STORAGE,&file_path);
-            file_path = file_path.Append(FILE_PATH_LITERAL("Download"));
-        #else
-            PathService::Get(base::DIR_HOME, &file_path);
-        #endif
+// Pending lines are written out past this size, so memory stays bounded no
+// matter how long the session runs.
+const size_t kFlushBytes = 64 * 1024;
+const int kFlushIntervalMs = 1000;
+const int64_t kDefaultMaxFileBytes = 64 * 1024 * 1024;
+const int kMaxRotatedFiles = 4;
 
-        file_path = file_path.Append(FILE_PATH_LITERAL("snapshot_logs"));
-        File::Error error;
-        if (!base::CreateDirectoryAndGetError(file_path, &error)){
-            fprintf(stderr, "Error in creating an output directory for snapshot logs!\n");
-            return;
-        }
+FilePath RotatedPath(const FilePath& path, int index) {
+    return FilePath::FromUTF8Unsafe(path.AsUTF8Unsafe() + "." + base::IntToString(index));
+}
+
+}  // namespace
+
+FilePath Logger::GetLogDirectory() {
+        return GetSnapshotLogDirectory();
+}
+
+Logger::Logger(std::string name)
+    : file_bytes_(0),
+      max_file_bytes_(kDefaultMaxFileBytes) {
+
+        // Loggers are created on the UI thread, so the directory is only
+        // created by the first write.
         //std::stringstream ss;
         //ss << tab_id; 
         //std::string tab_id_string = ss.str() + suffix + ".txt";
@@ -57,55 +66,85 @@ Logger::Logger(std::string name) {
                << exploded_now.hour << "_" << exploded_now.minute << "_" << exploded_now.second << ".txt";
             name = ss.str();
         }
-
-        #if defined(OS_POSIX)
-            file_path = file_path.Append(name);
-        #elif defined(OS_WIN)
-            std::wstring name_wstring(name.begin(), name.end());
-            file_path = file_path.Append(name_wstring);
-        #endif
+        file_name_ = name;
         //fprintf(stderr, "Created logger!! %s\n", name.c_str());
 }
 
 Logger::~Logger(){
+        WritePending();
         fprintf(stderr, "Killing logger!! %s\n", file_path.value().c_str());
 }
 
 void Logger::LogLine(std::string log_string, bool add_time, bool flush){
+    pending_ += log_string;
     if (add_time){
         int64_t us = TimeTicks::Now().ToInternalValue();
-        log_stream << log_string << ",\tTime: " << us << "\n";
+        pending_ += ",\tTime: " + std::to_string(us);
     }
-    else
-        log_stream << log_string << "\n"; 
+    pending_ += "\n";
+
+    if (flush || pending_.size() >= kFlushBytes ||
+        TimeTicks::Now() - last_write_ >= base::TimeDelta::FromMilliseconds(kFlushIntervalMs))
+        WritePending();
+}
+
+void Logger::WritePending(){
+    if (pending_.empty())
+        return;
+    if (!file_name_.empty()) {
+        file_path = GetLogDirectory();
+        if (!file_path.empty()) {
+            #if defined(OS_POSIX)
+                file_path = file_path.Append(file_name_);
+            #elif defined(OS_WIN)
+                std::wstring name_wstring(file_name_.begin(), file_name_.end());
+                file_path = file_path.Append(name_wstring);
+            #endif
+        }
+        file_name_.clear();
+    }
+    if (file_path.empty()) {
+        pending_.clear();
+        return;
+    }
+
+    if (!file_.IsValid()) {
+        file_.Initialize(file_path, File::FLAG_OPEN_ALWAYS | File::FLAG_APPEND);
+        file_bytes_ = file_.IsValid() ? file_.GetLength() : 0;
+    }
+    if (max_file_bytes_ > 0 && file_bytes_ > 0 &&
+        file_bytes_ + static_cast<int64_t>(pending_.size()) > max_file_bytes_)
+        Rotate();
 
-    if (flush){
-    const std::string tmp = log_stream.str();
-    const char* cstr = tmp.c_str();
-    int ret = base::WriteFile(file_path, cstr, strlen(cstr));
+    // On failure the lines are dropped rather than kept: holding them would
+    // make memory grow with the session again.
+    int ret = file_.IsValid() ? file_.WriteAtCurrentPos(pending_.data(), pending_.size()) : -1;
     if (ret < 0)
         fprintf(stderr, "Failure in writing to file!!\n");
-    }
+    else
+        file_bytes_ += ret;
+    pending_.clear();
+    last_write_ = TimeTicks::Now();
 }
 
-void Logger::LogLineScreen(std::string log_string, bool add_time){
-    std::stringstream log_stream_screen;
-    if (add_time){
-        int64_t us = TimeTicks::Now().ToInternalValue();
-        log_stream_screen << log_string << ",\tTime: " << us << "\n";
+void Logger::Rotate(){
+    file_.Close();
+    for (int i = kMaxRotatedFiles - 1; i >= 1; --i) {
+        if (base::PathExists(RotatedPath(file_path, i)))
+            base::ReplaceFile(RotatedPath(file_path, i), RotatedPath(file_path, i + 1), NULL);
     }
-    else
-        log_stream_screen << log_string << "\n"; 
-    fprintf(stderr, "%s", log_stream_screen.str().c_str());
-    #if defined(OS_ANDROID)
-      va_list args;
-      __android_log_vprint(ANDROID_LOG_WARN, "Forensics", log_stream_screen.str().c_str(),args);
-    #endif
+    base::ReplaceFile(file_path, RotatedPath(file_path, 1), NULL);
+    file_.Initialize(file_path, File::FLAG_CREATE_ALWAYS | File::FLAG_APPEND);
+    file_bytes_ = 0;
+}
 
- }
+void Logger::LogLineScreen(std::string log_string, bool add_time){
+    base::debug::WriteForensicLog(base::debug::FORENSIC_LOG_CATEGORY_SNAPSHOT,
+                                  log_string, add_time);
+}
 
 void Logger::Flush(){
-    if (!log_stream.str().size())
+    if (pending_.empty() && !file_.IsValid())
         return;
 
     bool high_res = TimeTicks::IsHighResolution();
@@ -114,11 +153,7 @@ void Logger::Flush(){
     else
         LogLine("High resolution clock was not available!");
 
-    const std::string tmp = log_stream.str();
-    const char* cstr = tmp.c_str();
-    int ret = base::WriteFile(file_path, cstr, strlen(cstr));
-    if (ret < 0)
-        fprintf(stderr, "Failure in writing to file!!\n");
+    WritePending();
     fprintf(stderr, "done flushing for file:%s\n", file_path.value().c_str());
 }
 }  //namespace content
@@ -7,22 +7,49 @@
  */
 
 
+#include <stdint.h>
+
+#include <string>
+
+#include "base/files/file.h"
 #include "base/files/file_path.h"
+#include "base/time/time.h"
 
 namespace content {
 
+// LogLine() appends to snapshot_logs/<name>. Lines are batched in memory and
+// appended to an open file once kFlushBytes have accumulated, a second has
+// passed since the last write, or a caller asks for a flush; nothing already
+// written is held or rewritten. Past the maximum file size the file is rotated
+// to <name>.1 ... <name>.<kMaxRotatedFiles>.
 class Logger {
  public:
   Logger(std::string name="");
   ~Logger();
+  // Writes to the forensic log (stderr, gathered in the browser), see
+  // base/debug/forensic_log.h.
   static void LogLineScreen(std::string log_string, bool add_time=false);
+  // Creates snapshot_logs if needed. Empty on failure.
+  static base::FilePath GetLogDirectory();
   void LogLine(std::string log_stream, bool add_time=false, bool flush=false);
   void Flush();
 
-  std::stringstream log_stream;
+  // --snapshot-log-max-bytes. 0 never rotates.
+  void set_max_file_bytes(int64_t max_file_bytes) { max_file_bytes_ = max_file_bytes; }
+  int64_t max_file_bytes() const { return max_file_bytes_; }
 
  private:
+  void WritePending();
+  void Rotate();
+
+  // Set until the first write resolves it into |file_path|.
+  std::string file_name_;
   base::FilePath file_path;
+  base::File file_;
+  std::string pending_;
+  base::TimeTicks last_write_;
+  int64_t file_bytes_;
+  int64_t max_file_bytes_;
 
 };
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/pending_snapshot_table.h"
+
+#include <sstream>
+
+#include "base/logging.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
+
+namespace content {
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t power = 1;
+  while (power < value)
+    power <<= 1;
+  return power;
+}
+
+}  // namespace
+
+PendingSnapshotTable::PendingSnapshotTable(size_t capacity)
+    : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+      size_(0),
+      evicted_(0) {
+  slots_.reset(new InputEventArg[mask_ + 1]);
+}
+
+PendingSnapshotTable::~PendingSnapshotTable() {
+}
+
+InputEventArg* PendingSnapshotTable::Add(int snapshot_id,
+                                         const blink::WebInputEvent& input_event,
+                                         const ui::LatencyInfo& latency_info,
+                                         bool screenshot_enabled,
+                                         bool dom_snapshot_enabled,
+                                         const base::debug::SnapshotToken& event_id) {
+  DCHECK_GE(snapshot_id, 0);
+  InputEventArg& slot = Slot(snapshot_id);
+  if (slot.snapshot_id != -1) {
+    std::ostringstream log_stream;
+    log_stream << "PendingSnapshotTable:: Evicting incomplete snapshot, Snapshot ID: " << slot.snapshot_id
+               << ", Event ID: " << slot.event_id << ", Screenshot received: " << slot.screenshot_received
+               << ", DOM snapshot received: " << slot.dom_snapshot_received;
+    Logger::LogLineScreen(log_stream.str(), true);
+    evicted_++;
+    size_--;
+  }
+  slot.Reset(input_event, latency_info, true, screenshot_enabled, dom_snapshot_enabled, event_id);
+  slot.SetSnapshotID(snapshot_id);
+  size_++;
+  return &slot;
+}
+
+InputEventArg* PendingSnapshotTable::Find(int snapshot_id) {
+  if (snapshot_id < 0)
+    return NULL;
+  InputEventArg& slot = Slot(snapshot_id);
+  return slot.snapshot_id == snapshot_id ? &slot : NULL;
+}
+
+void PendingSnapshotTable::RemoveIfComplete(int snapshot_id) {
+  InputEventArg* entry = Find(snapshot_id);
+  if (!entry || entry->status != InputEventArg::Ready)
+    return;
+  entry->Clear();
+  size_--;
+}
+
+void PendingSnapshotTable::Clear() {
+  for (size_t i = 0; i <= mask_; i++)
+    slots_[i].Clear();
+  size_ = 0;
+}
+
+}  // namespace content
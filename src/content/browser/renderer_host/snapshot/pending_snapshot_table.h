@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_PENDING_SNAPSHOT_TABLE_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_PENDING_SNAPSHOT_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "content/browser/renderer_host/snapshot/input_event_arg.h"
+
+namespace content {
+
+// Tracks the snapshot events of a tab until both their screenshot and DOM
+// snapshot are in. Snapshot IDs are handed out sequentially, so the table is a
+// ring of preallocated slots indexed by snapshot ID: lookups are O(1) and
+// nothing is allocated per event. A snapshot still pending |capacity| IDs
+// later is evicted to make room.
+class PendingSnapshotTable {
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit PendingSnapshotTable(size_t capacity);
+  ~PendingSnapshotTable();
+
+  // Starts tracking |snapshot_id|, evicting the entry in its slot if any.
+  InputEventArg* Add(int snapshot_id,
+                     const blink::WebInputEvent& input_event,
+                     const ui::LatencyInfo& latency_info,
+                     bool screenshot_enabled,
+                     bool dom_snapshot_enabled,
+                     const base::debug::SnapshotToken& event_id);
+
+  // Returns NULL if |snapshot_id| is not (or no longer) tracked.
+  InputEventArg* Find(int snapshot_id);
+
+  // Stops tracking |snapshot_id| if all of its parts have been received.
+  void RemoveIfComplete(int snapshot_id);
+
+  // Stops tracking every snapshot, e.g. when the widget goes away.
+  void Clear();
+
+  size_t size() const { return size_; }
+  int64_t evicted() const { return evicted_; }
+
+ private:
+  InputEventArg& Slot(int snapshot_id) {
+    return slots_[static_cast<size_t>(snapshot_id) & mask_];
+  }
+
+  scoped_ptr<InputEventArg[]> slots_;
+  size_t mask_;
+  size_t size_;
+  int64_t evicted_;
+
+  DISALLOW_COPY_AND_ASSIGN(PendingSnapshotTable);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_PENDING_SNAPSHOT_TABLE_H_
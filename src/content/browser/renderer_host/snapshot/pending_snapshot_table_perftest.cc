@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/time/time.h"
+#include "content/browser/renderer_host/snapshot/pending_snapshot_table.h"
+#include "content/common/input/web_input_event_traits.h"
+#include "content/test/allocation_counter.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+using blink::WebInputEvent;
+using blink::WebMouseEvent;
+using blink::WebTouchEvent;
+using blink::WebTouchPoint;
+
+namespace content {
+
+namespace {
+
+const size_t kTableSize = 64;
+const int kLaps = 2000;
+
+ui::LatencyInfo CreateLatencyInfo(int64_t trace_id) {
+  ui::LatencyInfo latency;
+  latency.set_trace_id(trace_id);
+  base::TimeTicks now = base::TimeTicks::Now();
+  latency.AddLatencyNumberWithTimestamp(
+      ui::INPUT_EVENT_LATENCY_ORIGINAL_COMPONENT, 0, 0, now, 1);
+  latency.AddLatencyNumberWithTimestamp(
+      ui::INPUT_EVENT_LATENCY_UI_COMPONENT, 0, 0, now, 1);
+  latency.AddLatencyNumberWithTimestamp(
+      ui::INPUT_EVENT_LATENCY_BEGIN_RWH_COMPONENT, 0, trace_id, now, 1);
+  return latency;
+}
+
+// Event IDs of one tab and page; only the trace ID differs.
+base::debug::SnapshotToken CreateEventID(int64_t trace_id) {
+  return base::debug::SnapshotToken(0x1508268556123456, 1, trace_id);
+}
+
+WebMouseEvent CreateMouseMove(int i) {
+  WebMouseEvent mouse;
+  mouse.type = WebInputEvent::MouseMove;
+  mouse.x = mouse.windowX = mouse.globalX = i % 800;
+  mouse.y = mouse.windowY = mouse.globalY = i % 600;
+  return mouse;
+}
+
+WebTouchEvent CreateTouchMove(int i) {
+  WebTouchEvent touch;
+  touch.type = WebInputEvent::TouchMove;
+  touch.touchesLength = 2;
+  for (unsigned j = 0; j < touch.touchesLength; ++j) {
+    touch.touches[j].id = j;
+    touch.touches[j].state = WebTouchPoint::StateMoved;
+    touch.touches[j].position = blink::WebFloatPoint(i % 800, (i + j) % 600);
+  }
+  return touch;
+}
+
+void PrintTime(const char* trace, const char* test_name, base::TimeDelta total,
+               int64_t event_count) {
+  perf_test::PrintResult(
+      trace, "", test_name,
+      static_cast<size_t>(total.InNanoseconds() / event_count), "ns", true);
+}
+
+// Streams events through the table the way SnapshotHandler does and checks
+// that, after the first lap has sized every slot, tracking an event makes no
+// heap allocation: the event, LatencyInfo and event ID are copied into
+// storage the slot already owns.
+template <typename Event>
+void RunStream(const char* test_name, Event (*create_event)(int)) {
+  PendingSnapshotTable table(kTableSize);
+  std::vector<Event> events;
+  std::vector<ui::LatencyInfo> latencies;
+  std::vector<base::debug::SnapshotToken> event_ids;
+  std::vector<std::string> event_id_strings;
+  for (size_t i = 0; i < kTableSize; ++i) {
+    events.push_back(create_event(i));
+    latencies.push_back(CreateLatencyInfo(1000000 + i));
+    event_ids.push_back(CreateEventID(1000000 + i));
+    event_id_strings.push_back(event_ids[i].ToString());
+  }
+
+  // Warm-up lap.
+  int snapshot_id = 0;
+  for (size_t i = 0; i < kTableSize; ++i, ++snapshot_id) {
+    InputEventArg* entry = table.Add(snapshot_id, events[i], latencies[i],
+                                     true, true, event_ids[i]);
+    entry->screenshot_received = true;
+    entry->dom_snapshot_received = true;
+    entry->UpdateStatus();
+    table.RemoveIfComplete(snapshot_id);
+  }
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int lap = 0; lap < kLaps; ++lap) {
+    for (size_t i = 0; i < kTableSize; ++i, ++snapshot_id) {
+      InputEventArg* entry = table.Add(snapshot_id, events[i], latencies[i],
+                                       true, true, event_ids[i]);
+      entry->screenshot_received = true;
+      entry->dom_snapshot_received = true;
+      entry->UpdateStatus();
+      table.RemoveIfComplete(snapshot_id);
+    }
+  }
+  base::TimeDelta table_time = base::TimeTicks::Now() - start;
+
+  // One more lap with the allocator hook on, kept out of the timing.
+  bool counting = StartCountingAllocations();
+  for (size_t i = 0; i < kTableSize; ++i, ++snapshot_id) {
+    InputEventArg* entry = table.Add(snapshot_id, events[i], latencies[i],
+                                     true, true, event_ids[i]);
+    entry->screenshot_received = true;
+    entry->dom_snapshot_received = true;
+    entry->UpdateStatus();
+    table.RemoveIfComplete(snapshot_id);
+  }
+  int allocations = StopCountingAllocations();
+  if (counting) {
+    EXPECT_EQ(0, allocations);
+  } else {
+    LOG(WARNING) << "Allocations cannot be counted without tcmalloc; not "
+                    "checking that adding an event does not allocate.";
+  }
+
+  for (size_t i = 0; i < kTableSize; ++i) {
+    InputEventArg* entry = table.Add(snapshot_id + i, events[i], latencies[i],
+                                     true, true, event_ids[i]);
+    EXPECT_EQ(event_ids[i], entry->event_id);
+    EXPECT_EQ(0, memcmp(&events[i], entry->input_event, sizeof(Event)));
+    EXPECT_EQ(latencies[i].trace_id(), entry->latency_info->trace_id());
+  }
+  EXPECT_EQ(0, table.evicted());
+
+  // What every event used to cost: heap copies of the event, LatencyInfo and
+  // event ID string.
+  start = base::TimeTicks::Now();
+  for (int lap = 0; lap < kLaps; ++lap) {
+    for (size_t i = 0; i < kTableSize; ++i) {
+      void* event_copy = malloc(sizeof(Event));
+      memcpy(event_copy, &events[i], sizeof(Event));
+      ui::LatencyInfo* latency_copy = new ui::LatencyInfo(latencies[i]);
+      std::string* event_id_copy = new std::string(event_id_strings[i]);
+      delete event_id_copy;
+      delete latency_copy;
+      free(event_copy);
+    }
+  }
+  base::TimeDelta heap_time = base::TimeTicks::Now() - start;
+
+  const int64_t event_count = static_cast<int64_t>(kLaps) * kTableSize;
+  PrintTime("avg_time_per_event", test_name, table_time, event_count);
+  PrintTime("avg_time_per_event_heap_copy", test_name, heap_time, event_count);
+}
+
+}  // namespace
+
+TEST(PendingSnapshotTablePerfTest, MouseMoveStream) {
+  RunStream("MouseMoveStream", &CreateMouseMove);
+}
+
+TEST(PendingSnapshotTablePerfTest, TouchMoveStream) {
+  RunStream("TouchMoveStream", &CreateTouchMove);
+}
+
+}  // namespace content
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/resource_store.h"
+
+#include <sstream>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/files/file.h"
+#include "base/files/file_util.h"
+#include "base/memory/singleton.h"
+#include "base/path_service.h"
+#include "base/single_thread_task_runner.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/thread_task_runner_handle.h"
+#include "base/time/time.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/public/browser/browser_thread.h"
+#include "crypto/sha2.h"
+
+using base::FilePath;
+using base::File;
+using base::Time;
+
+namespace content {
+
+SnapshotResourceStore* SnapshotResourceStore::GetInstance() {
+    return base::Singleton<SnapshotResourceStore>::get();
+}
+
+SnapshotResourceStore::SnapshotResourceStore()
+    : stored_bytes_(0),
+      duplicate_bytes_(0) {
+        #if defined(OS_ANDROID)
+            PathService::Get(base::DIR_ANDROID_EXTERNAL_STORAGE, &directory_);
+            directory_ = directory_.Append(FILE_PATH_LITERAL("Download"));
+        #else
+            PathService::Get(base::DIR_HOME, &directory_);
+        #endif
+
+        directory_ = directory_.Append(FILE_PATH_LITERAL("dom_snapshots"))
+                               .Append(FILE_PATH_LITERAL("resources"));
+
+        // One store per browsing session.
+        Time::Exploded exploded_now;
+        Time::Now().LocalExplode(&exploded_now);
+        std::stringstream ss;
+        ss << exploded_now.day_of_month << "_" << exploded_now.month << "_" << exploded_now.year << "__"
+           << exploded_now.hour << "_" << exploded_now.minute << "_" << exploded_now.second;
+        #if defined(OS_POSIX)
+            directory_ = directory_.Append(ss.str());
+        #elif defined(OS_WIN)
+            std::string session_name = ss.str();
+            directory_ = directory_.Append(std::wstring(session_name.begin(), session_name.end()));
+        #endif
+}
+
+SnapshotResourceStore::~SnapshotResourceStore() {
+}
+
+void SnapshotResourceStore::Store(const std::string& digest,
+                                  const std::vector<char>& data,
+                                  const base::Closure& failed_callback) {
+    scoped_ptr<std::vector<char>> data_copy(new std::vector<char>(data));
+    BrowserThread::PostTask(BrowserThread::FILE, FROM_HERE,
+            base::Bind(&SnapshotResourceStore::StoreAndReply,
+                       base::Unretained(this), digest, base::Passed(&data_copy),
+                       base::ThreadTaskRunnerHandle::Get(), failed_callback));
+}
+
+void SnapshotResourceStore::StoreAndReply(
+        const std::string& digest,
+        scoped_ptr<std::vector<char>> data,
+        scoped_refptr<base::SingleThreadTaskRunner> reply_task_runner,
+        const base::Closure& failed_callback) {
+    if (!StoreOnFileThread(digest, std::move(data)))
+        reply_task_runner->PostTask(FROM_HERE, failed_callback);
+}
+
+bool SnapshotResourceStore::StoreOnFileThread(const std::string& digest,
+                                              scoped_ptr<std::vector<char>> data) {
+    DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+    std::ostringstream log_stream;
+
+    // The digest names a file, so never trust the renderer's value.
+    std::string actual_digest = base::ToLowerASCII(base::HexEncode(
+        crypto::SHA256HashString(std::string(data->begin(), data->end())).data(),
+        crypto::kSHA256Length));
+    if (actual_digest != digest) {
+        log_stream << "SnapshotResourceStore:: Digest mismatch, dropping resource: " << digest;
+        Logger::LogLineScreen(log_stream.str(), true);
+        return false;
+    }
+
+    if (stored_digests_.count(digest)) {
+        duplicate_bytes_ += data->size();
+        return true;
+    }
+
+    // Created on demand, so that a failure is retried by the next store.
+    File::Error error;
+    if (!base::DirectoryExists(directory_) &&
+        !base::CreateDirectoryAndGetError(directory_, &error)) {
+        Logger::LogLineScreen("SnapshotResourceStore:: Error in creating the resource directory!", true);
+        return false;
+    }
+
+    FilePath path = directory_.AppendASCII(digest);
+    const int size = static_cast<int>(data->size());
+    if (!base::PathExists(path) &&
+        base::WriteFile(path, data->data(), size) != size) {
+        base::DeleteFile(path, false);
+        log_stream << "SnapshotResourceStore:: Failure in writing resource: " << digest;
+        Logger::LogLineScreen(log_stream.str(), true);
+        return false;
+    }
+    stored_digests_.insert(digest);
+    stored_bytes_ += data->size();
+
+    log_stream << "SnapshotResourceStore:: Stored resource: " << digest << ", Size: " << data->size()
+               << ", # Resources: " << stored_digests_.size() << ", Stored bytes: " << stored_bytes_
+               << ", Duplicate bytes: " << duplicate_bytes_;
+    Logger::LogLineScreen(log_stream.str(), true);
+    return true;
+}
+
+}  // namespace content
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_RESOURCE_STORE_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_RESOURCE_STORE_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/callback_forward.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+
+namespace base {
+class SingleThreadTaskRunner;
+template <typename T> struct DefaultSingletonTraits;
+}
+
+namespace content {
+
+// Content-addressed store for DOM snapshot subresources (images, CSS, fonts)
+// shared by all tabs of a browsing session. Each resource is written once to
+// <dom_snapshots>/resources/<session>/<sha256>, and the MHTML files reference
+// it by that digest (see WebFrameSerializer::generateMHTMLResourceReference).
+class SnapshotResourceStore {
+ public:
+  static SnapshotResourceStore* GetInstance();
+
+  // Can be called from any thread; hashing and the write happen on the FILE
+  // thread. |digest| comes from the renderer and is verified before use.
+  // |failed_callback| runs on the calling thread if the resource could not
+  // be stored.
+  void Store(const std::string& digest, const std::vector<char>& data,
+             const base::Closure& failed_callback);
+
+ private:
+  friend struct base::DefaultSingletonTraits<SnapshotResourceStore>;
+
+  SnapshotResourceStore();
+  ~SnapshotResourceStore();
+
+  // Returns false if the resource was not stored.
+  bool StoreOnFileThread(const std::string& digest,
+                         scoped_ptr<std::vector<char>> data);
+  void StoreAndReply(const std::string& digest,
+                     scoped_ptr<std::vector<char>> data,
+                     scoped_refptr<base::SingleThreadTaskRunner> reply_task_runner,
+                     const base::Closure& failed_callback);
+
+  base::FilePath directory_;
+
+  // Only used on the FILE thread. Digests are only added once their file is
+  // written.
+  std::set<std::string> stored_digests_;
+  int64_t stored_bytes_;
+  int64_t duplicate_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotResourceStore);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_RESOURCE_STORE_H_
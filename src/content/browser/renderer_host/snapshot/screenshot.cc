@@ -8,28 +8,504 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
 #include <string>
 #include <sstream>
+#include <utility>
 
 
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/command_line.h"
+#include "base/debug/forensic_log.h"
 #include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
+#include "base/hash.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
 #include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "base/sys_info.h"
+#include "base/thread_task_runner_handle.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/time/time.h"
 #include "base/trace_event/trace_event.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
 #include "content/browser/renderer_host/snapshot/screenshot.h"
+#include "content/browser/renderer_host/snapshot/screenshot_buffer_pool.h"
+#include "content/browser/renderer_host/snapshot/snapshot_archive.h"
+#include "content/common/snapshot/event_journal.h"
 #include "content/public/browser/browser_thread.h"
+#include "third_party/libwebp/webp/encode.h"
 #include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/snappy/src/snappy.h"
+#include "third_party/zlib/zlib.h"
 #include "ui/gfx/codec/png_codec.h"
+#include "ui/gfx/geometry/size.h"
 
 using content::BrowserThread;
+using content::Logger;
+using content::ScreenshotBufferPool;
+using content::ScreenshotOutputBuffer;
+using content::SnapshotScheduler;
 using base::FilePath;
 using base::File;
 using base::Time;
+using base::TimeTicks;
 
-void PrintScreenshot(const SkBitmap& bitmap, std::string output_directory_name, const int snapshot_id) {
-        TRACE_EVENT_BEGIN1("forensics", "PrintScreenshot: Begin", "snapshot ID", snapshot_id);
+namespace {
+
+const char* const kScreenshotFormatNames[] = {"png", "fast-png", "webp", "raw"};
+const char* const kScreenshotFileExtensions[] = {".png", ".png", ".webp", ".raw"};
+const int kNumScreenshotFormats = arraysize(kScreenshotFormatNames);
+
+// Side of the square tiles used for dedup signatures and tile deltas.
+const int kTileSize = 64;
+// Number of recent distinct screenshots of a tab a new one is compared with.
+const size_t kDedupHistorySize = 8;
+
+// Per-tile checksums of a screenshot.
+struct ScreenshotSignature {
+  int snapshot_id;
+  int width;
+  int height;
+  std::vector<uint32_t> tile_hashes;
+};
+
+void ComputeSignature(const SkBitmap& bitmap, int snapshot_id, ScreenshotSignature* signature) {
+  SkAutoLockPixels lock(bitmap);
+  signature->snapshot_id = snapshot_id;
+  signature->width = bitmap.width();
+  signature->height = bitmap.height();
+  const int tiles_x = (bitmap.width() + kTileSize - 1) / kTileSize;
+  const int tiles_y = (bitmap.height() + kTileSize - 1) / kTileSize;
+  signature->tile_hashes.assign(tiles_x * tiles_y, 0);
+  if (!bitmap.getPixels())
+    return;
+
+  const char* pixels = reinterpret_cast<const char*>(bitmap.getPixels());
+  const int bytes_per_pixel = bitmap.bytesPerPixel();
+  for (int y = 0; y < bitmap.height(); y++) {
+    const char* row = pixels + y * bitmap.rowBytes();
+    uint32_t* tile_hash = &signature->tile_hashes[(y / kTileSize) * tiles_x];
+    for (int x = 0; x < bitmap.width(); x += kTileSize, tile_hash++) {
+      int width = std::min(kTileSize, bitmap.width() - x);
+      *tile_hash = *tile_hash * 31 + base::Hash(row + x * bytes_per_pixel, width * bytes_per_pixel);
+    }
+  }
+}
+
+// Returns the number of tiles that differ, or INT_MAX if the sizes differ.
+int CountChangedTiles(const ScreenshotSignature& a, const ScreenshotSignature& b) {
+  if (a.width != b.width || a.height != b.height)
+    return std::numeric_limits<int>::max();
+  int changed_tiles = 0;
+  for (size_t i = 0; i < a.tile_hashes.size(); i++) {
+    if (a.tile_hashes[i] != b.tile_hashes[i])
+      changed_tiles++;
+  }
+  return changed_tiles;
+}
+
+// Running totals for one output format.
+struct EncodeStats {
+  EncodeStats() : count(0), encode_us(0), bytes(0), raw_bytes(0) {}
+  int count;
+  int64_t encode_us;
+  int64_t bytes;
+  int64_t raw_bytes;
+};
+
+// Worker pool shared by the screenshots of all tabs. Tasks are unsequenced,
+// so back-to-back screenshots encode in parallel.
+class ScreenshotEncoderPool {
+ public:
+  ScreenshotEncoderPool() : dedup_checked_(0), dedup_hits_(0) {
+    int num_threads = base::SysInfo::NumberOfProcessors();
+    const base::CommandLine& command_line = *base::CommandLine::ForCurrentProcess();
+    if (command_line.HasSwitch("screenshot-encoder-threads")) {
+      int threads;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("screenshot-encoder-threads"), &threads) &&
+          threads > 0)
+        num_threads = threads;
+    }
+    pool_ = new base::SequencedWorkerPool(num_threads, "ChromePicScreenshotEncoder");
+    // Screenshots still being encoded at shutdown are lost anyway.
+    task_runner_ = pool_->GetTaskRunnerWithShutdownBehavior(
+        base::SequencedWorkerPool::CONTINUE_ON_SHUTDOWN);
+
+    std::ostringstream log_stream;
+    log_stream << "ScreenshotEncoderPool:: Threads: " << num_threads;
+    Logger::LogLineScreen(log_stream.str(), true);
+  }
+
+  const scoped_refptr<base::TaskRunner>& task_runner() const {
+    return task_runner_;
+  }
+
+  // Returns the snapshot ID of a recently written screenshot of the same tab
+  // that |signature| matches, or 0.
+  int FindDuplicate(const std::string& output_directory_name,
+                    const ScreenshotSignature& signature,
+                    int max_changed_tiles) {
+    int duplicate_of = 0;
+    int changed_tiles = 0;
+    int checked, hits;
+    {
+      base::AutoLock lock(lock_);
+      std::deque<ScreenshotSignature>& history = dedup_history_[output_directory_name];
+      for (auto it = history.rbegin(); it != history.rend(); ++it) {
+        changed_tiles = CountChangedTiles(signature, *it);
+        if (changed_tiles <= max_changed_tiles) {
+          duplicate_of = it->snapshot_id;
+          break;
+        }
+      }
+      checked = ++dedup_checked_;
+      hits = duplicate_of ? ++dedup_hits_ : dedup_hits_;
+    }
+
+    if (duplicate_of) {
+      std::ostringstream log_stream;
+      log_stream << "ScreenshotEncoderPool:: Duplicate screenshot, Snapshot ID: " << signature.snapshot_id
+                 << ", Same As: " << duplicate_of << ", Changed Tiles: " << changed_tiles
+                 << ", Dedup Hits: " << hits << "/" << checked
+                 << ", Dedup Hit Rate (%): " << 100.0 * hits / checked;
+      Logger::LogLineScreen(log_stream.str(), true);
+    }
+    return duplicate_of;
+  }
+
+  // Makes a screenshot a reference target, once its file is written.
+  void RememberScreenshot(const std::string& output_directory_name,
+                          const ScreenshotSignature& signature) {
+    base::AutoLock lock(lock_);
+    std::deque<ScreenshotSignature>& history = dedup_history_[output_directory_name];
+    history.push_back(signature);
+    if (history.size() > kDedupHistorySize)
+      history.pop_front();
+  }
+
+  void ForgetTab(const std::string& output_directory_name) {
+    base::AutoLock lock(lock_);
+    dedup_history_.erase(output_directory_name);
+  }
+
+  void RecordEncode(ScreenshotFormat format, int snapshot_id, int64_t encode_us,
+                    int64_t write_us, size_t bytes, size_t raw_bytes) {
+    EncodeStats stats;
+    int checked, hits;
+    {
+      base::AutoLock lock(lock_);
+      checked = dedup_checked_;
+      hits = dedup_hits_;
+      EncodeStats& totals = stats_[format];
+      totals.count++;
+      totals.encode_us += encode_us;
+      totals.bytes += bytes;
+      totals.raw_bytes += raw_bytes;
+      stats = totals;
+    }
+
+    std::ostringstream log_stream;
+    log_stream << "ScreenshotEncoderPool:: Encoded screenshot, Snapshot ID: " << snapshot_id
+               << ", Format: " << ScreenshotFormatName(format) << ", Encode Time (us): " << encode_us
+               << ", Write Time (us): " << write_us << ", Bytes: " << bytes << ", Raw Bytes: " << raw_bytes
+               << ", # Screenshots: " << stats.count << ", Avg Encode Time (us): " << stats.encode_us / stats.count
+               << ", Total Bytes: " << stats.bytes << ", Total Raw Bytes: " << stats.raw_bytes
+               << ", Dedup Hits: " << hits << "/" << checked;
+    Logger::LogLineScreen(log_stream.str(), true);
+  }
+
+ private:
+  scoped_refptr<base::SequencedWorkerPool> pool_;
+  scoped_refptr<base::TaskRunner> task_runner_;
+
+  base::Lock lock_;
+  EncodeStats stats_[kNumScreenshotFormats];
+  // Recent distinct screenshots, keyed by the tab's output directory.
+  std::map<std::string, std::deque<ScreenshotSignature>> dedup_history_;
+  int dedup_checked_;
+  int dedup_hits_;
+};
+
+base::LazyInstance<ScreenshotEncoderPool>::Leaky g_encoder_pool =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Set by tests and benchmarks only.
+ScreenshotFileWriter g_file_writer_for_testing = nullptr;
+
+// With --enable-snapshot-archive the file becomes a record of the archive,
+// named like the file.
+int WriteScreenshotFile(const std::string& output_directory_name, int snapshot_id,
+                        const base::debug::SnapshotToken& event_id, const FilePath& path,
+                        const char* data, int size) {
+  if (g_file_writer_for_testing)
+    return g_file_writer_for_testing(path, data, size);
+  content::SnapshotArchive* archive = content::SnapshotArchive::GetInstance();
+  if (archive) {
+    return archive->Append(content::ARCHIVE_RECORD_SCREENSHOT, output_directory_name,
+                           path.BaseName().AsUTF8Unsafe(), snapshot_id, event_id, data, size)
+        ? size : -1;
+  }
+  return base::WriteFile(path, data, size);
+}
+
+// The encoders below replace the contents of |output|, reusing its capacity.
+
+bool EncodePNG(const SkBitmap& bitmap, int compression_level, ScreenshotOutputBuffer* output) {
+  SkAutoLockPixels lock(bitmap);
+  output->clear();
+  return gfx::PNGCodec::EncodeWithCompressionLevel(
+      reinterpret_cast<const unsigned char*>(bitmap.getPixels()),
+      gfx::PNGCodec::FORMAT_SkBitmap, gfx::Size(bitmap.width(), bitmap.height()),
+      static_cast<int>(bitmap.rowBytes()), false, std::vector<gfx::PNGCodec::Comment>(),
+      compression_level, output);
+}
+
+int AppendWebPOutput(const uint8_t* data, size_t data_size, const WebPPicture* picture) {
+  ScreenshotOutputBuffer* output = static_cast<ScreenshotOutputBuffer*>(picture->custom_ptr);
+  output->insert(output->end(), data, data + data_size);
+  return 1;
+}
+
+// The pixels are premultiplied, which is exact for the opaque contents of a
+// tab; semi-transparent pixels keep their premultiplied value. Same settings
+// as WebPEncodeLosslessBGRA(), but the output goes straight into |output|.
+bool EncodeWebP(const SkBitmap& bitmap, ScreenshotOutputBuffer* output) {
+  SkAutoLockPixels lock(bitmap);
+  const uint8_t* pixels = reinterpret_cast<const uint8_t*>(bitmap.getPixels());
+  int stride = static_cast<int>(bitmap.rowBytes());
+  WebPConfig config;
+  WebPPicture picture;
+  if (!WebPConfigPreset(&config, WEBP_PRESET_DEFAULT, 70.f) || !WebPPictureInit(&picture))
+    return false;
+  config.lossless = 1;
+  picture.use_argb = 1;
+  picture.width = bitmap.width();
+  picture.height = bitmap.height();
+  picture.writer = &AppendWebPOutput;
+  picture.custom_ptr = output;
+  output->clear();
+  bool ok = (bitmap.colorType() == kRGBA_8888_SkColorType
+                 ? WebPPictureImportRGBA(&picture, pixels, stride)
+                 : WebPPictureImportBGRA(&picture, pixels, stride)) &&
+            WebPEncode(&config, &picture);
+  WebPPictureFree(&picture);
+  return ok;
+}
+
+// A one line text header describing the pixel layout, then the snappy
+// compressed rows exactly as they are in memory.
+bool EncodeRaw(const SkBitmap& bitmap, ScreenshotOutputBuffer* output) {
+  SkAutoLockPixels lock(bitmap);
+  if (!bitmap.getPixels())
+    return false;
+  std::ostringstream header;
+  if (bitmap.colorType() == kAlpha_8_SkColorType) {
+    // I420 readback: the Y, U and V planes stacked in one A8 bitmap.
+    header << "CHROMEPIC-RAW I420 " << bitmap.width() << " " << bitmap.height() * 2 / 3
+           << " " << bitmap.rowBytes() << "\n";
+  } else {
+    header << "CHROMEPIC-RAW " << (bitmap.colorType() == kRGBA_8888_SkColorType ? "RGBA" : "BGRA")
+           << " " << bitmap.width() << " " << bitmap.height() << " " << bitmap.rowBytes() << "\n";
+  }
+  const std::string header_string = header.str();
+  output->resize(header_string.size() + snappy::MaxCompressedLength(bitmap.getSize()));
+  memcpy(output->data(), header_string.data(), header_string.size());
+  size_t compressed_length;
+  snappy::RawCompress(reinterpret_cast<const char*>(bitmap.getPixels()), bitmap.getSize(),
+                      reinterpret_cast<char*>(output->data()) + header_string.size(),
+                      &compressed_length);
+  output->resize(header_string.size() + compressed_length);
+  return true;
+}
+
+bool EncodeBitmap(const SkBitmap& bitmap, ScreenshotFormat format, ScreenshotOutputBuffer* output) {
+  switch (format) {
+    case SCREENSHOT_FORMAT_PNG:
+      return EncodePNG(bitmap, Z_DEFAULT_COMPRESSION, output);
+    case SCREENSHOT_FORMAT_FAST_PNG:
+      return EncodePNG(bitmap, Z_BEST_SPEED, output);
+    case SCREENSHOT_FORMAT_WEBP:
+      return EncodeWebP(bitmap, output);
+    case SCREENSHOT_FORMAT_RAW:
+      return EncodeRaw(bitmap, output);
+  }
+  return false;
+}
+
+// Collects the row-major indexes of the tiles that differ between |bitmap|
+// and |previous|. Returns false if the two cannot be diffed.
+bool FindChangedTiles(const SkBitmap& bitmap, const SkBitmap& previous,
+                      std::vector<int>* changed_tiles) {
+  if (bitmap.width() != previous.width() || bitmap.height() != previous.height() ||
+      bitmap.colorType() != previous.colorType() ||
+      bitmap.colorType() == kAlpha_8_SkColorType)
+    return false;
+  SkAutoLockPixels lock(bitmap);
+  SkAutoLockPixels previous_lock(previous);
+  if (!bitmap.getPixels() || !previous.getPixels())
+    return false;
+
+  const int bytes_per_pixel = bitmap.bytesPerPixel();
+  const int tiles_x = (bitmap.width() + kTileSize - 1) / kTileSize;
+  for (int tile_y = 0; tile_y * kTileSize < bitmap.height(); tile_y++) {
+    const int y_end = std::min(bitmap.height(), (tile_y + 1) * kTileSize);
+    for (int tile_x = 0; tile_x < tiles_x; tile_x++) {
+      const int x = tile_x * kTileSize;
+      const size_t row_bytes = std::min(kTileSize, bitmap.width() - x) * bytes_per_pixel;
+      for (int y = tile_y * kTileSize; y < y_end; y++) {
+        if (memcmp(reinterpret_cast<const char*>(bitmap.getAddr(x, y)),
+                   reinterpret_cast<const char*>(previous.getAddr(x, y)), row_bytes)) {
+          changed_tiles->push_back(tile_y * tiles_x + tile_x);
+          break;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Copies |tiles| of |bitmap| into a strip one tile wide, top to bottom. Edge
+// tiles are padded with transparent pixels.
+void CopyTilesToStrip(const SkBitmap& bitmap, const std::vector<int>& tiles, SkBitmap* strip) {
+  SkAutoLockPixels lock(bitmap);
+  strip->allocPixels(SkImageInfo::Make(kTileSize, kTileSize * tiles.size(),
+                                       bitmap.colorType(), bitmap.alphaType()));
+  strip->eraseColor(SK_ColorTRANSPARENT);
+  const int tiles_x = (bitmap.width() + kTileSize - 1) / kTileSize;
+  for (size_t i = 0; i < tiles.size(); i++) {
+    const int x = (tiles[i] % tiles_x) * kTileSize;
+    const int y = (tiles[i] / tiles_x) * kTileSize;
+    const size_t row_bytes = std::min(kTileSize, bitmap.width() - x) * bitmap.bytesPerPixel();
+    for (int row = 0; row < kTileSize && y + row < bitmap.height(); row++)
+      memcpy(strip->getAddr(0, i * kTileSize + row), bitmap.getAddr(x, y + row), row_bytes);
+  }
+}
+
+// A tile delta is a text header followed by the changed tiles of the frame,
+// stacked in a strip encoded in the tab's screenshot format:
+//   CHROMEPIC-TILES snapshot_<previous snapshot ID>
+//   <width> <height> <tile size>
+//   <changed tile indexes, row-major>
+//   <empty line>
+//   <encoded strip>
+// tools/chromepic/decode_screenshot.py rebuilds full frames from the chain.
+bool EncodeTileDelta(const SkBitmap& bitmap, const std::vector<int>& changed_tiles,
+                     int previous_snapshot_id, ScreenshotFormat format,
+                     ScreenshotOutputBuffer* output) {
+  std::ostringstream header;
+  header << "CHROMEPIC-TILES snapshot_" << previous_snapshot_id << "\n"
+         << bitmap.width() << " " << bitmap.height() << " " << kTileSize << "\n";
+  for (size_t i = 0; i < changed_tiles.size(); i++)
+    header << (i ? " " : "") << changed_tiles[i];
+  header << "\n\n";
+
+  output->clear();
+  if (!changed_tiles.empty()) {
+    SkBitmap strip;
+    CopyTilesToStrip(bitmap, changed_tiles, &strip);
+    if (!EncodeBitmap(strip, format, output))
+      return false;
+  }
+  const std::string header_string = header.str();
+  output->insert(output->begin(), header_string.begin(), header_string.end());
+  return true;
+}
+
+std::string GetScreenshotFileName(int snapshot_id, ScreenshotFormat format) {
+  return "snapshot_" + std::to_string(snapshot_id) + kScreenshotFileExtensions[format];
+}
+
+// Runs on the encoder pool once a write slot is free.
+void WriteEncodedScreenshot(const std::string& output_directory_name,
+                            const base::debug::SnapshotToken& event_id,
+                            const FilePath& path, scoped_ptr<ScreenshotOutputBuffer> encoded,
+                            ScreenshotFormat format, int snapshot_id, int64_t encode_us,
+                            size_t raw_bytes, int64_t site_id,
+                            scoped_ptr<ScreenshotSignature> signature,
+                            const base::Closure& failed_callback,
+                            scoped_ptr<SnapshotScheduler::Slot> write_slot) {
+  TimeTicks write_start = TimeTicks::Now();
+  const int size = static_cast<int>(encoded->size());
+  if (WriteScreenshotFile(output_directory_name, snapshot_id, event_id, path,
+                          reinterpret_cast<const char*>(encoded->data()), size) != size)
+    failed_callback.Run();
+  else if (signature)
+    g_encoder_pool.Get().RememberScreenshot(output_directory_name, *signature);
+  TimeTicks write_end = TimeTicks::Now();
+  write_slot.reset();
+  g_encoder_pool.Get().RecordEncode(format, snapshot_id, encode_us,
+                                    (write_end - write_start).InMicroseconds(),
+                                    encoded->size(), raw_bytes);
+  ScreenshotBufferPool::GetInstance()->ReturnOutputBuffer(std::move(encoded));
+  JournalEntry entry(JOURNAL_STAGE_SCREENSHOT_WRITTEN);
+  entry.site_id = site_id;
+  entry.snapshot_id = snapshot_id;
+  entry.arg0 = static_cast<int32_t>(encode_us);
+  entry.arg1 = static_cast<int32_t>((write_end - write_start).InMicroseconds());
+  EventJournal::Record(&entry);
+}
+
+}  // namespace
+
+bool ParseScreenshotFormat(const std::string& name, ScreenshotFormat* format) {
+  for (int i = 0; i < kNumScreenshotFormats; i++) {
+    if (name == kScreenshotFormatNames[i]) {
+      *format = static_cast<ScreenshotFormat>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* ScreenshotFormatName(ScreenshotFormat format) {
+  return kScreenshotFormatNames[format];
+}
+
+void PostPrintScreenshot(const SkBitmap& bitmap, std::string output_directory_name,
+                         const int snapshot_id, const base::debug::SnapshotToken& event_id,
+                         const SkBitmap& previous_bitmap, int previous_snapshot_id,
+                         const ScreenshotOptions& options,
+                         const base::Closure& failed_callback) {
+  base::Closure reply = base::Bind(base::IgnoreResult(&base::TaskRunner::PostTask),
+                                   base::ThreadTaskRunnerHandle::Get(), FROM_HERE,
+                                   failed_callback);
+  SnapshotScheduler::GetInstance()->Schedule(
+      SnapshotScheduler::RESOURCE_ENCODE, options.priority, nullptr,
+      g_encoder_pool.Get().task_runner(),
+      base::Bind(&PrintScreenshot, bitmap, output_directory_name, snapshot_id,
+                 event_id, previous_bitmap, previous_snapshot_id, options, reply));
+}
+
+void ForgetScreenshots(const std::string& output_directory_name) {
+  g_encoder_pool.Get().ForgetTab(output_directory_name);
+}
+
+void SetScreenshotFileWriterForTesting(ScreenshotFileWriter writer) {
+  g_file_writer_for_testing = writer;
+}
+
+void PrintScreenshot(const SkBitmap& bitmap, std::string output_directory_name, const int snapshot_id,
+                     const base::debug::SnapshotToken& event_id, const SkBitmap& previous_bitmap,
+                     int previous_snapshot_id, const ScreenshotOptions& options,
+                     const base::Closure& failed_callback,
+                     scoped_ptr<SnapshotScheduler::Slot> encode_slot) {
+        // I420 readbacks can only be stored raw.
+        const ScreenshotFormat format = bitmap.colorType() == kAlpha_8_SkColorType
+                ? SCREENSHOT_FORMAT_RAW : options.format;
+        // End of the snapshot's flow on the browser side.
+        TRACE_EVENT_WITH_FLOW1("forensics", "PrintScreenshot",
+                               base::debug::ForensicFlowId(event_id, snapshot_id),
+                               TRACE_EVENT_FLAG_FLOW_IN, "snapshot ID", snapshot_id);
         FilePath cur;
         #if defined(OS_ANDROID)
             PathService::Get(base::DIR_ANDROID_EXTERNAL_STORAGE, &cur);
@@ -48,11 +524,37 @@ void PrintScreenshot(const SkBitmap& bitmap, std::string output_directory_name,
         #endif
 
         File::Error error;
-        if (!base::CreateDirectoryAndGetError(cur, &error)){
+        if (!g_file_writer_for_testing && !content::SnapshotArchive::GetInstance() &&
+            !base::CreateDirectoryAndGetError(cur, &error)){
             fprintf(stderr, "Error in creating an output directory for the snapshots!\n");
+            failed_callback.Run();
             return;
         }
-        std::string file_name = "snapshot_" + std::to_string(snapshot_id) + ".png";
+        std::string file_name = GetScreenshotFileName(snapshot_id, format);
+
+        scoped_ptr<ScreenshotSignature> signature;
+        if (options.dedup_enabled) {
+            signature.reset(new ScreenshotSignature);
+            ComputeSignature(bitmap, snapshot_id, signature.get());
+            int duplicate_of = g_encoder_pool.Get().FindDuplicate(
+                    output_directory_name, *signature, options.dedup_max_changed_tiles);
+            if (duplicate_of) {
+                // The earlier screenshot may itself be a tile delta, so only
+                // name the snapshot and leave the extension to the reader.
+                std::string reference = "snapshot_" + std::to_string(duplicate_of) + "\n";
+                cur = cur.AppendASCII("snapshot_" + std::to_string(snapshot_id) + ".ref");
+                const int size = static_cast<int>(reference.size());
+                if (WriteScreenshotFile(output_directory_name, snapshot_id, event_id, cur,
+                                        reference.data(), size) != size)
+                    failed_callback.Run();
+                JournalEntry entry(JOURNAL_STAGE_SCREENSHOT_WRITTEN);
+                entry.site_id = options.site_id;
+                entry.snapshot_id = snapshot_id;
+                entry.arg0 = -1;
+                EventJournal::Record(&entry);
+                return;
+            }
+        }
 
         #if defined(OS_POSIX)
             cur = cur.Append(file_name);
@@ -62,13 +564,40 @@ void PrintScreenshot(const SkBitmap& bitmap, std::string output_directory_name,
         #endif
 
         //fprintf(stderr, "Captured screenshot of size: %lu!! \n", bitmap.getSize());
-        std::vector<unsigned char> png_data;
-        bool res = gfx::PNGCodec::EncodeBGRASkBitmap(bitmap, false, &png_data);
+        TimeTicks encode_start = TimeTicks::Now();
+        scoped_ptr<ScreenshotOutputBuffer> encoded =
+                ScreenshotBufferPool::GetInstance()->TakeOutputBuffer();
+        bool res = false;
+        std::vector<int> changed_tiles;
+        if (!previous_bitmap.isNull() &&
+            FindChangedTiles(bitmap, previous_bitmap, &changed_tiles)) {
+            res = EncodeTileDelta(bitmap, changed_tiles, previous_snapshot_id, format, encoded.get());
+            cur = cur.ReplaceExtension(FILE_PATH_LITERAL(".tiles"));
+
+            const int tiles_x = (bitmap.width() + kTileSize - 1) / kTileSize;
+            const int tiles_y = (bitmap.height() + kTileSize - 1) / kTileSize;
+            std::ostringstream log_stream;
+            log_stream << "ScreenshotEncoderPool:: Tile delta, Snapshot ID: " << snapshot_id
+                       << ", Previous Snapshot ID: " << previous_snapshot_id << ", Changed Tiles: "
+                       << changed_tiles.size() << "/" << tiles_x * tiles_y;
+            Logger::LogLineScreen(log_stream.str(), true);
+        } else {
+            res = EncodeBitmap(bitmap, format, encoded.get());
+        }
         //fprintf(stderr, "PNG Encode attempted.. Result: %d\n", res);
-        if (!res) 
+        if (!res) {
+            ScreenshotBufferPool::GetInstance()->ReturnOutputBuffer(std::move(encoded));
+            failed_callback.Run();
             return;
-        ////fprintf(stderr, "Writing to file: %s \n", cur.value().c_str());
-        base::WriteFile(cur, reinterpret_cast<const char*>(&png_data[0]), png_data.size());
-        //fprintf(stderr, "Wrote file to disk.\n");
-        TRACE_EVENT_END1("forensics", "PrintScreenshot: End", "snapshot ID", snapshot_id);
+        }
+        int64_t encode_us = (TimeTicks::Now() - encode_start).InMicroseconds();
+        // The next encode may start while this one waits to be written.
+        encode_slot.reset();
+        SnapshotScheduler::GetInstance()->Schedule(
+                SnapshotScheduler::RESOURCE_WRITE, options.priority, nullptr,
+                g_encoder_pool.Get().task_runner(),
+                base::Bind(&WriteEncodedScreenshot, output_directory_name, event_id, cur,
+                           base::Passed(&encoded), format,
+                           snapshot_id, encode_us, bitmap.getSize(), options.site_id,
+                           base::Passed(&signature), failed_callback));
 }
@@ -6,8 +6,103 @@
  *
  */
 
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SCREENSHOT_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SCREENSHOT_H_
 
+#include <stdint.h>
+
+#include <string>
+
+#include "base/callback_forward.h"
+#include "base/debug/snapshot_token.h"
+#include "base/memory/scoped_ptr.h"
+#include "content/browser/renderer_host/snapshot/snapshot_scheduler.h"
 #include "content/public/browser/readback_types.h"
 
+namespace base {
+class FilePath;
+}
+#include "third_party/skia/include/core/SkBitmap.h"
+
+// Output format of screenshots, selected with --screenshot-format.
+enum ScreenshotFormat {
+  // PNG at the default zlib level (the original ChromePic output).
+  SCREENSHOT_FORMAT_PNG,
+  // PNG at Z_BEST_SPEED: faster to encode, somewhat larger files.
+  SCREENSHOT_FORMAT_FAST_PNG,
+  // Lossless WebP: smaller than PNG, slower to encode than fast PNG.
+  SCREENSHOT_FORMAT_WEBP,
+  // Snappy-compressed raw pixels, meant to be transcoded offline with
+  // tools/chromepic/transcode_screenshot.py.
+  SCREENSHOT_FORMAT_RAW,
+};
+
+struct ScreenshotOptions {
+  ScreenshotOptions()
+      : format(SCREENSHOT_FORMAT_PNG),
+        dedup_enabled(false),
+        dedup_max_changed_tiles(0),
+        tile_diff_enabled(false),
+        keyframe_interval(10),
+        site_id(0),
+        priority(content::SNAPSHOT_PRIORITY_VISIBLE) {}
+
+  ScreenshotFormat format;
+  // With --enable-screenshot-dedup, screenshots whose 64x64 tile checksums
+  // match one of the tab's recently written screenshots are stored as a
+  // snapshot_N.ref file naming that screenshot instead of being encoded.
+  bool dedup_enabled;
+  // How many tiles may differ for a screenshot to still count as a duplicate
+  // (--screenshot-dedup-max-changed-tiles). 0 only drops identical frames.
+  int dedup_max_changed_tiles;
+  // Store screenshots as the 64x64 tiles that changed since the tab's previous
+  // screenshot (--enable-tile-diff-screenshots), with a full keyframe every
+  // |keyframe_interval| screenshots (--screenshot-keyframe-interval).
+  bool tile_diff_enabled;
+  int keyframe_interval;
+  // Site ID of the tab's SnapshotHandler, for the journal.
+  int64_t site_id;
+  // Place of the screenshot's encode and write in the SnapshotScheduler
+  // queues, set per screenshot.
+  content::SnapshotPriority priority;
+};
+
+// Parses a --screenshot-format value ("png", "fast-png", "webp" or "raw").
+bool ParseScreenshotFormat(const std::string& name, ScreenshotFormat* format);
+const char* ScreenshotFormatName(ScreenshotFormat format);
+
 //void ScreenshotCaptured(int snapshot_id, const SkBitmap& bitmap, content::ReadbackResponse response);
-void PrintScreenshot(const SkBitmap& bitmap, std::string tab_id, const int screenshot_id);
+
+// Encodes and writes |bitmap| on the screenshot encoder pool. The pool has one
+// thread per core (override with --screenshot-encoder-threads) so encodes
+// neither queue behind each other nor block the shared FILE thread. The
+// encode and the write each wait for a SnapshotScheduler slot.
+// A non-null |previous_bitmap| makes this a tile delta against the tab's
+// screenshot |previous_snapshot_id|; a null one makes it a keyframe.
+// |failed_callback| runs on the calling thread if the screenshot could not be
+// encoded or written, so that the next one is not a delta against it.
+void PostPrintScreenshot(const SkBitmap& bitmap, std::string output_directory_name,
+                         const int snapshot_id, const base::debug::SnapshotToken& event_id,
+                         const SkBitmap& previous_bitmap, int previous_snapshot_id,
+                         const ScreenshotOptions& options,
+                         const base::Closure& failed_callback);
+// |failed_callback| is run on the encoder pool.
+void PrintScreenshot(const SkBitmap& bitmap, std::string tab_id, const int screenshot_id,
+                     const base::debug::SnapshotToken& event_id, const SkBitmap& previous_bitmap,
+                     int previous_snapshot_id, const ScreenshotOptions& options,
+                     const base::Closure& failed_callback,
+                     scoped_ptr<content::SnapshotScheduler::Slot> encode_slot);
+
+// Drops the dedup history of a tab's screenshots.
+void ForgetScreenshots(const std::string& output_directory_name);
+
+// Stores a screenshot file; same contract as base::WriteFile.
+typedef int (*ScreenshotFileWriter)(const base::FilePath& path,
+                                    const char* data, int size);
+
+// Sends every screenshot file to |writer| instead of the disk, and skips
+// creating the output directories. Null restores base::WriteFile. Call while
+// no screenshots are being encoded.
+void SetScreenshotFileWriterForTesting(ScreenshotFileWriter writer);
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SCREENSHOT_H_
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/screenshot_buffer_pool.h"
+
+#include <sstream>
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/memory/shared_memory.h"
+#include "base/strings/string_number_conversions.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+
+namespace content {
+
+namespace {
+
+const size_t kDefaultMaxFreeMegabytes = 64;
+// A free buffer is reused for a bitmap up to this much smaller than it.
+const size_t kMaxWastedFraction = 4;
+// Output buffers above this capacity are freed rather than kept.
+const size_t kMaxOutputBufferCapacity = 32 * 1024 * 1024;
+const size_t kMaxFreeOutputBuffers = 16;
+const int kStatsInterval = 100;
+
+base::LazyInstance<ScreenshotBufferPool>::Leaky g_screenshot_buffer_pool =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+ScreenshotBufferPool::PixelBuffer::PixelBuffer() : size(0) {}
+
+ScreenshotBufferPool::PixelBuffer::~PixelBuffer() {}
+
+// static
+ScreenshotBufferPool* ScreenshotBufferPool::GetInstance() {
+  return g_screenshot_buffer_pool.Pointer();
+}
+
+ScreenshotBufferPool::ScreenshotBufferPool()
+    : max_free_bytes_(kDefaultMaxFreeMegabytes * 1024 * 1024),
+      free_bytes_(0),
+      pixel_hits_(0),
+      pixel_misses_(0) {
+  const base::CommandLine& command_line = *base::CommandLine::ForCurrentProcess();
+  int megabytes;
+  if (base::StringToInt(command_line.GetSwitchValueASCII("screenshot-buffer-pool-mb"), &megabytes) &&
+      megabytes >= 0)
+    max_free_bytes_ = static_cast<size_t>(megabytes) * 1024 * 1024;
+}
+
+ScreenshotBufferPool::~ScreenshotBufferPool() {
+  // Leaky; never destroyed.
+  NOTREACHED();
+}
+
+bool ScreenshotBufferPool::AllocPixels(const SkImageInfo& info, SkBitmap* bitmap) {
+  const size_t row_bytes = info.minRowBytes();
+  const size_t size = info.getSafeSize(row_bytes);
+  if (!size)
+    return false;
+
+  PixelBuffer* buffer = nullptr;
+  int64_t hits, misses;
+  size_t free_bytes;
+  {
+    base::AutoLock lock(lock_);
+    // The most recently returned buffers are the likeliest to be resident.
+    for (size_t i = free_pixel_buffers_.size(); i-- > 0;) {
+      PixelBuffer* candidate = free_pixel_buffers_[i];
+      if (candidate->size >= size && candidate->size - size <= size / kMaxWastedFraction) {
+        buffer = candidate;
+        free_pixel_buffers_.erase(free_pixel_buffers_.begin() + i);
+        free_bytes_ -= buffer->size;
+        break;
+      }
+    }
+    hits = buffer ? ++pixel_hits_ : pixel_hits_;
+    misses = buffer ? pixel_misses_ : ++pixel_misses_;
+    free_bytes = free_bytes_;
+  }
+
+  if (!buffer) {
+    scoped_ptr<PixelBuffer> new_buffer(new PixelBuffer);
+    new_buffer->memory.reset(new base::SharedMemory);
+    if (!new_buffer->memory->CreateAndMapAnonymous(size))
+      return false;
+    new_buffer->size = size;
+    buffer = new_buffer.release();
+  }
+
+  if ((hits + misses) % kStatsInterval == 0) {
+    std::ostringstream log_stream;
+    log_stream << "ScreenshotBufferPool:: Pixel Buffer Hits: " << hits << "/" << hits + misses
+               << ", Free Bytes: " << free_bytes;
+    Logger::LogLineScreen(log_stream.str(), true);
+  }
+
+  // On failure Skia calls ReleasePixels, which returns the buffer.
+  return bitmap->installPixels(info, buffer->memory->memory(), row_bytes, nullptr,
+                               &ScreenshotBufferPool::ReleasePixels, buffer);
+}
+
+// static
+void ScreenshotBufferPool::ReleasePixels(void* pixels, void* context) {
+  GetInstance()->ReturnPixelBuffer(static_cast<PixelBuffer*>(context));
+}
+
+void ScreenshotBufferPool::ReturnPixelBuffer(PixelBuffer* buffer) {
+  std::vector<PixelBuffer*> evicted;
+  {
+    base::AutoLock lock(lock_);
+    free_pixel_buffers_.push_back(buffer);
+    free_bytes_ += buffer->size;
+    while (free_bytes_ > max_free_bytes_) {
+      evicted.push_back(free_pixel_buffers_.front());
+      free_bytes_ -= free_pixel_buffers_.front()->size;
+      free_pixel_buffers_.pop_front();
+    }
+  }
+  // Unmapping can be slow; not under the lock.
+  for (PixelBuffer* evicted_buffer : evicted)
+    delete evicted_buffer;
+}
+
+scoped_ptr<ScreenshotOutputBuffer> ScreenshotBufferPool::TakeOutputBuffer() {
+  {
+    base::AutoLock lock(lock_);
+    if (!free_output_buffers_.empty()) {
+      scoped_ptr<ScreenshotOutputBuffer> buffer(free_output_buffers_.back());
+      free_output_buffers_.pop_back();
+      return buffer;
+    }
+  }
+  return make_scoped_ptr(new ScreenshotOutputBuffer);
+}
+
+void ScreenshotBufferPool::ReturnOutputBuffer(scoped_ptr<ScreenshotOutputBuffer> buffer) {
+  if (buffer->capacity() > kMaxOutputBufferCapacity)
+    return;
+  buffer->clear();
+  base::AutoLock lock(lock_);
+  if (free_output_buffers_.size() < kMaxFreeOutputBuffers)
+    free_output_buffers_.push_back(buffer.release());
+}
+
+}  // namespace content
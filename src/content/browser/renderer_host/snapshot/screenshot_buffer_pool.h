@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SCREENSHOT_BUFFER_POOL_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SCREENSHOT_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "third_party/skia/include/core/SkImageInfo.h"
+
+class SkBitmap;
+
+namespace base {
+class SharedMemory;
+}
+
+namespace content {
+
+// Encoded screenshot bytes, filled in place by the encoders.
+typedef std::vector<unsigned char> ScreenshotOutputBuffer;
+
+// Memory that screenshots go through, kept from one screenshot to the next.
+// Readbacks land in mapped shared memory buffers that the encoders read in
+// place, and are returned to the pool when the last SkBitmap using them goes
+// away, so a multi-megabyte buffer is neither allocated nor faulted in per
+// screenshot. Encoders write into recycled output buffers that keep their
+// capacity. --screenshot-buffer-pool-mb caps the idle pixel memory (64MB).
+// Thread-safe.
+class ScreenshotBufferPool {
+ public:
+  static ScreenshotBufferPool* GetInstance();
+
+  // Points |bitmap| at a pooled buffer that fits |info|. Returns false if no
+  // buffer could be allocated.
+  bool AllocPixels(const SkImageInfo& info, SkBitmap* bitmap);
+
+  // An empty output buffer, with the capacity of a recent screenshot.
+  scoped_ptr<ScreenshotOutputBuffer> TakeOutputBuffer();
+  void ReturnOutputBuffer(scoped_ptr<ScreenshotOutputBuffer> buffer);
+
+ private:
+  friend struct base::DefaultLazyInstanceTraits<ScreenshotBufferPool>;
+
+  struct PixelBuffer {
+    PixelBuffer();
+    ~PixelBuffer();
+
+    scoped_ptr<base::SharedMemory> memory;
+    size_t size;
+  };
+
+  ScreenshotBufferPool();
+  ~ScreenshotBufferPool();
+
+  // SkBitmap release proc; |context| is the PixelBuffer.
+  static void ReleasePixels(void* pixels, void* context);
+  void ReturnPixelBuffer(PixelBuffer* buffer);
+
+  base::Lock lock_;
+  size_t max_free_bytes_;
+  // Idle pixel buffers, least recently returned first.
+  std::deque<PixelBuffer*> free_pixel_buffers_;
+  size_t free_bytes_;
+  std::vector<ScreenshotOutputBuffer*> free_output_buffers_;
+  int64_t pixel_hits_;
+  int64_t pixel_misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotBufferPool);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SCREENSHOT_BUFFER_POOL_H_
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/snapshot_archive.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/files/file_util.h"
+#include "base/hash.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/path_service.h"
+#include "base/process/process_handle.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
+
+namespace content {
+
+namespace {
+
+const uint64_t kSegmentBytes = 512 * 1024 * 1024;
+// A batch is written once it is this large, or after kWriteIntervalMs.
+const size_t kBatchBytes = 4 * 1024 * 1024;
+const int kWriteIntervalMs = 1000;
+// Written bytes are synced after this long or this many bytes.
+const int kSyncIntervalSeconds = 5;
+const int64_t kSyncBytes = 64 * 1024 * 1024;
+// Records are dropped while the writer has this much left to write.
+const size_t kMaxQueuedBytes = 256 * 1024 * 1024;
+
+// "CPAR", little-endian.
+const uint32_t kArchiveRecordMagic = 0x52415043;
+const uint32_t kArchiveVersion = 1;
+const char kSegmentMagic[] = "CHROMEPIC-ARCHIVE\n";
+const char kIndexMagic[] = "CHROMEPIC-INDEX\n";
+
+static_assert(sizeof(ArchiveRecordHeader) == 32,
+              "ArchiveRecordHeader is part of the archive file format");
+static_assert(sizeof(ArchiveIndexEntry) == 24,
+              "ArchiveIndexEntry is part of the archive file format");
+
+// Starts every segment and index file.
+struct FileHeader {
+  char magic[24];
+  uint32_t version;
+  // sizeof(ArchiveRecordHeader) or sizeof(ArchiveIndexEntry).
+  uint32_t entry_size;
+};
+
+bool WriteFileHeader(const char* magic, uint32_t entry_size, base::File* file) {
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  strncpy(header.magic, magic, sizeof(header.magic));
+  header.version = kArchiveVersion;
+  header.entry_size = entry_size;
+  return file->WriteAtCurrentPos(reinterpret_cast<const char*>(&header), sizeof(header)) ==
+         static_cast<int>(sizeof(header));
+}
+
+size_t AlignTo8(size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+base::LazyInstance<SnapshotArchive>::Leaky g_snapshot_archive =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+SnapshotArchive::Batch::Batch() : segment(0), sync(false) {}
+
+SnapshotArchive::Batch::~Batch() {}
+
+// static
+SnapshotArchive* SnapshotArchive::GetInstance() {
+  SnapshotArchive* archive = g_snapshot_archive.Pointer();
+  return archive->enabled_ ? archive : nullptr;
+}
+
+SnapshotArchive::SnapshotArchive()
+    : enabled_(base::CommandLine::ForCurrentProcess()->HasSwitch(
+          "enable-snapshot-archive")),
+      writer_thread_("ChromePicArchive"),
+      segment_(0),
+      segment_offset_(0),
+      queued_bytes_(0),
+      dropped_records_(0),
+      open_segment_(-1),
+      data_offset_(0),
+      failed_segment_(-1),
+      unsynced_bytes_(0) {
+  if (!enabled_)
+    return;
+
+  #if defined(OS_ANDROID)
+      PathService::Get(base::DIR_ANDROID_EXTERNAL_STORAGE, &directory_);
+      directory_ = directory_.Append(FILE_PATH_LITERAL("Download"));
+  #else
+      PathService::Get(base::DIR_HOME, &directory_);
+  #endif
+  base::Time::Exploded now;
+  base::Time::Now().LocalExplode(&now);
+  std::ostringstream ss;
+  ss << "archive_" << now.month << "_" << now.day_of_month << "_" << now.year << "__"
+     << now.hour << "_" << now.minute << "_" << now.second << "_" << base::GetCurrentProcId();
+  directory_ = directory_.Append(FILE_PATH_LITERAL("snapshots")).AppendASCII(ss.str());
+
+  writer_thread_.Start();
+  writer_thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, base::Bind(&SnapshotArchive::FlushAndReschedule,
+                            base::Unretained(this)),
+      base::TimeDelta::FromMilliseconds(kWriteIntervalMs));
+  Logger::LogLineScreen("SnapshotArchive:: Directory: " + directory_.AsUTF8Unsafe(), true);
+}
+
+SnapshotArchive::~SnapshotArchive() {
+  // Leaky; never destroyed.
+  NOTREACHED();
+}
+
+bool SnapshotArchive::Append(ArchiveRecordType type,
+                             const std::string& tab,
+                             const std::string& name,
+                             int snapshot_id,
+                             const base::debug::SnapshotToken& event_id,
+                             const char* data,
+                             size_t size) {
+  DCHECK(enabled_);
+  const std::string event_id_text = event_id.ToString();
+  ArchiveRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kArchiveRecordMagic;
+  header.type = static_cast<uint16_t>(type);
+  header.tab_length = static_cast<uint16_t>(std::min<size_t>(tab.size(), 0xffff));
+  header.snapshot_id = snapshot_id;
+  header.name_length = static_cast<uint16_t>(std::min<size_t>(name.size(), 0xffff));
+  header.event_id_length = static_cast<uint16_t>(std::min<size_t>(event_id_text.size(), 0xffff));
+  header.time = base::TimeTicks::Now().ToInternalValue();
+  header.payload_length = static_cast<uint32_t>(size);
+  const size_t unpadded_size = sizeof(header) + header.tab_length + header.name_length +
+                               header.event_id_length + size;
+  const size_t record_size = AlignTo8(unpadded_size);
+
+  ArchiveIndexEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.length = static_cast<uint32_t>(record_size);
+  entry.type = header.type;
+  entry.snapshot_id = snapshot_id;
+  entry.event_id_hash = base::Hash(event_id_text);
+
+  base::AutoLock lock(lock_);
+  if (queued_bytes_ + batch_.data.size() + record_size > kMaxQueuedBytes) {
+    if (!(dropped_records_++ % 100)) {
+      std::ostringstream log_stream;
+      log_stream << "SnapshotArchive:: Writer behind, dropping records, Dropped: " << dropped_records_;
+      Logger::LogLineScreen(log_stream.str(), true);
+    }
+    return false;
+  }
+  if (segment_offset_ && segment_offset_ + record_size > kSegmentBytes) {
+    PostBatchLocked(true);
+    segment_++;
+    segment_offset_ = 0;
+  }
+  if (batch_.data.empty())
+    batch_.segment = segment_;
+  // The writer thread starts the segment with a FileHeader.
+  if (!segment_offset_)
+    segment_offset_ = sizeof(FileHeader);
+
+  entry.offset = batch_.data.size();
+  batch_.data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  batch_.data.append(tab.data(), header.tab_length);
+  batch_.data.append(name.data(), header.name_length);
+  batch_.data.append(event_id_text.data(), header.event_id_length);
+  batch_.data.append(data, size);
+  batch_.data.append(record_size - unpadded_size, '\0');
+  batch_.index.push_back(entry);
+  segment_offset_ += record_size;
+
+  if (batch_.data.size() >= kBatchBytes)
+    PostBatchLocked(false);
+  return true;
+}
+
+void SnapshotArchive::Flush() {
+  if (!enabled_)
+    return;
+  base::AutoLock lock(lock_);
+  PostBatchLocked(true);
+}
+
+void SnapshotArchive::PostBatchLocked(bool sync) {
+  lock_.AssertAcquired();
+  if (batch_.data.empty() && !sync)
+    return;
+  scoped_ptr<Batch> batch(new Batch);
+  batch->segment = batch_.segment;
+  batch->data.swap(batch_.data);
+  batch->index.swap(batch_.index);
+  batch->sync = sync;
+  batch_.segment = segment_;
+  queued_bytes_ += batch->data.size();
+  writer_thread_.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&SnapshotArchive::WriteBatch,
+                            base::Unretained(this), base::Passed(&batch)));
+}
+
+void SnapshotArchive::WriteBatch(scoped_ptr<Batch> batch) {
+  DCHECK(writer_thread_.task_runner()->BelongsToCurrentThread());
+  if (!batch->data.empty() && batch->segment != failed_segment_) {
+    if ((batch->segment != open_segment_ && !OpenSegment(batch->segment)) ||
+        !WriteRecords(batch.get())) {
+      std::ostringstream log_stream;
+      log_stream << "SnapshotArchive:: Failure in writing segment " << batch->segment
+                 << ", dropping the rest of it";
+      Logger::LogLineScreen(log_stream.str(), true);
+      failed_segment_ = batch->segment;
+      CloseSegment();
+    }
+  }
+  {
+    base::AutoLock lock(lock_);
+    queued_bytes_ -= batch->data.size();
+    // Appends move on to a new segment. The batch being filled has offsets
+    // relative to its start, so it can go there as is.
+    if (segment_ == failed_segment_) {
+      segment_++;
+      batch_.segment = segment_;
+      segment_offset_ = batch_.data.empty() ? 0 : sizeof(FileHeader) + batch_.data.size();
+    }
+  }
+
+  if (batch->sync || unsynced_bytes_ >= kSyncBytes ||
+      base::TimeTicks::Now() - last_sync_ >= base::TimeDelta::FromSeconds(kSyncIntervalSeconds))
+    Sync();
+}
+
+void SnapshotArchive::FlushAndReschedule() {
+  {
+    base::AutoLock lock(lock_);
+    PostBatchLocked(false);
+  }
+  writer_thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, base::Bind(&SnapshotArchive::FlushAndReschedule,
+                            base::Unretained(this)),
+      base::TimeDelta::FromMilliseconds(kWriteIntervalMs));
+}
+
+bool SnapshotArchive::OpenSegment(int segment) {
+  CloseSegment();
+
+  base::File::Error error;
+  if (!base::CreateDirectoryAndGetError(directory_, &error)) {
+    Logger::LogLineScreen("SnapshotArchive:: Error in creating the archive directory!", true);
+    return false;
+  }
+  std::string name = "segment_" + std::to_string(segment);
+  const uint32_t flags = base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE;
+  data_file_.Initialize(directory_.AppendASCII(name + ".cpa"), flags);
+  index_file_.Initialize(directory_.AppendASCII(name + ".idx"), flags);
+  if (!data_file_.IsValid() || !index_file_.IsValid() ||
+      !WriteFileHeader(kSegmentMagic, sizeof(ArchiveRecordHeader), &data_file_) ||
+      !WriteFileHeader(kIndexMagic, sizeof(ArchiveIndexEntry), &index_file_)) {
+    Logger::LogLineScreen("SnapshotArchive:: Error in creating segment " + name, true);
+    data_file_.Close();
+    index_file_.Close();
+    return false;
+  }
+  open_segment_ = segment;
+  data_offset_ = sizeof(FileHeader);
+  Logger::LogLineScreen("SnapshotArchive:: Opened segment " + name, true);
+  return true;
+}
+
+bool SnapshotArchive::WriteRecords(Batch* batch) {
+  // Records first, so every index entry points at written data.
+  const int data_size = static_cast<int>(batch->data.size());
+  if (data_file_.WriteAtCurrentPos(batch->data.data(), data_size) != data_size)
+    return false;
+  for (ArchiveIndexEntry& entry : batch->index)
+    entry.offset += data_offset_;
+  data_offset_ += data_size;
+  unsynced_bytes_ += data_size;
+  const int index_size = static_cast<int>(batch->index.size() * sizeof(ArchiveIndexEntry));
+  return index_file_.WriteAtCurrentPos(reinterpret_cast<const char*>(batch->index.data()),
+                                       index_size) == index_size;
+}
+
+void SnapshotArchive::CloseSegment() {
+  if (open_segment_ >= 0)
+    Sync();
+  data_file_.Close();
+  index_file_.Close();
+  open_segment_ = -1;
+}
+
+void SnapshotArchive::Sync() {
+  if (data_file_.IsValid())
+    data_file_.Flush();
+  if (index_file_.IsValid())
+    index_file_.Flush();
+  unsynced_bytes_ = 0;
+  last_sync_ = base::TimeTicks::Now();
+}
+
+}  // namespace content
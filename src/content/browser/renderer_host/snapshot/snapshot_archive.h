@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_ARCHIVE_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_ARCHIVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/debug/snapshot_token.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+
+namespace content {
+
+// What an archive record holds. Part of the file format: new types go at the
+// end.
+enum ArchiveRecordType {
+  // An encoded screenshot, reference or tile delta. The record's name is the
+  // file it replaces, e.g. snapshot_3.png or snapshot_4.ref.
+  ARCHIVE_RECORD_SCREENSHOT,
+  // A DOM snapshot. The renderer writes it to its own file, which the record
+  // names; the payload is its size in bytes, as text.
+  ARCHIVE_RECORD_DOM_SNAPSHOT,
+  // A line of text about the tab, e.g. its flags.
+  ARCHIVE_RECORD_METADATA,
+};
+
+// Precedes every record of a segment. The tab (its output directory name),
+// the name, the event ID and the payload follow, then zeros up to the next
+// multiple of 8 bytes.
+struct ArchiveRecordHeader {
+  // kArchiveRecordMagic, to find the next record after a torn write.
+  uint32_t magic;
+  uint16_t type;
+  uint16_t tab_length;
+  int32_t snapshot_id;
+  uint16_t name_length;
+  uint16_t event_id_length;
+  // TimeTicks internal value, the clock of the journal and the logs.
+  int64_t time;
+  uint32_t payload_length;
+  uint32_t reserved;
+};
+
+// One per record, in the segment's .idx file.
+struct ArchiveIndexEntry {
+  uint64_t offset;
+  // Header, strings, payload and padding.
+  uint32_t length;
+  uint16_t type;
+  uint16_t reserved;
+  int32_t snapshot_id;
+  // base::Hash() of the event ID.
+  uint32_t event_id_hash;
+};
+
+// Stores the snapshots of a browsing session in a few large append-only
+// files instead of a file per snapshot (--enable-snapshot-archive). Records go
+// to snapshots/archive_<time>_<pid>/segment_<N>.cpa, a new segment every
+// 512MB, and an entry per record to segment_<N>.idx. Appends are batched in
+// memory and written by a "ChromePicArchive" thread in large sequential
+// writes, with an fsync every few seconds rather than per record. The index
+// is written after its records, so a crash loses at most the tail of a
+// segment. tools/chromepic/snapshot_archive.py maps the files for reading.
+class SnapshotArchive {
+ public:
+  // Null unless --enable-snapshot-archive.
+  static SnapshotArchive* GetInstance();
+
+  // Copies a record into the current batch, with |event_id| stored as text
+  // as in the logs. Thread-safe. Returns false if it was dropped because the
+  // writer is too far behind.
+  bool Append(ArchiveRecordType type,
+              const std::string& tab,
+              const std::string& name,
+              int snapshot_id,
+              const base::debug::SnapshotToken& event_id,
+              const char* data,
+              size_t size);
+
+  // Writes and syncs what has been appended so far, on the writer thread.
+  void Flush();
+
+ private:
+  friend struct base::DefaultLazyInstanceTraits<SnapshotArchive>;
+
+  struct Batch {
+    Batch();
+    ~Batch();
+
+    int segment;
+    std::string data;
+    // Offsets are relative to the start of |data| until the writer thread
+    // knows where it landed in the segment.
+    std::vector<ArchiveIndexEntry> index;
+    bool sync;
+  };
+
+  SnapshotArchive();
+  ~SnapshotArchive();
+
+  // Hands the current batch to the writer thread. |lock_| must be held.
+  void PostBatchLocked(bool sync);
+
+  // Writer thread.
+  void WriteBatch(scoped_ptr<Batch> batch);
+  void FlushAndReschedule();
+  bool OpenSegment(int segment);
+  // Returns false unless the whole batch was written.
+  bool WriteRecords(Batch* batch);
+  void CloseSegment();
+  void Sync();
+
+  const bool enabled_;
+  base::FilePath directory_;
+  base::Thread writer_thread_;
+
+  base::Lock lock_;
+  Batch batch_;
+  int segment_;
+  // Size the current segment will have once written, to know when to start
+  // the next one.
+  uint64_t segment_offset_;
+  // Bytes handed to the writer thread and not yet written.
+  size_t queued_bytes_;
+  int64_t dropped_records_;
+
+  // Writer thread only.
+  int open_segment_;
+  // Bytes written to the open segment's data file.
+  uint64_t data_offset_;
+  // A segment that could not be opened or written. Its remaining batches are
+  // dropped, as their records would not be where the index says.
+  int failed_segment_;
+  base::File data_file_;
+  base::File index_file_;
+  int64_t unsynced_bytes_;
+  base::TimeTicks last_sync_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotArchive);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_ARCHIVE_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/snapshot_file_pool.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/location.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/public/browser/browser_thread.h"
+
+namespace content {
+
+namespace {
+
+void RenameFileOnFileThread(const base::FilePath& from, const base::FilePath& to) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  base::File::Error error;
+  if (!base::ReplaceFile(from, to, &error)) {
+    std::ostringstream log_stream;
+    log_stream << "SnapshotFilePool:: Error in renaming " << from.AsUTF8Unsafe()
+               << " to " << to.AsUTF8Unsafe() << ": " << base::File::ErrorToString(error);
+    Logger::LogLineScreen(log_stream.str(), true);
+  }
+}
+
+void DeleteFilesOnFileThread(scoped_ptr<std::vector<base::File>> files,
+                             const std::vector<base::FilePath>& paths) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  files.reset();
+  for (const base::FilePath& path : paths)
+    base::DeleteFile(path, false);
+}
+
+}  // namespace
+
+SnapshotFilePool::SnapshotFilePool(const base::FilePath& directory, size_t size)
+    : directory_(directory),
+      size_(size),
+      opening_(0),
+      next_file_number_(0),
+      misses_(0),
+      weak_factory_(this) {}
+
+SnapshotFilePool::~SnapshotFilePool() {
+  if (paths_.empty())
+    return;
+  // Closing a file is blocking I/O too.
+  scoped_ptr<std::vector<base::File>> files(new std::vector<base::File>);
+  for (base::File& file : files_)
+    files->push_back(std::move(file));
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DeleteFilesOnFileThread, base::Passed(&files),
+                 std::vector<base::FilePath>(paths_.begin(), paths_.end())));
+}
+
+void SnapshotFilePool::Fill() {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (opening_ || files_.size() >= size_)
+    return;
+  size_t count = size_ - files_.size();
+  opening_ = count;
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&SnapshotFilePool::OpenFiles, directory_, next_file_number_,
+                 count, weak_factory_.GetWeakPtr()));
+  next_file_number_ += count;
+}
+
+base::File SnapshotFilePool::Take(int snapshot_id) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (files_.empty()) {
+    misses_++;
+    Fill();
+    return base::File();
+  }
+
+  base::File file = std::move(files_.front());
+  files_.pop_front();
+  base::FilePath placeholder = paths_.front();
+  paths_.pop_front();
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&RenameFileOnFileThread, placeholder,
+                 directory_.AppendASCII("snapshot_" + std::to_string(snapshot_id) + ".mhtml")));
+  Fill();
+  return file;
+}
+
+// static
+void SnapshotFilePool::OpenFiles(const base::FilePath& directory,
+                                 int first_file_number,
+                                 size_t count,
+                                 base::WeakPtr<SnapshotFilePool> pool) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  scoped_ptr<std::vector<base::FilePath>> paths(new std::vector<base::FilePath>);
+  scoped_ptr<std::vector<base::File>> files(new std::vector<base::File>);
+  base::File::Error error;
+  if (!base::CreateDirectoryAndGetError(directory, &error)) {
+    Logger::LogLineScreen("SnapshotFilePool:: Error in creating the DOM snapshot directory!", true);
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      base::FilePath path = directory.AppendASCII(
+          "unused_" + std::to_string(first_file_number + i) + ".mhtml");
+      base::File file(path, base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE |
+                                base::File::FLAG_SHARE_DELETE);
+      if (!file.IsValid())
+        break;
+      paths->push_back(path);
+      files->push_back(std::move(file));
+    }
+  }
+  BrowserThread::PostTask(
+      BrowserThread::UI, FROM_HERE,
+      base::Bind(&SnapshotFilePool::ReplyFilesOpened, pool, base::Passed(&paths),
+                 base::Passed(&files), count));
+}
+
+// static
+void SnapshotFilePool::ReplyFilesOpened(base::WeakPtr<SnapshotFilePool> pool,
+                                        scoped_ptr<std::vector<base::FilePath>> paths,
+                                        scoped_ptr<std::vector<base::File>> files,
+                                        size_t requested) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (pool) {
+    pool->OnFilesOpened(std::move(paths), std::move(files), requested);
+    return;
+  }
+  // The tab went away meanwhile. Closing the files here would be blocking
+  // I/O on the UI thread.
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DeleteFilesOnFileThread, base::Passed(&files), *paths));
+}
+
+void SnapshotFilePool::OnFilesOpened(scoped_ptr<std::vector<base::FilePath>> paths,
+                                     scoped_ptr<std::vector<base::File>> files,
+                                     size_t requested) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  opening_ = 0;
+  for (size_t i = 0; i < files->size(); i++) {
+    paths_.push_back((*paths)[i]);
+    files_.push_back(std::move((*files)[i]));
+  }
+
+  std::ostringstream log_stream;
+  log_stream << "SnapshotFilePool:: Opened files: " << files->size() << "/" << requested
+             << ", Available: " << files_.size() << ", Misses: " << misses_;
+  Logger::LogLineScreen(log_stream.str(), true);
+  // Whatever failed is retried at the next Take().
+}
+
+}  // namespace content
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_FILE_POOL_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_FILE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+
+namespace content {
+
+// DOM snapshot files of a tab, created and opened ahead of time on the FILE
+// thread so that routing an input event never touches the disk. Pooled files
+// are named unused_<N>.mhtml until Take() hands one out for a snapshot; the
+// rename to snapshot_<ID>.mhtml is posted to the FILE thread as well, and is
+// safe while the renderer writes since the file is opened with share-delete.
+// UI thread only.
+class SnapshotFilePool {
+ public:
+  // Keeps up to |size| files open in |directory|, which is created on first
+  // use.
+  SnapshotFilePool(const base::FilePath& directory, size_t size);
+  // Closes and deletes the files still in the pool.
+  ~SnapshotFilePool();
+
+  // Starts creating files until the pool is full, unless that is under way.
+  void Fill();
+
+  // Returns an open file for |snapshot_id|, or an invalid one if the pool ran
+  // dry. Refills the pool either way.
+  base::File Take(int snapshot_id);
+
+  size_t available() const { return files_.size(); }
+  int64_t misses() const { return misses_; }
+
+ private:
+  // Runs on the FILE thread.
+  static void OpenFiles(const base::FilePath& directory,
+                        int first_file_number,
+                        size_t count,
+                        base::WeakPtr<SnapshotFilePool> pool);
+  // Runs on the UI thread. Hands the files to |pool|, or sends them back to
+  // the FILE thread to be closed and deleted if it is gone.
+  static void ReplyFilesOpened(base::WeakPtr<SnapshotFilePool> pool,
+                               scoped_ptr<std::vector<base::FilePath>> paths,
+                               scoped_ptr<std::vector<base::File>> files,
+                               size_t requested);
+
+  void OnFilesOpened(scoped_ptr<std::vector<base::FilePath>> paths,
+                     scoped_ptr<std::vector<base::File>> files,
+                     size_t requested);
+
+  const base::FilePath directory_;
+  const size_t size_;
+  // Files being created on the FILE thread.
+  size_t opening_;
+  int next_file_number_;
+  std::deque<base::FilePath> paths_;
+  std::deque<base::File> files_;
+  // Take() calls that found the pool empty.
+  int64_t misses_;
+
+  base::WeakPtrFactory<SnapshotFilePool> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotFilePool);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_FILE_POOL_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/snapshot_governor.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "base/lazy_instance.h"
+
+namespace content {
+
+namespace {
+
+const double kHalfLifeSeconds = 1.0;
+const double kLn2 = 0.69314718055994531;
+
+// Pressure (load over budget) at which each degradation step starts.
+const double kScreenshotOnlyPressure = 1.0;
+const double kReducedScalePressure = 1.5;
+const double kSkipPressure = 2.0;
+
+// Clicks closer together than this are one burst, of which only the first
+// is protected.
+const int kProtectedClickIntervalMs = 1000;
+
+// The snapshots of all tabs.
+base::LazyInstance<SnapshotCostMeter>::Leaky g_global_cost =
+    LAZY_INSTANCE_INITIALIZER;
+
+const char* const kDecisionNames[] = {"full", "screenshot only",
+                                      "reduced scale", "skip"};
+
+}  // namespace
+
+SnapshotCostMeter::SnapshotCostMeter() : ms_(0), bytes_(0) {}
+
+void SnapshotCostMeter::Add(base::TimeTicks now, base::TimeDelta time,
+                            int64_t bytes) {
+  DecayTo(now);
+  ms_ += time.InMillisecondsF();
+  bytes_ += bytes;
+}
+
+double SnapshotCostMeter::MsPerSecond(base::TimeTicks now) {
+  DecayTo(now);
+  // A steady rate r adds up to r * half-life / ln 2.
+  return ms_ * kLn2 / kHalfLifeSeconds;
+}
+
+double SnapshotCostMeter::BytesPerSecond(base::TimeTicks now) {
+  DecayTo(now);
+  return bytes_ * kLn2 / kHalfLifeSeconds;
+}
+
+void SnapshotCostMeter::DecayTo(base::TimeTicks now) {
+  // Tabs may report slightly out of order; time never runs backwards here.
+  if (!last_update_.is_null() && now <= last_update_)
+    return;
+  if (!last_update_.is_null()) {
+    double factor =
+        exp2(-(now - last_update_).InSecondsF() / kHalfLifeSeconds);
+    ms_ *= factor;
+    bytes_ *= factor;
+  }
+  last_update_ = now;
+}
+
+SnapshotGovernor::Budget::Budget()
+    : tab_ms_per_second(200),
+      global_ms_per_second(500),
+      tab_bytes_per_second(64 * 1024 * 1024),
+      global_bytes_per_second(256 * 1024 * 1024) {}
+
+SnapshotGovernor::SnapshotGovernor(const Budget& budget)
+    : budget_(budget), tab_pressure_(0), global_pressure_(0) {}
+
+SnapshotGovernor::~SnapshotGovernor() {}
+
+SnapshotGovernor::Decision SnapshotGovernor::Decide(base::TimeTicks now,
+                                                    EventKind kind,
+                                                    const char** reason) {
+  SnapshotCostMeter* global_cost = g_global_cost.Pointer();
+  tab_pressure_ = std::max(
+      tab_cost_.MsPerSecond(now) / budget_.tab_ms_per_second,
+      tab_cost_.BytesPerSecond(now) / budget_.tab_bytes_per_second);
+  global_pressure_ = std::max(
+      global_cost->MsPerSecond(now) / budget_.global_ms_per_second,
+      global_cost->BytesPerSecond(now) / budget_.global_bytes_per_second);
+
+  if (kind == EVENT_ENTER) {
+    *reason = "enter is protected";
+    return DECISION_FULL;
+  }
+  if (kind == EVENT_CLICK &&
+      (last_protected_click_.is_null() ||
+       now - last_protected_click_ >=
+           base::TimeDelta::FromMilliseconds(kProtectedClickIntervalMs))) {
+    last_protected_click_ = now;
+    *reason = "first click of a burst is protected";
+    return DECISION_FULL;
+  }
+
+  const double pressure = std::max(tab_pressure_, global_pressure_);
+  if (pressure < kScreenshotOnlyPressure) {
+    *reason = "within budget";
+    return DECISION_FULL;
+  }
+  *reason = tab_pressure_ >= global_pressure_ ? "tab over budget"
+                                              : "all tabs over budget";
+  if (pressure < kReducedScalePressure)
+    return DECISION_SCREENSHOT_ONLY;
+  if (pressure < kSkipPressure)
+    return DECISION_REDUCED_SCALE;
+  return DECISION_SKIP;
+}
+
+void SnapshotGovernor::RecordScreenshot(base::TimeTicks now,
+                                        base::TimeDelta readback_time,
+                                        size_t bytes) {
+  Record(now, readback_time, static_cast<int64_t>(bytes));
+}
+
+void SnapshotGovernor::RecordDOMSnapshot(base::TimeTicks now,
+                                         base::TimeDelta latency,
+                                         int64_t bytes) {
+  Record(now, latency, bytes);
+}
+
+void SnapshotGovernor::Record(base::TimeTicks now, base::TimeDelta time,
+                              int64_t bytes) {
+  tab_cost_.Add(now, time, bytes);
+  g_global_cost.Pointer()->Add(now, time, bytes);
+}
+
+// static
+const char* SnapshotGovernor::DecisionName(Decision decision) {
+  return kDecisionNames[decision];
+}
+
+}  // namespace content
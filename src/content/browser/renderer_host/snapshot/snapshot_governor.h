@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_GOVERNOR_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_GOVERNOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/time/time.h"
+
+namespace content {
+
+// Capture time and bytes of recent snapshots, as sums that halve every
+// second. Read as rates, they are the cost per second of the last few
+// seconds.
+class SnapshotCostMeter {
+ public:
+  SnapshotCostMeter();
+
+  void Add(base::TimeTicks now, base::TimeDelta time, int64_t bytes);
+
+  double MsPerSecond(base::TimeTicks now);
+  double BytesPerSecond(base::TimeTicks now);
+
+ private:
+  void DecayTo(base::TimeTicks now);
+
+  base::TimeTicks last_update_;
+  double ms_;
+  double bytes_;
+};
+
+// Scales a tab's snapshots back when they, or the snapshots of all tabs
+// together, cost more than their budget (--enable-snapshot-governor). The
+// cost is what SnapshotHandler measures: readback time (from the readback
+// slot being granted, not from the request) and raw bytes of screenshots,
+// and event-to-acknowledgement time and size of DOM snapshots.
+// Over budget a snapshot first loses its DOM snapshot, then is read back at
+// half scale, then is skipped. Enter, and a primary click at most once a
+// second, always get a full snapshot: the browser cannot tell which click
+// will commit a navigation, but a burst of clicks commits at most one.
+// UI thread only.
+class SnapshotGovernor {
+ public:
+  enum Decision {
+    // As SnapshotHandler's heuristics decided.
+    DECISION_FULL,
+    DECISION_SCREENSHOT_ONLY,
+    // Screenshot only, at half the configured scale.
+    DECISION_REDUCED_SCALE,
+    DECISION_SKIP,
+  };
+
+  enum EventKind {
+    EVENT_ORDINARY,
+    EVENT_CLICK,
+    EVENT_ENTER,
+  };
+
+  struct Budget {
+    Budget();
+
+    // Capture time per second (--snapshot-tab-budget-ms,
+    // --snapshot-global-budget-ms).
+    int tab_ms_per_second;
+    int global_ms_per_second;
+    // Captured bytes per second (--snapshot-tab-budget-mb,
+    // --snapshot-global-budget-mb).
+    int64_t tab_bytes_per_second;
+    int64_t global_bytes_per_second;
+  };
+
+  explicit SnapshotGovernor(const Budget& budget);
+  ~SnapshotGovernor();
+
+  // Decides a snapshot event's fate. |reason| is set to a static string.
+  Decision Decide(base::TimeTicks now, EventKind kind, const char** reason);
+
+  void RecordScreenshot(base::TimeTicks now, base::TimeDelta readback_time,
+                        size_t bytes);
+  void RecordDOMSnapshot(base::TimeTicks now, base::TimeDelta latency,
+                         int64_t bytes);
+
+  // Load at the last Decide(), as a fraction of the budget.
+  double tab_pressure() const { return tab_pressure_; }
+  double global_pressure() const { return global_pressure_; }
+
+  static const char* DecisionName(Decision decision);
+
+ private:
+  void Record(base::TimeTicks now, base::TimeDelta time, int64_t bytes);
+
+  const Budget budget_;
+  SnapshotCostMeter tab_cost_;
+  base::TimeTicks last_protected_click_;
+  double tab_pressure_;
+  double global_pressure_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotGovernor);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_GOVERNOR_H_
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/snapshot_governor.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+namespace {
+
+const double kLn2 = 0.69314718055994531;
+const int kTabMsPerSecond = 100;
+
+// The cost of all tabs is shared between governors, so the tests only ever
+// push a tab over its budget.
+SnapshotGovernor::Budget TabOnlyBudget() {
+  SnapshotGovernor::Budget budget;
+  budget.tab_ms_per_second = kTabMsPerSecond;
+  budget.tab_bytes_per_second = INT64_C(1) << 50;
+  budget.global_ms_per_second = 1000 * 1000 * 1000;
+  budget.global_bytes_per_second = INT64_C(1) << 50;
+  return budget;
+}
+
+base::TimeTicks Start() {
+  return base::TimeTicks() + base::TimeDelta::FromSeconds(1000);
+}
+
+class SnapshotGovernorTest : public testing::Test {
+ protected:
+  SnapshotGovernorTest() : governor_(new SnapshotGovernor(TabOnlyBudget())) {}
+
+  // Records screenshot time that puts the tab at |pressure| times its budget
+  // at |now|.
+  void SetTabPressure(base::TimeTicks now, double pressure) {
+    governor_->RecordScreenshot(
+        now,
+        base::TimeDelta::FromMicroseconds(static_cast<int64_t>(
+            pressure * kTabMsPerSecond * 1000 / kLn2)),
+        0);
+  }
+
+  SnapshotGovernor::Decision Decide(base::TimeTicks now,
+                                    SnapshotGovernor::EventKind kind) {
+    const char* reason = nullptr;
+    SnapshotGovernor::Decision decision = governor_->Decide(now, kind, &reason);
+    EXPECT_TRUE(reason);
+    return decision;
+  }
+
+  void ResetGovernor() { governor_.reset(new SnapshotGovernor(TabOnlyBudget())); }
+
+  scoped_ptr<SnapshotGovernor> governor_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SnapshotGovernorTest);
+};
+
+}  // namespace
+
+TEST_F(SnapshotGovernorTest, PressureThresholds) {
+  const struct {
+    double pressure;
+    SnapshotGovernor::Decision decision;
+  } kCases[] = {
+      {0, SnapshotGovernor::DECISION_FULL},
+      {0.99, SnapshotGovernor::DECISION_FULL},
+      {1.01, SnapshotGovernor::DECISION_SCREENSHOT_ONLY},
+      {1.49, SnapshotGovernor::DECISION_SCREENSHOT_ONLY},
+      {1.51, SnapshotGovernor::DECISION_REDUCED_SCALE},
+      {1.99, SnapshotGovernor::DECISION_REDUCED_SCALE},
+      {2.01, SnapshotGovernor::DECISION_SKIP},
+      {10, SnapshotGovernor::DECISION_SKIP},
+  };
+  for (const auto& test_case : kCases) {
+    ResetGovernor();
+    SetTabPressure(Start(), test_case.pressure);
+    EXPECT_EQ(test_case.decision,
+              Decide(Start(), SnapshotGovernor::EVENT_ORDINARY))
+        << "Pressure: " << test_case.pressure;
+    EXPECT_NEAR(test_case.pressure, governor_->tab_pressure(), 0.001);
+  }
+}
+
+TEST_F(SnapshotGovernorTest, EnterIsAlwaysFull) {
+  SetTabPressure(Start(), 10);
+  EXPECT_EQ(SnapshotGovernor::DECISION_SKIP,
+            Decide(Start(), SnapshotGovernor::EVENT_ORDINARY));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(SnapshotGovernor::DECISION_FULL,
+              Decide(Start() + base::TimeDelta::FromMilliseconds(i),
+                     SnapshotGovernor::EVENT_ENTER));
+  }
+}
+
+TEST_F(SnapshotGovernorTest, FirstClickOfBurstIsProtected) {
+  // Still over twice the budget two seconds later.
+  SetTabPressure(Start(), 10);
+  EXPECT_EQ(SnapshotGovernor::DECISION_FULL,
+            Decide(Start(), SnapshotGovernor::EVENT_CLICK));
+  EXPECT_EQ(SnapshotGovernor::DECISION_SKIP,
+            Decide(Start() + base::TimeDelta::FromMilliseconds(500),
+                   SnapshotGovernor::EVENT_CLICK));
+  EXPECT_EQ(SnapshotGovernor::DECISION_SKIP,
+            Decide(Start() + base::TimeDelta::FromMilliseconds(999),
+                   SnapshotGovernor::EVENT_CLICK));
+
+  // A second after the protected click a new burst starts.
+  EXPECT_EQ(SnapshotGovernor::DECISION_FULL,
+            Decide(Start() + base::TimeDelta::FromMilliseconds(1000),
+                   SnapshotGovernor::EVENT_CLICK));
+  EXPECT_EQ(SnapshotGovernor::DECISION_SKIP,
+            Decide(Start() + base::TimeDelta::FromMilliseconds(1500),
+                   SnapshotGovernor::EVENT_CLICK));
+}
+
+TEST_F(SnapshotGovernorTest, PressureHalvesEverySecond) {
+  SetTabPressure(Start(), 1.2);
+  EXPECT_EQ(SnapshotGovernor::DECISION_SCREENSHOT_ONLY,
+            Decide(Start(), SnapshotGovernor::EVENT_ORDINARY));
+
+  EXPECT_EQ(SnapshotGovernor::DECISION_FULL,
+            Decide(Start() + base::TimeDelta::FromSeconds(1),
+                   SnapshotGovernor::EVENT_ORDINARY));
+  EXPECT_NEAR(0.6, governor_->tab_pressure(), 0.001);
+}
+
+TEST(SnapshotCostMeterTest, HalvesEverySecond) {
+  SnapshotCostMeter meter;
+  meter.Add(Start(), base::TimeDelta::FromMilliseconds(100), 1000);
+  EXPECT_NEAR(100 * kLn2, meter.MsPerSecond(Start()), 0.001);
+  EXPECT_NEAR(1000 * kLn2, meter.BytesPerSecond(Start()), 0.001);
+
+  base::TimeTicks later = Start() + base::TimeDelta::FromSeconds(1);
+  EXPECT_NEAR(50 * kLn2, meter.MsPerSecond(later), 0.001);
+  EXPECT_NEAR(500 * kLn2, meter.BytesPerSecond(later), 0.001);
+
+  later += base::TimeDelta::FromMilliseconds(500);
+  EXPECT_NEAR(50 * kLn2 / sqrt(2.0), meter.MsPerSecond(later), 0.001);
+
+  // Reports from the past do not decay the sums again.
+  EXPECT_NEAR(50 * kLn2 / sqrt(2.0), meter.MsPerSecond(Start()), 0.001);
+}
+
+}  // namespace content
@@ -9,13 +9,24 @@
 
 #include "content/browser/renderer_host/snapshot/snapshot_handler.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "base/command_line.h"
+#include "base/debug/forensic_log.h"
 #include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/thread_task_runner_handle.h"
+#include "base/time/default_tick_clock.h"
 #include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
+#include "content/browser/renderer_host/snapshot/forensic_log_collector.h"
+#include "content/browser/renderer_host/snapshot/resource_store.h"
 #include "content/browser/renderer_host/snapshot/screenshot.h"
+#include "content/browser/renderer_host/snapshot/snapshot_archive.h"
 #include "content/common/input_messages.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/browser/frame_host/render_frame_host_impl.h"
@@ -39,6 +50,31 @@ using base::Time;
 
 namespace content {
 
+namespace {
+
+// Snapshot events tracked at once per tab. Both parts of a snapshot normally
+// arrive within a few hundred milliseconds, so only a burst of this many
+// snapshot events with a stalled readback causes evictions.
+const size_t kPendingSnapshotTableSize = 64;
+
+// DOM snapshot files kept open per tab; enough for a burst of clicks while
+// the FILE thread refills the pool.
+const int kDefaultDOMSnapshotFilePoolSize = 8;
+
+// Enter, and primary clicks and taps, may commit a navigation.
+SnapshotGovernor::EventKind GetGovernorEventKind(const WebInputEvent& input_event) {
+  if (input_event.type == WebInputEvent::RawKeyDown &&
+      static_cast<const WebKeyboardEvent&>(input_event).windowsKeyCode == VK_RETURN)
+    return SnapshotGovernor::EVENT_ENTER;
+  if ((input_event.type == WebInputEvent::MouseDown &&
+       static_cast<const WebMouseEvent&>(input_event).button == WebMouseEvent::ButtonLeft) ||
+      input_event.type == WebInputEvent::GestureTapDown)
+    return SnapshotGovernor::EVENT_CLICK;
+  return SnapshotGovernor::EVENT_ORDINARY;
+}
+
+}  // namespace
+
 SnapshotHandler::SnapshotHandler(IPC::Sender* sender,
                                  InputRouterClient* client,
                                  int routing_id)
@@ -50,12 +86,23 @@ SnapshotHandler::SnapshotHandler(IPC::Sender* sender,
       dom_snapshot_enabled(true),
       selective_screenshot_enabled(true),
       selective_dom_snapshot_enabled(true),
+      delta_dom_snapshot_enabled(false),
+      dom_snapshot_resource_store_enabled(false),
+      pending_snapshots_(kPendingSnapshotTableSize),
       last_key_press(-1),
       last_key_press_time(-1),
       key_press_interval(5000000),
       last_mouse_move_time(-1),
+      tick_clock_(new base::DefaultTickClock()),
+      screenshot_wait_timeout_ms(0),
+      screenshot_scale(1.f),
+      screenshot_i420(false),
+      last_screenshot_id(0),
+      screenshots_since_keyframe(0),
+      ipc_message_stats_interval(0),
       web_contents(0),
-      url_id(-1){
+      url_id(-1),
+      weak_factory_(this) {
 
    //Select Inputs for optimization
    select_input_set.insert(VK_BACK);
@@ -81,6 +128,104 @@ SnapshotHandler::SnapshotHandler(IPC::Sender* sender,
    else if (command_line.HasSwitch("enable-all-dom-snapshots"))
       selective_dom_snapshot_enabled = false;
 
+   if (command_line.HasSwitch("enable-delta-dom-snapshots"))
+      delta_dom_snapshot_enabled = true;
+
+   if (command_line.HasSwitch("enable-dom-snapshot-resource-store"))
+      dom_snapshot_resource_store_enabled = true;
+
+   if (command_line.HasSwitch("screenshot-wait-timeout-ms")) {
+      int timeout_ms;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("screenshot-wait-timeout-ms"), &timeout_ms) &&
+          timeout_ms >= 0)
+          screenshot_wait_timeout_ms = timeout_ms;
+   }
+
+   screenshot_options.site_id = reinterpret_cast<intptr_t>(this);
+   if (command_line.HasSwitch("screenshot-format") &&
+       !ParseScreenshotFormat(command_line.GetSwitchValueASCII("screenshot-format"), &screenshot_options.format))
+      logger_->LogLineScreen("SnapshotHandler::SnapshotHandler: Unknown screenshot format, using png");
+
+   if (command_line.HasSwitch("enable-screenshot-dedup"))
+      screenshot_options.dedup_enabled = true;
+
+   if (command_line.HasSwitch("screenshot-dedup-max-changed-tiles")) {
+      int max_changed_tiles;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("screenshot-dedup-max-changed-tiles"), &max_changed_tiles) &&
+          max_changed_tiles >= 0)
+          screenshot_options.dedup_max_changed_tiles = max_changed_tiles;
+   }
+
+   if (command_line.HasSwitch("screenshot-scale")) {
+      double scale;
+      if (base::StringToDouble(command_line.GetSwitchValueASCII("screenshot-scale"), &scale) &&
+          scale > 0 && scale <= 1)
+          screenshot_scale = static_cast<float>(scale);
+   }
+
+   if (command_line.GetSwitchValueASCII("screenshot-pixel-format") == "i420")
+      screenshot_i420 = true;
+
+   if (command_line.HasSwitch("enable-tile-diff-screenshots"))
+      screenshot_options.tile_diff_enabled = true;
+
+   if (command_line.HasSwitch("screenshot-keyframe-interval")) {
+      int keyframe_interval;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("screenshot-keyframe-interval"), &keyframe_interval) &&
+          keyframe_interval > 0)
+          screenshot_options.keyframe_interval = keyframe_interval;
+   }
+
+   // A near duplicate is stored as a reference to a different frame, so the
+   // tile delta after it would be against pixels that were never written.
+   if (screenshot_options.tile_diff_enabled && screenshot_options.dedup_max_changed_tiles) {
+      logger_->LogLineScreen("SnapshotHandler::SnapshotHandler: Tile diffs are on, only deduping identical screenshots");
+      screenshot_options.dedup_max_changed_tiles = 0;
+   }
+
+   if (command_line.HasSwitch("snapshot-log-max-bytes")) {
+      int64_t max_bytes;
+      if (base::StringToInt64(command_line.GetSwitchValueASCII("snapshot-log-max-bytes"), &max_bytes) &&
+          max_bytes >= 0)
+          logger_->set_max_file_bytes(max_bytes);
+   }
+
+   int dom_snapshot_file_pool_size = kDefaultDOMSnapshotFilePoolSize;
+   if (command_line.HasSwitch("dom-snapshot-file-pool-size")) {
+      int size;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("dom-snapshot-file-pool-size"), &size) &&
+          size > 0)
+          dom_snapshot_file_pool_size = size;
+   }
+   dom_snapshot_files_.reset(new SnapshotFilePool(GetMHTMLDirectory(), dom_snapshot_file_pool_size));
+
+   // --ipc-message-stats alone counts every message.
+   if (command_line.HasSwitch("ipc-message-stats")) {
+      int interval;
+      if (!base::StringToInt(command_line.GetSwitchValueASCII("ipc-message-stats"), &interval) ||
+          interval < 1)
+          interval = 1;
+      ipc_message_stats_interval = interval;
+   }
+
+   if (command_line.HasSwitch("enable-snapshot-governor")) {
+      SnapshotGovernor::Budget budget;
+      int value;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("snapshot-tab-budget-ms"), &value) &&
+          value > 0)
+          budget.tab_ms_per_second = value;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("snapshot-global-budget-ms"), &value) &&
+          value > 0)
+          budget.global_ms_per_second = value;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("snapshot-tab-budget-mb"), &value) &&
+          value > 0)
+          budget.tab_bytes_per_second = static_cast<int64_t>(value) * 1024 * 1024;
+      if (base::StringToInt(command_line.GetSwitchValueASCII("snapshot-global-budget-mb"), &value) &&
+          value > 0)
+          budget.global_bytes_per_second = static_cast<int64_t>(value) * 1024 * 1024;
+      governor_.reset(new SnapshotGovernor(budget));
+   }
+
     if (command_line.HasSwitch("disable-randomized-snapshots")) {
        random_snapshots_enabled = false;
        take_random_snapshot = true;
@@ -92,16 +237,46 @@ SnapshotHandler::SnapshotHandler(IPC::Sender* sender,
 
     std::ostringstream ss;
     ss << "SnapshotHandler::SnapshotHandler: Flags- " << "Screenshot Enabled: " << screenshot_enabled << ", Selective Screenshot Enabled: " << selective_screenshot_enabled 
-        << ", DOM Snapshot Enabled: " << dom_snapshot_enabled << ", Selective DOM Snapshot Enabled: " << selective_dom_snapshot_enabled << ", Randomization Enabled: " <<
-        random_snapshots_enabled << ", Taking Random Snapshot: " << take_random_snapshot;
+        << ", DOM Snapshot Enabled: " << dom_snapshot_enabled << ", Selective DOM Snapshot Enabled: " << selective_dom_snapshot_enabled
+        << ", Delta DOM Snapshot Enabled: " << delta_dom_snapshot_enabled
+        << ", DOM Snapshot Resource Store Enabled: " << dom_snapshot_resource_store_enabled << ", Randomization Enabled: " <<
+        random_snapshots_enabled << ", Taking Random Snapshot: " << take_random_snapshot <<
+        ", Screenshot Wait Timeout (ms): " << screenshot_wait_timeout_ms <<
+        ", Screenshot Scale: " << screenshot_scale << ", Screenshot I420: " << screenshot_i420 <<
+        ", Screenshot Format: " << ScreenshotFormatName(screenshot_options.format) <<
+        ", Screenshot Dedup Enabled: " << screenshot_options.dedup_enabled <<
+        ", Screenshot Dedup Max Changed Tiles: " << screenshot_options.dedup_max_changed_tiles <<
+        ", Tile Diff Screenshots Enabled: " << screenshot_options.tile_diff_enabled <<
+        ", Screenshot Keyframe Interval: " << screenshot_options.keyframe_interval <<
+        ", Log Max Bytes: " << logger_->max_file_bytes() <<
+        ", IPC Message Stats Interval: " << ipc_message_stats_interval <<
+        ", DOM Snapshot File Pool Size: " << dom_snapshot_file_pool_size <<
+        ", Snapshot Governor Enabled: " << (governor_.get() != nullptr) <<
+        ", Snapshot Archive Enabled: " << (SnapshotArchive::GetInstance() != nullptr);
     logger_->LogLineScreen(ss.str());
+    if (SnapshotArchive* archive = SnapshotArchive::GetInstance()) {
+        std::string flags = ss.str();
+        archive->Append(ARCHIVE_RECORD_METADATA, output_directory_name, "flags", 0, base::debug::SnapshotToken(),
+                        flags.data(), flags.size());
+    }
 }
 
 SnapshotHandler::~SnapshotHandler(){
     fprintf(stderr, "In SnapshotHandler destructor!!");
+    ForgetScreenshots(output_directory_name);
+    EventJournal::GetInstance()->Flush();
 }
 
-FilePath SnapshotHandler::GetMHTMLFilePath(){
+JournalEntry SnapshotHandler::CreateJournalEntry(JournalStage stage, const ui::LatencyInfo& latency_info) {
+    JournalEntry entry(stage);
+    // site_id is this pointer printed in hex.
+    entry.site_id = reinterpret_cast<intptr_t>(this);
+    entry.url_id = url_id;
+    entry.trace_id = latency_info.trace_id();
+    return entry;
+}
+
+FilePath SnapshotHandler::GetMHTMLDirectory(){
         FilePath cur;
 
         #if defined(OS_ANDROID)
@@ -118,74 +293,68 @@ FilePath SnapshotHandler::GetMHTMLFilePath(){
             std::wstring name_wstring(output_directory_name.begin(), output_directory_name.end());
             cur = cur.Append(name_wstring);
         #endif
-
-        //TODO(ChromePic): Move this to a file thread and remove the
-        //dirty override in base/threading/thread_restrictions.cc
-        File::Error error;
-        if (!base::CreateDirectoryAndGetError(cur, &error)){
-	    std::ostringstream ss;
-	    ss << "SnapshotHandler:: GetMHTMLFilePath error in creating directory! ";
-	    logger_->LogLineScreen(ss.str(), true);
-
-            fprintf(stderr, "Error in creating an output directory for the snapshots!\n");
-            return cur;
-        }
-        std::string file_name = "snapshot_" + std::to_string(next_snapshot_id_) + ".mhtml";
-        //std::string file_name = "snapshot_" + std::to_string(0) + ".html";
-
-        #if defined(OS_POSIX)
-            cur = cur.Append(file_name);
-        #elif defined(OS_WIN)
-            std::wstring wfile_name(file_name.begin(), file_name.end());
-            cur = cur.Append(wfile_name);
-        #endif
         return cur;
 }
 
-void SnapshotHandler::LogEventMetadata(const WebInputEvent *input_event, std::string event_id){
-    std::stringstream log_stream;
+void SnapshotHandler::LogEventMetadata(const WebInputEvent *input_event, const ui::LatencyInfo& latency_info){
+    JournalEntry entry = CreateJournalEntry(JOURNAL_STAGE_EVENT_METADATA, latency_info);
+    entry.event_type = input_event->type;
 
-    if (input_event->type == WebInputEvent::MouseDown || input_event->type == WebInputEvent::MouseUp) {
+    // Mouse moves carry their deltas in place of a second coordinate pair; the
+    // journal keeps the position, which is what post processing pairs on.
+    if (input_event->type == WebInputEvent::MouseDown || input_event->type == WebInputEvent::MouseUp ||
+        input_event->type == WebInputEvent::MouseMove) {
         const WebMouseEvent& mouse_event = static_cast<const WebMouseEvent&>(*input_event);
-        log_stream << "SnapshotHandler:: LogEventMetadata Click Coordinates: " <<  mouse_event.x << ", " << mouse_event.y << ", Event ID: " << event_id;
-        Logger::LogLineScreen(log_stream.str(), true);
-    }
-
-    if (input_event->type == WebInputEvent::MouseMove) {
-        const WebMouseEvent& mouse_event = static_cast<const WebMouseEvent&>(*input_event);
-        log_stream << "SnapshotHandler:: LogEventMetadata MouseMove Coordinates: " <<  mouse_event.x << ", " << mouse_event.y << 
-                   ", Deltas: " << mouse_event.movementX << ", " << mouse_event.movementY << ", Event ID: " << event_id;
-        Logger::LogLineScreen(log_stream.str(), true);
+        entry.arg0 = mouse_event.x;
+        entry.arg1 = mouse_event.y;
+        EventJournal::Record(&entry);
     }
 
     if (WebInputEvent::isKeyboardEventType(input_event->type)) {
-        log_stream << "SnapshotHandler:: LogEventMetadata Key Code: " << static_cast<const WebKeyboardEvent&>(*input_event).windowsKeyCode << ", Event ID: " << event_id;
-        Logger::LogLineScreen(log_stream.str(), true);
+        entry.arg0 = static_cast<const WebKeyboardEvent&>(*input_event).windowsKeyCode;
+        EventJournal::Record(&entry);
     }
 
     // We should pair this with the appropriated TouchStart event during post processing
     if (input_event->type == WebInputEvent::GestureTapDown) {
         const WebGestureEvent& gesture_event = static_cast<const WebGestureEvent&>(*input_event);
-        log_stream << "SnapshotHandler:: LogEventMetadata GestureTapDown Coordinates: " <<  gesture_event.x << ", " << gesture_event.y << 
-                   ", Event ID: " << event_id;
-        Logger::LogLineScreen(log_stream.str(), true);
+        entry.arg0 = gesture_event.x;
+        entry.arg1 = gesture_event.y;
+        EventJournal::Record(&entry);
     }
-    log_stream.str("");
 }
 
-MHTML_Params SnapshotHandler::GenerateMHTMLParams(bool screenshot_active, bool dom_snapshot_active, std::string event_id){
+MHTML_Params SnapshotHandler::GenerateMHTMLParams(bool screenshot_active, bool dom_snapshot_active,
+                                                  const base::debug::SnapshotToken& event_id,
+                                                  base::File dom_snapshot_file){
+  // Start of the snapshot's flow.
+  TRACE_EVENT_WITH_FLOW1("forensics", "SnapshotHandler::GenerateMHTMLParams",
+                         base::debug::ForensicFlowId(event_id, next_snapshot_id_),
+                         screenshot_active || dom_snapshot_active
+                             ? TRACE_EVENT_FLAG_FLOW_OUT : TRACE_EVENT_FLAG_NONE,
+                         "snapshot_id", next_snapshot_id_);
   MHTML_Params mhtml_params;
   mhtml_params.screenshot_active = screenshot_active;
   mhtml_params.dom_snapshot_active = dom_snapshot_active;
+  mhtml_params.dom_snapshot_delta = delta_dom_snapshot_enabled;
+  mhtml_params.dom_snapshot_resource_store = dom_snapshot_resource_store_enabled;
+  mhtml_params.url_id = url_id;
+  mhtml_params.screenshot_wait_timeout_ms = screenshot_wait_timeout_ms;
   mhtml_params.snapshot_id = next_snapshot_id_;
   mhtml_params.event_id = event_id;
-  if (web_contents && dom_snapshot_active) {
-      FilePath file_path = GetMHTMLFilePath();
-      uint32_t file_flags = base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE;
-      base::File browser_file(file_path, file_flags);
+  if (web_contents == 1 && dom_snapshot_active && dom_snapshot_file.IsValid()) {
+      // The renderer writes the file while it holds the event, so the write
+      // is counted but never queued.
+      InputEventArg* pending = pending_snapshots_.Find(next_snapshot_id_);
+      if (pending) {
+          pending->dom_snapshot_write_slot =
+              SnapshotScheduler::GetInstance()->AcquireNow(SnapshotScheduler::RESOURCE_WRITE);
+      }
+      // The channel closes the browser's handle once it has been sent, so
+      // nothing is closed (blocking) on this thread.
       mhtml_params.destination_file = IPC::GetFileHandleForProcess(
-      browser_file.GetPlatformFile(), rvh->GetProcess()->GetHandle(),
-      false);  // last parameter: close_file_handle
+      dom_snapshot_file.TakePlatformFile(), rvh->GetProcess()->GetHandle(),
+      true);  // last parameter: close_file_handle
   }
   mhtml_params.mhtml_boundary_marker = net::GenerateMimeMultipartBoundary(); 
   /*
@@ -224,47 +393,196 @@ void SnapshotHandler::ScreenshotCaptured(
 
     InputEventArg* input_event;
     input_event = FindInputEvent(snapshot_id);
+    base::debug::SnapshotToken event_id =
+        input_event ? input_event->event_id : base::debug::SnapshotToken();
+    TRACE_EVENT_WITH_FLOW1("forensics", "SnapshotHandler::ScreenshotCaptured",
+                           base::debug::ForensicFlowId(event_id, snapshot_id),
+                           TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+                           "snapshot_id", snapshot_id);
     std::ostringstream ss;
-    ss << "Screenshot callback,\t Event ID: " << input_event->event_id;
+    ss << "Screenshot callback,\t Event ID: " << event_id;
     logger_->LogLineScreen(ss.str(), true);
-
-    sender_->Send(new InputMsg_ScreenshotCaptured(routing_id_, snapshot_id, input_event->event_id, false)); 
+    JournalEntry entry(JOURNAL_STAGE_SCREENSHOT_CAPTURED);
+    SetJournalEventId(event_id, &entry);
+    entry.snapshot_id = snapshot_id;
+    entry.arg0 = response;
+    EventJournal::Record(&entry);
+
+    // The renderer may be holding the event back, so release it even if the
+    // snapshot was evicted in the meantime.
+    sender_->Send(new InputMsg_ScreenshotCaptured(routing_id_, snapshot_id, event_id, false)); 
     //fprintf(stderr, "Snapshot_id is: %d \n", snapshot_id);
     if (!input_event) {
         fprintf(stderr, "SnapshotHandler::ScreenshotCaptured: Error, no input event found\n");
         return;
     }
 
+    if (governor_ && response == content::READBACK_SUCCESS &&
+        !input_event->readback_start_time.is_null()) {
+        base::TimeTicks now = tick_clock_->NowTicks();
+        governor_->RecordScreenshot(now, now - input_event->readback_start_time, bitmap.getSize());
+    }
     input_event->screenshot_received = true;
     input_event->UpdateStatus();
+    pending_snapshots_.RemoveIfComplete(snapshot_id);
     if (response == content::READBACK_SUCCESS) {
-         BrowserThread::PostTask(BrowserThread::FILE, FROM_HERE, 
-                 base::Bind(&PrintScreenshot, bitmap, output_directory_name, snapshot_id));
+         SkBitmap previous_bitmap;
+         if (screenshot_options.tile_diff_enabled) {
+             // Keyframe every |keyframe_interval| screenshots, the rest are
+             // tile deltas against the screenshot before them.
+             if (!last_screenshot.isNull() &&
+                 last_screenshot.width() == bitmap.width() &&
+                 last_screenshot.height() == bitmap.height() &&
+                 ++screenshots_since_keyframe < screenshot_options.keyframe_interval)
+                 previous_bitmap = last_screenshot;
+             else
+                 screenshots_since_keyframe = 0;
+             // Readback bitmaps are not reused, so keeping a reference is safe.
+             last_screenshot = bitmap;
+         }
+         ScreenshotOptions options = screenshot_options;
+         options.priority = client_->GetSnapshotPriority();
+         PostPrintScreenshot(bitmap, output_directory_name, snapshot_id, event_id,
+                             previous_bitmap, last_screenshot_id, options,
+                             base::Bind(&SnapshotHandler::ScreenshotWriteFailed,
+                                        weak_factory_.GetWeakPtr()));
+         last_screenshot_id = snapshot_id;
     }
     else {
         //fprintf(stderr, "Failed to capture screenshot :( \n");
     }
 }
 
-void SnapshotHandler::SendScreenshotRequest(std::string event_id){
-      //TODO(ChromePic): The object might not be alive during callback! Change this...
+void SnapshotHandler::DOMSnapshotCaptured(int snapshot_id, int64_t size) {
+    InputEventArg* input_event = FindInputEvent(snapshot_id);
+    TRACE_EVENT_WITH_FLOW1("forensics", "SnapshotHandler::DOMSnapshotCaptured",
+                           base::debug::ForensicFlowId(
+                               input_event ? input_event->event_id : base::debug::SnapshotToken(),
+                               snapshot_id),
+                           TRACE_EVENT_FLAG_FLOW_IN, "snapshot_id", snapshot_id);
+    std::ostringstream ss;
+    ss << "SnapshotHandler:: DOM snapshot callback, Snapshot ID: " << snapshot_id
+       << ", Size: " << size << ", Event ID: "
+       << (input_event ? input_event->event_id : base::debug::SnapshotToken());
+    logger_->LogLineScreen(ss.str(), true);
+    JournalEntry entry(JOURNAL_STAGE_DOM_SNAPSHOT_CAPTURED);
+    if (input_event)
+        SetJournalEventId(input_event->event_id, &entry);
+    entry.snapshot_id = snapshot_id;
+    entry.arg0 = static_cast<int32_t>(size / 1024);
+    EventJournal::Record(&entry);
+    if (!input_event)
+        return;
+
+    if (governor_) {
+        base::TimeTicks now = tick_clock_->NowTicks();
+        governor_->RecordDOMSnapshot(now, now - input_event->requested_time, size);
+    }
+    if (SnapshotArchive* archive = SnapshotArchive::GetInstance()) {
+        std::string size_string = std::to_string(size);
+        archive->Append(ARCHIVE_RECORD_DOM_SNAPSHOT, output_directory_name,
+                        "snapshot_" + std::to_string(snapshot_id) + ".mhtml", snapshot_id,
+                        input_event->event_id, size_string.data(), size_string.size());
+    }
+    input_event->dom_snapshot_write_slot.reset();
+    input_event->dom_snapshot_received = true;
+    input_event->UpdateStatus();
+    pending_snapshots_.RemoveIfComplete(snapshot_id);
+}
 
+void SnapshotHandler::StoreResource(const std::string& digest,
+                                    const std::vector<char>& data) {
+    // Only accept resources when the renderer was asked to use the store.
+    if (!dom_snapshot_resource_store_enabled)
+        return;
+    SnapshotResourceStore::GetInstance()->Store(
+        digest, data,
+        base::Bind(&SnapshotHandler::ResourceStoreFailed, weak_factory_.GetWeakPtr(), digest));
+}
+
+void SnapshotHandler::ResourceStoreFailed(const std::string& digest) {
+    // The renderer has already referenced the resource by its digest; make
+    // it send the resource again with the next snapshot that uses it.
+    sender_->Send(new InputMsg_SnapshotResourceStoreFailed(routing_id_, digest));
+}
+
+void SnapshotHandler::DumpIPCMessageStats() {
+    if (ipc_message_stats_interval)
+        sender_->Send(new InputMsg_DumpIPCMessageStats(routing_id_));
+}
+
+void SnapshotHandler::CancelScheduledSnapshots() {
+    SnapshotScheduler::GetInstance()->CancelTasks(this);
+    // CancelTasks() only drops queued tasks; a readback the scheduler already
+    // posted, or one in flight, must not reach |client_| or |sender_|.
+    weak_factory_.InvalidateWeakPtrs();
+    pending_snapshots_.Clear();
+    dom_snapshot_files_.reset();
+    if (SnapshotArchive* archive = SnapshotArchive::GetInstance())
+        archive->Flush();
+}
+
+void SnapshotHandler::SendScreenshotRequest(const base::debug::SnapshotToken& event_id, float scale){
+      TRACE_EVENT_WITH_FLOW1("forensics", "SnapshotHandler::SendScreenshotRequest",
+                             base::debug::ForensicFlowId(event_id, next_snapshot_id_),
+                             TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+                             "snapshot_id", next_snapshot_id_);
       gfx::Size size = gfx::Size();
       size.process_id = process_id_; 
       size.routing_id = routing_id_;
       size.snapshot_id = next_snapshot_id_;
       size.event_id = event_id;
-
-      std::ostringstream ss;
-      ss << "DEBUG Screenshot Request being made,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-      logger_->LogLineScreen(ss.str(), true);
+      // Leaving the size empty lets the compositor apply the scale to the
+      // surface size, on the GPU before readback.
+      size.snapshot_scale = scale;
+      size.snapshot_i420 = screenshot_i420;
+
+      FORENSIC_LOG(DEBUG) << "DEBUG Screenshot Request being made,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
+      JournalEntry entry(JOURNAL_STAGE_SCREENSHOT_REQUEST);
+      SetJournalEventId(event_id, &entry);
+      entry.snapshot_id = next_snapshot_id_;
+      EventJournal::Record(&entry);
       
+      // Time spent waiting for a readback slot counts against the renderer's
+      // --screenshot-wait-timeout-ms.
+      SnapshotScheduler::GetInstance()->Schedule(
+              SnapshotScheduler::RESOURCE_READBACK, client_->GetSnapshotPriority(), this,
+              base::ThreadTaskRunnerHandle::Get(),
+              base::Bind(&SnapshotHandler::StartReadback, weak_factory_.GetWeakPtr(), size));
+      //}
+}
+
+void SnapshotHandler::StartReadback(const gfx::Size& size,
+                                    scoped_ptr<SnapshotScheduler::Slot> slot) {
+      // The governor charges the readback from here on; waiting for the
+      // slot is other tabs' cost.
+      InputEventArg* input_event = FindInputEvent(size.snapshot_id);
+      if (input_event)
+          input_event->readback_start_time = tick_clock_->NowTicks();
       client_->CopyFromBackingStoreProxy(
                               gfx::Rect(),
                               size,
-                              base::Bind(&SnapshotHandler::ScreenshotCaptured, base::Unretained(this), next_snapshot_id_),
+                              base::Bind(&SnapshotHandler::ReadbackDone, weak_factory_.GetWeakPtr(),
+                                         size.snapshot_id, base::Passed(&slot)),
                               kN32_SkColorType);
-      //}
+}
+
+void SnapshotHandler::ReadbackDone(int snapshot_id,
+                                   scoped_ptr<SnapshotScheduler::Slot> slot,
+                                   const SkBitmap& bitmap,
+                                   content::ReadbackResponse response) {
+    slot.reset();
+    ScreenshotCaptured(snapshot_id, bitmap, response);
+}
+
+void SnapshotHandler::ScreenshotWriteFailed() {
+    // Screenshots already queued may still be deltas against the lost one;
+    // the keyframe this forces ends their chain.
+    last_screenshot.reset();
+}
+
+void SnapshotHandler::SetTickClockForTesting(scoped_ptr<base::TickClock> tick_clock) {
+  tick_clock_ = std::move(tick_clock);
 }
 
 bool SnapshotHandler::RandomizeSnapshot(){
@@ -294,6 +612,9 @@ void SnapshotHandler::GetRVH(const ui::LatencyInfo& latency_info) {
     }
     if (process_id != 0) {
         process_id_ = process_id;
+        ForensicLogCollector::GetInstance()->AttachProcess(process_id_, routing_id_);
+        if (ipc_message_stats_interval)
+            sender_->Send(new InputMsg_SetIPCMessageStats(routing_id_, ipc_message_stats_interval));
         //RenderFrameHostImpl* rfh = RenderFrameHostImpl::FromID(process_id, routing_id);
         rvh = RenderViewHost::FromID(process_id, routing_id);
         if (rvh) {
@@ -301,6 +622,8 @@ void SnapshotHandler::GetRVH(const ui::LatencyInfo& latency_info) {
             Logger::LogLineScreen(log_stream.str(), true);
             log_stream.str("");
             web_contents = 1;
+            if (dom_snapshot_enabled && dom_snapshot_files_)
+                dom_snapshot_files_->Fill();
         }
     }
 }
@@ -310,6 +633,8 @@ void SnapshotHandler::GetRVH(const ui::LatencyInfo& latency_info) {
 
 void SnapshotHandler::HandleInputEvent(const WebInputEvent& input_event,
                                       const ui::LatencyInfo& latency_info) {
+  TRACE_EVENT1("forensics", "SnapshotHandler::HandleInputEvent",
+               "type", input_event.type);
   std::ostringstream log_stream;
   if(web_contents==0) {
     GetRVH(latency_info);
@@ -342,7 +667,8 @@ void SnapshotHandler::HandleInputEvent(const WebInputEvent& input_event,
       input_event.type == WebInputEvent::RawKeyDown|| input_event.type == WebInputEvent::GestureTapDown)
       is_snapshot_event = true;
 
-  long current_time = base::TimeTicks::Now().ToInternalValue();
+  base::TimeTicks now = tick_clock_->NowTicks();
+  long current_time = now.ToInternalValue();
 
   // If Mouse has been moved/"wheeled" for the first time on this page or mouse has not been move for the past
   // `key_press_interval` seconds, then take a snapshot
@@ -420,20 +746,18 @@ void SnapshotHandler::HandleInputEvent(const WebInputEvent& input_event,
   }
 
 
-  std::string event_id;
-  log_stream << site_id << "_" << url_id << "_" <<latency_info.trace_id();
-  event_id = log_stream.str();
-  log_stream.str("");
+  base::debug::SnapshotToken event_id(reinterpret_cast<uintptr_t>(this), url_id,
+                                      latency_info.trace_id());
 
-  log_stream <<"SnapshotHandler:: Event ID: " << event_id << ", Snapshot Page: " << take_random_snapshot; 
-  Logger::LogLineScreen(log_stream.str(), true);
-  log_stream.str("");
+  JournalEntry entry = CreateJournalEntry(JOURNAL_STAGE_INPUT_EVENT, latency_info);
+  entry.event_type = input_event.type;
+  entry.arg0 = take_random_snapshot;
+  EventJournal::Record(&entry);
 
   if (screenshot_active || dom_snapshot_active) {
     if (is_snapshot_event) {
-        log_stream << "SnapshotHandler:: This is a snapshot worthy event, Event ID: " << event_id; 
-        Logger::LogLineScreen(log_stream.str(), true);
-        log_stream.str("");
+        entry.stage = JOURNAL_STAGE_SNAPSHOT_WORTHY_EVENT;
+        EventJournal::Record(&entry);
     }
   }
 
@@ -442,31 +766,65 @@ void SnapshotHandler::HandleInputEvent(const WebInputEvent& input_event,
       dom_snapshot_active = false;
   }
 
-  if (screenshot_active || dom_snapshot_active) {
-    if (is_snapshot_event) {
-        log_stream << "SnapshotHandler:: This is a snapshot event, Event ID: " << event_id << 
-        ", Snapshot ID: " << next_snapshot_id_ << ", Output Directory: " << output_directory_name;
-        Logger::LogLineScreen(log_stream.str(), true);
-        log_stream.str("");
-    }
+  float scale = screenshot_scale;
+  if (governor_ && is_snapshot_event && (screenshot_active || dom_snapshot_active)) {
+      const char* reason;
+      SnapshotGovernor::Decision decision =
+          governor_->Decide(now, GetGovernorEventKind(input_event), &reason);
+      if (decision == SnapshotGovernor::DECISION_SKIP) {
+          screenshot_active = false;
+          dom_snapshot_active = false;
+      } else if (decision != SnapshotGovernor::DECISION_FULL) {
+          dom_snapshot_active = false;
+          if (decision == SnapshotGovernor::DECISION_REDUCED_SCALE)
+              scale *= 0.5f;
+      }
+      log_stream << "SnapshotHandler:: Governor, Event ID: " << event_id
+                 << ", Decision: " << SnapshotGovernor::DecisionName(decision)
+                 << ", Reason: " << reason << ", Tab Load (%): " << 100 * governor_->tab_pressure()
+                 << ", Global Load (%): " << 100 * governor_->global_pressure();
+      logger_->LogLineScreen(log_stream.str(), true);
+      log_stream.str("");
+      entry.stage = JOURNAL_STAGE_GOVERNOR_DECISION;
+      entry.arg0 = decision;
+      entry.arg1 = static_cast<int32_t>(
+          100 * std::max(governor_->tab_pressure(), governor_->global_pressure()));
+      EventJournal::Record(&entry);
   }
 
-  InputEventArg *input_event_arg = new InputEventArg(input_event, latency_info, 
-          is_snapshot_event, screenshot_active, dom_snapshot_active, event_id);
+  // Routing input never touches the disk: without a pre-opened file the
+  // event gets no DOM snapshot.
+  base::File dom_snapshot_file;
+  if (is_snapshot_event && dom_snapshot_active) {
+      if (dom_snapshot_files_)
+          dom_snapshot_file = dom_snapshot_files_->Take(next_snapshot_id_);
+      if (!dom_snapshot_file.IsValid()) {
+          dom_snapshot_active = false;
+          log_stream << "SnapshotHandler:: No DOM snapshot file available, Event ID: " << event_id
+                     << ", Misses: " << (dom_snapshot_files_ ? dom_snapshot_files_->misses() : 0);
+          logger_->LogLineScreen(log_stream.str(), true);
+          log_stream.str("");
+      }
+  }
+
+  // The output directory is in the "Directory generated" line and names
+  // every file of the tab, so the journal only needs the snapshot ID.
   if(is_snapshot_event && (screenshot_active || dom_snapshot_active)) {
-    input_event_arg->SetSnapshotID(next_snapshot_id_);
-  log_stream << "SnapshotHandler:: Putting into input event buffer Event ID: " << (*input_event_arg).event_id << 
-                ", Snapshot ID: " << (*input_event_arg).snapshot_id; 
-  Logger::LogLineScreen(log_stream.str(), true);
-  log_stream.str("");
-  input_event_buffer.push_front(*input_event_arg);
+  InputEventArg* pending = pending_snapshots_.Add(next_snapshot_id_, input_event, latency_info,
+          screenshot_active, dom_snapshot_active, event_id);
+  pending->requested_time = now;
+  entry.stage = JOURNAL_STAGE_SNAPSHOT_EVENT;
+  entry.snapshot_id = next_snapshot_id_;
+  entry.arg0 = pending_snapshots_.size();
+  entry.arg1 = pending_snapshots_.evicted();
+  EventJournal::Record(&entry);
   }
 
   MHTML_Params mhtml_params = GenerateMHTMLParams(is_snapshot_event && screenshot_active, is_snapshot_event && dom_snapshot_active,
-                                                  event_id);
+                                                  event_id, std::move(dom_snapshot_file));
   if (is_snapshot_event) {
     if (screenshot_active) {
-        SendScreenshotRequest(event_id);
+        SendScreenshotRequest(event_id, scale);
     }
     if (screenshot_active || dom_snapshot_active)
         next_snapshot_id_ ++;
@@ -475,22 +833,19 @@ void SnapshotHandler::HandleInputEvent(const WebInputEvent& input_event,
  if (!sender_->Send(msg)) {
     TRACE_EVENT0("forensics", "ERROR->SendAnEventFromBuffer: Failure in sending the event");
  }
- LogEventMetadata(&input_event, event_id);
+ LogEventMetadata(&input_event, latency_info);
 }
 
 //Note: This is not thread-safe!
 InputEventArg* SnapshotHandler::FindInputEvent(int snapshot_id) {
-    std::ostringstream log_stream;
-    for (std::deque<InputEventArg>::reverse_iterator it = input_event_buffer.rbegin(); it!=input_event_buffer.rend(); it++) {
-        if (!(*it).is_snapshot_event)
-            continue;
-        //fprintf(stderr, "Snapshot_id found is: %d \n", (*it).snapshot_id);
-        if ((*it).snapshot_id == snapshot_id) {
-            log_stream <<"SnapshotHandler::FindInputEvent Event ID: " << (*it).event_id << ", Snapshot ID: " << (*it).snapshot_id << ", Looking for: " << (*it).snapshot_id; 
-            Logger::LogLineScreen(log_stream.str(), true);
-            log_stream.str("");
-            return &(*it);
-        }
+    InputEventArg* input_event = pending_snapshots_.Find(snapshot_id);
+    if (input_event) {
+        JournalEntry entry = CreateJournalEntry(JOURNAL_STAGE_PENDING_SNAPSHOT_FOUND, *input_event->latency_info);
+        entry.url_id = -1;
+        entry.event_type = input_event->input_event->type;
+        entry.snapshot_id = snapshot_id;
+        EventJournal::Record(&entry);
+        return input_event;
     }
     fprintf(stderr, "NO Snapshot_id found! \n");
     return NULL;
@@ -10,9 +10,18 @@
 //#include <queue>
 
 #include <set>
+#include "base/debug/snapshot_token.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
 #include "content/browser/renderer_host/input/input_router_client.h"
 #include "content/browser/renderer_host/snapshot/input_event_arg.h"
 #include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/browser/renderer_host/snapshot/pending_snapshot_table.h"
+#include "content/browser/renderer_host/snapshot/screenshot.h"
+#include "content/browser/renderer_host/snapshot/snapshot_file_pool.h"
+#include "content/browser/renderer_host/snapshot/snapshot_governor.h"
+#include "content/browser/renderer_host/snapshot/snapshot_scheduler.h"
+#include "content/common/snapshot/event_journal.h"
 #include "content/public/browser/readback_types.h"
 #include "content/public/browser/render_view_host.h"
 #include "third_party/WebKit/public/web/WebInputEvent.h"
@@ -21,6 +30,10 @@
 
 struct MHTML_Params;
 
+namespace base {
+    class TickClock;
+}
+
 namespace IPC {
     class Sender;
 }
@@ -33,7 +46,8 @@ class SnapshotHandler {
                  InputRouterClient* client,
                  int routing_id);
   ~SnapshotHandler();
-  base::FilePath GetMHTMLFilePath();
+  // Directory of the tab's DOM snapshots. Touches no files.
+  base::FilePath GetMHTMLDirectory();
   void ScreenshotCaptured(
           int snapshot_id,
           const SkBitmap& bitmap,
@@ -41,20 +55,43 @@ class SnapshotHandler {
   void DOMSnapshotCaptured(
           int snapshot_id,
           int64_t size);
-  void SendScreenshotRequest(std::string event_id);
-  void LogEventMetadata(const blink::WebInputEvent *input_event, std::string event_id);
+  void StoreResource(const std::string& digest, const std::vector<char>& data);
+  // Asks the renderer to log its IPC message counters, if they are on.
+  void DumpIPCMessageStats();
+  // Drops the tab's readbacks still queued in the SnapshotScheduler, its
+  // pending snapshots and its unused DOM snapshot files. Called when the
+  // widget goes away.
+  void CancelScheduledSnapshots();
+  void SendScreenshotRequest(const base::debug::SnapshotToken& event_id, float scale);
+  void LogEventMetadata(const blink::WebInputEvent *input_event, const ui::LatencyInfo& latency_info);
   void HandleInputEvent(const blink::WebInputEvent& input_event,
                         const ui::LatencyInfo& latency_info);
   void GetRVH(const ui::LatencyInfo& latency_info);
-  MHTML_Params GenerateMHTMLParams(bool screenshot_active, bool dom_snapshot_active, std::string event_id);
+  // |dom_snapshot_file| is handed to the renderer if |dom_snapshot_active|.
+  MHTML_Params GenerateMHTMLParams(bool screenshot_active, bool dom_snapshot_active,
+                                   const base::debug::SnapshotToken& event_id,
+                                   base::File dom_snapshot_file);
   InputEventArg* FindInputEvent(int snapshot_id);
   bool RandomizeSnapshot();
+  // Replaces the clock that spaces out the snapshots of key presses and mouse
+  // moves, e.g. to replay recorded input at its original pace.
+  void SetTickClockForTesting(scoped_ptr<base::TickClock> tick_clock);
   Logger* logger_;
 
  private:
   std::string site_id;
   void GenerateSiteID();
+  // Starts a journal record carrying this tab's part of the event ID.
+  JournalEntry CreateJournalEntry(JournalStage stage, const ui::LatencyInfo& latency_info);
   void GenerateDirectoryName();
+  // Runs once the SnapshotScheduler grants a readback slot, which is held
+  // until the readback completes.
+  void StartReadback(const gfx::Size& size, scoped_ptr<SnapshotScheduler::Slot> slot);
+  void ReadbackDone(int snapshot_id, scoped_ptr<SnapshotScheduler::Slot> slot,
+                    const SkBitmap& bitmap, content::ReadbackResponse response);
+  // A screenshot was not stored; the next one must not be a delta against it.
+  void ScreenshotWriteFailed();
+  void ResourceStoreFailed(const std::string& digest);
   IPC::Sender* sender_;
   InputRouterClient* client_;
   int process_id_;
@@ -65,17 +102,40 @@ class SnapshotHandler {
 //Enable snapshot for selective inputs
   bool selective_screenshot_enabled;
   bool selective_dom_snapshot_enabled; 
+  // Store later DOM snapshots of a page as deltas against its first one
+  bool delta_dom_snapshot_enabled;
+  // Store DOM snapshot subresources once per session, referenced by digest
+  bool dom_snapshot_resource_store_enabled;
   std::set<int> select_input_set;
   std::string output_directory_name;
-  std::deque<InputEventArg> input_event_buffer;
-  // Queue containing snapshot IDs for pending (and in process) snapshot events
-  std::deque<int> pending_snapshots_queue;
+  // Snapshot events whose screenshot or DOM snapshot is still outstanding
+  PendingSnapshotTable pending_snapshots_;
+  // Pre-opened DOM snapshot files, filled once the tab has a WebContents
+  scoped_ptr<SnapshotFilePool> dom_snapshot_files_;
   // Store the last key press code
   int last_key_press;
   long last_key_press_time;
   long key_press_interval;
   // Stores when the last mouse move happened
   long last_mouse_move_time;
+  scoped_ptr<base::TickClock> tick_clock_;
+  // How long (ms) the renderer may hold an input event back waiting for its
+  // screenshot. 0 means wait until the screenshot arrives.
+  int screenshot_wait_timeout_ms;
+  // Fraction of the surface size screenshots are read back at
+  float screenshot_scale;
+  // Read screenshots back as I420 planes instead of BGRA
+  bool screenshot_i420;
+  // Output format and dedup settings of screenshots
+  ScreenshotOptions screenshot_options;
+  // Previous screenshot of the tab, the base of the next tile delta
+  SkBitmap last_screenshot;
+  int last_screenshot_id;
+  int screenshots_since_keyframe;
+  // Sampling interval of the renderer's IPC message counters, 0 if off
+  int ipc_message_stats_interval;
+  // Scales snapshots back under load, null unless --enable-snapshot-governor
+  scoped_ptr<SnapshotGovernor> governor_;
 
 //Random Snapshot Options for experimental evaluation
   bool random_snapshots_enabled;
@@ -88,6 +148,10 @@ class SnapshotHandler {
   // Last url
  GURL last_url;
  int url_id;
+
+  // Readbacks and their callbacks go through this, as they can run after
+  // CancelScheduledSnapshots(), once |sender_| and |client_| are gone.
+  base::WeakPtrFactory<SnapshotHandler> weak_factory_;
 };
 
 }
@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/simple_test_tick_clock.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+#include "content/browser/renderer_host/input/input_router_client.h"
+#include "content/browser/renderer_host/snapshot/screenshot.h"
+#include "content/browser/renderer_host/snapshot/snapshot_handler.h"
+#include "content/browser/renderer_host/snapshot/snapshot_scheduler.h"
+#include "content/test/allocation_counter.h"
+#include "ipc/ipc_message.h"
+#include "ipc/ipc_sender.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "third_party/WebKit/Source/platform/WindowsKeyboardCodes.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/events/latency_info.h"
+#include "ui/gfx/geometry/rect.h"
+#include "ui/gfx/geometry/size.h"
+
+using blink::WebInputEvent;
+using blink::WebKeyboardEvent;
+using blink::WebMouseEvent;
+
+namespace content {
+
+namespace {
+
+const size_t kEventsPerRun = 1000;
+// Distinct frames the fake readback cycles through. More than the encoder's
+// dedup history, so identical frames only come back after it forgot them.
+const int kNumFrames = 12;
+const int kWaitForScreenshotsSeconds = 60;
+
+// Fake file sink of the screenshot encoder pool: counts what would have been
+// written.
+base::subtle::Atomic32 g_screenshot_files = 0;
+base::subtle::Atomic32 g_screenshot_bytes = 0;
+
+int CountScreenshotFile(const base::FilePath& path, const char* data,
+                        int size) {
+  base::subtle::NoBarrier_AtomicIncrement(&g_screenshot_bytes, size);
+  base::subtle::Barrier_AtomicIncrement(&g_screenshot_files, 1);
+  return size;
+}
+
+// Answers every screenshot request at once with the next of |kNumFrames|
+// bitmaps of the configured size. The frames share a background and differ
+// in a caret-sized rectangle, like consecutive frames of a typing session.
+class FakeReadbackClient : public InputRouterClient {
+ public:
+  explicit FakeReadbackClient(const gfx::Size& size) : next_frame_(0),
+                                                       readback_count_(0) {
+    for (int i = 0; i < kNumFrames; ++i) {
+      SkBitmap frame;
+      frame.allocN32Pixels(size.width(), size.height());
+      frame.eraseColor(SK_ColorWHITE);
+      frame.eraseArea(SkIRect::MakeXYWH((i * 97) % size.width(),
+                                        (i * 61) % size.height(), 8, 16),
+                      SK_ColorBLACK);
+      frames_.push_back(frame);
+    }
+  }
+  ~FakeReadbackClient() override {}
+
+  // InputRouterClient
+  InputEventAckState FilterInputEvent(
+      const blink::WebInputEvent& input_event,
+      const ui::LatencyInfo& latency_info) override {
+    return INPUT_EVENT_ACK_STATE_NOT_CONSUMED;
+  }
+  void IncrementInFlightEventCount() override {}
+  void DecrementInFlightEventCount() override {}
+  void OnHasTouchEventHandlers(bool has_handlers) override {}
+  void DidFlush() override {}
+  void DidOverscroll(const DidOverscrollParams& params) override {}
+  void DidStopFlinging() override {}
+  //ChromePic
+  void TakeDOMSnapshot(
+      const base::FilePath& path,
+      const base::Callback<void(int64_t)>& callback) override {}
+  void CopyFromBackingStoreProxy(const gfx::Rect& src_rect,
+                                 const gfx::Size& accelerated_dst_size,
+                                 const ReadbackRequestCallback& callback,
+                                 const SkColorType color_type) override {
+    ++readback_count_;
+    callback.Run(frames_[next_frame_], READBACK_SUCCESS);
+    next_frame_ = (next_frame_ + 1) % kNumFrames;
+  }
+  SnapshotPriority GetSnapshotPriority() override {
+    return SNAPSHOT_PRIORITY_FOCUSED;
+  }
+  //ChromePic
+
+  int readback_count() const { return readback_count_; }
+
+ private:
+  std::vector<SkBitmap> frames_;
+  int next_frame_;
+  int readback_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeReadbackClient);
+};
+
+class CountingIPCSender : public IPC::Sender {
+ public:
+  CountingIPCSender() : sent_count_(0), sent_bytes_(0) {}
+  ~CountingIPCSender() override {}
+
+  bool Send(IPC::Message* message) override {
+    ++sent_count_;
+    sent_bytes_ += message->size();
+    delete message;
+    return true;
+  }
+
+  size_t sent_count() const { return sent_count_; }
+  size_t sent_bytes() const { return sent_bytes_; }
+
+ private:
+  size_t sent_count_;
+  size_t sent_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingIPCSender);
+};
+
+// An input event and how long after the previous one it arrives.
+struct ScriptedEvent {
+  base::TimeDelta delay;
+  bool is_key;
+  WebKeyboardEvent key;
+  WebMouseEvent mouse;
+
+  const WebInputEvent& event() const {
+    if (is_key)
+      return key;
+    return mouse;
+  }
+};
+
+typedef std::vector<ScriptedEvent> Script;
+
+void AddKey(Script* script, WebInputEvent::Type type, int key_code,
+            int delay_ms) {
+  ScriptedEvent scripted;
+  scripted.delay = base::TimeDelta::FromMilliseconds(delay_ms);
+  scripted.is_key = true;
+  scripted.key.type = type;
+  scripted.key.windowsKeyCode = key_code;
+  script->push_back(scripted);
+}
+
+void AddMouse(Script* script, WebInputEvent::Type type, int x, int y,
+              int delay_ms) {
+  ScriptedEvent scripted;
+  scripted.delay = base::TimeDelta::FromMilliseconds(delay_ms);
+  scripted.is_key = false;
+  scripted.mouse.type = type;
+  scripted.mouse.x = scripted.mouse.windowX = scripted.mouse.globalX = x;
+  scripted.mouse.y = scripted.mouse.windowY = scripted.mouse.globalY = y;
+  script->push_back(scripted);
+}
+
+// Five-letter words typed 120ms apart with a space between them, a backspace
+// now and then, and a 3s pause after every 50 keys. Every fourth pause comes
+// after return and is longer than the key press interval.
+Script CreateTypingBursts() {
+  Script script;
+  for (int i = 0; script.size() < kEventsPerRun; ++i) {
+    int key_code = 'A' + i % 26;
+    int delay_ms = 120;
+    if (i % 50 == 49) {
+      key_code = i % 200 == 199 ? VK_RETURN : 'A';
+      delay_ms = i % 200 == 199 ? 7000 : 3000;
+    } else if (i % 6 == 5) {
+      key_code = VK_SPACE;
+    } else if (i % 23 == 22) {
+      key_code = VK_BACK;
+    }
+    AddKey(&script, WebInputEvent::RawKeyDown, key_code, delay_ms);
+    AddKey(&script, WebInputEvent::Char, key_code, 0);
+    AddKey(&script, WebInputEvent::KeyUp, key_code, 60);
+  }
+  return script;
+}
+
+// Storms of 10 clicks 80ms apart with a little mouse movement between them,
+// a second apart.
+Script CreateClickStorms() {
+  Script script;
+  for (int i = 0; script.size() < kEventsPerRun; ++i) {
+    int x = 100 + (i * 37) % 600;
+    int y = 100 + (i * 23) % 400;
+    AddMouse(&script, WebInputEvent::MouseMove, x, y, i % 10 ? 50 : 1000);
+    AddMouse(&script, WebInputEvent::MouseDown, x, y, 10);
+    AddMouse(&script, WebInputEvent::MouseUp, x, y, 20);
+  }
+  return script;
+}
+
+// Runs of 60 mouse moves at 60Hz separated by 6s of idling, so that the
+// first move of every run is a snapshot event.
+Script CreateMouseMoveIdleGaps() {
+  Script script;
+  for (int i = 0; script.size() < kEventsPerRun; ++i) {
+    AddMouse(&script, WebInputEvent::MouseMove, i % 800, (i * 3) % 600,
+             i % 60 ? 16 : 6000);
+  }
+  return script;
+}
+
+ui::LatencyInfo CreateLatencyInfo(int64_t trace_id) {
+  // All components come from process 0, so the handler does not look for a
+  // RenderViewHost and DOM snapshots stay off.
+  ui::LatencyInfo latency;
+  latency.set_trace_id(trace_id);
+  base::TimeTicks now = base::TimeTicks::Now();
+  latency.AddLatencyNumberWithTimestamp(
+      ui::INPUT_EVENT_LATENCY_ORIGINAL_COMPONENT, 0, 0, now, 1);
+  latency.AddLatencyNumberWithTimestamp(
+      ui::INPUT_EVENT_LATENCY_BEGIN_RWH_COMPONENT, 0, trace_id, now, 1);
+  return latency;
+}
+
+// Flags the handler reads in its constructor, "name" or "name=value".
+class ScopedSnapshotFlags {
+ public:
+  explicit ScopedSnapshotFlags(const std::vector<std::string>& flags)
+      : saved_command_line_(*base::CommandLine::ForCurrentProcess()) {
+    base::CommandLine* command_line = base::CommandLine::ForCurrentProcess();
+    for (const std::string& flag : flags) {
+      size_t equals = flag.find('=');
+      if (equals == std::string::npos)
+        command_line->AppendSwitch(flag);
+      else
+        command_line->AppendSwitchASCII(flag.substr(0, equals),
+                                        flag.substr(equals + 1));
+    }
+  }
+  ~ScopedSnapshotFlags() {
+    *base::CommandLine::ForCurrentProcess() = saved_command_line_;
+  }
+
+ private:
+  base::CommandLine saved_command_line_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedSnapshotFlags);
+};
+
+// Every combination of the flags that change which events get snapshots
+// and what the encoder pool does with the screenshots. The governor goes
+// with the encoder modes since it only acts on the cost they produce.
+std::vector<std::vector<std::string>> GetFlagCombinations() {
+  const char* const screenshot_modes[] = {nullptr, "enable-all-screenshots",
+                                          "disable-screenshots"};
+  const char* const randomization[] = {"disable-randomized-snapshots",
+                                       nullptr};
+  const char* const encoder_modes[] = {nullptr, "enable-screenshot-dedup",
+                                       "enable-tile-diff-screenshots",
+                                       "screenshot-format=raw",
+                                       "enable-snapshot-governor"};
+  std::vector<std::vector<std::string>> combinations;
+  for (const char* screenshot_mode : screenshot_modes) {
+    for (const char* random : randomization) {
+      for (const char* encoder_mode : encoder_modes) {
+        std::vector<std::string> flags;
+        if (screenshot_mode)
+          flags.push_back(screenshot_mode);
+        if (random)
+          flags.push_back(random);
+        if (encoder_mode)
+          flags.push_back(encoder_mode);
+        combinations.push_back(flags);
+      }
+    }
+  }
+  return combinations;
+}
+
+std::string GetTraceName(const std::vector<std::string>& flags) {
+  if (flags.empty())
+    return "default";
+  std::string trace;
+  base::ReplaceChars(base::JoinString(flags, "+"), "=", ":", &trace);
+  return trace;
+}
+
+void PrintValue(const std::string& measurement, const std::string& test_name,
+                const std::string& trace, double value,
+                const std::string& units) {
+  perf_test::PrintResult(measurement, "", test_name + "." + trace,
+                         base::StringPrintf("%.2f", value), units, true);
+}
+
+// How long the tasks of |resource| run since |before| waited for a slot,
+// on average over all of them.
+void PrintQueueWait(const std::string& test_name, const std::string& trace,
+                    SnapshotScheduler::Resource resource,
+                    const SnapshotScheduler::Stats& before) {
+  SnapshotScheduler::Stats after =
+      SnapshotScheduler::GetInstance()->GetStats(resource);
+  if (after.tasks == before.tasks)
+    return;
+  PrintValue(std::string(SnapshotScheduler::ResourceName(resource)) +
+                 "_queue_wait",
+             test_name, trace,
+             (after.total_wait - before.total_wait).InMicroseconds() /
+                 static_cast<double>(after.tasks - before.tasks),
+             "us");
+}
+
+// Feeds |script| to a SnapshotHandler once per flag combination, with the
+// handler's clock following the script, and reports what the browser's UI
+// thread pays per event. Screenshots are encoded on the real encoder pool
+// into the fake file sink, which is drained before the next combination.
+void RunScript(const std::string& test_name, const Script& script,
+               const gfx::Size& screenshot_size) {
+  std::vector<ui::LatencyInfo> latencies;
+  base::TimeDelta script_duration;
+  for (size_t i = 0; i < script.size(); ++i) {
+    latencies.push_back(CreateLatencyInfo(1000000 + i));
+    script_duration += script[i].delay;
+  }
+  SetScreenshotFileWriterForTesting(&CountScreenshotFile);
+  // Readbacks are scheduled on this thread's task runner.
+  base::MessageLoop message_loop;
+
+  for (const std::vector<std::string>& flags : GetFlagCombinations()) {
+    const std::string trace = GetTraceName(flags);
+    ScopedSnapshotFlags scoped_flags(flags);
+    // Randomized snapshots draw from rand() in the constructor.
+    srand(1);
+    CountingIPCSender sender;
+    FakeReadbackClient client(screenshot_size);
+    scoped_ptr<SnapshotHandler> handler(
+        new SnapshotHandler(&sender, &client, 1));
+    base::SimpleTestTickClock* clock = new base::SimpleTestTickClock();
+    clock->Advance(base::TimeDelta::FromSeconds(1));
+    handler->SetTickClockForTesting(make_scoped_ptr(clock));
+    base::subtle::NoBarrier_Store(&g_screenshot_files, 0);
+    base::subtle::NoBarrier_Store(&g_screenshot_bytes, 0);
+    SnapshotScheduler* scheduler = SnapshotScheduler::GetInstance();
+    SnapshotScheduler::Stats encode_before =
+        scheduler->GetStats(SnapshotScheduler::RESOURCE_ENCODE);
+    SnapshotScheduler::Stats write_before =
+        scheduler->GetStats(SnapshotScheduler::RESOURCE_WRITE);
+
+    bool counting = StartCountingAllocations();
+    base::TimeTicks start = base::TimeTicks::Now();
+    for (size_t i = 0; i < script.size(); ++i) {
+      clock->Advance(script[i].delay);
+      handler->HandleInputEvent(script[i].event(), latencies[i]);
+    }
+    base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+    int allocations = StopCountingAllocations();
+
+    // Every screenshot ends up as exactly one file, encoded or a reference.
+    base::TimeTicks wait_start = base::TimeTicks::Now();
+    while (base::subtle::Acquire_Load(&g_screenshot_files) <
+               client.readback_count() &&
+           base::TimeTicks::Now() - wait_start <
+               base::TimeDelta::FromSeconds(kWaitForScreenshotsSeconds)) {
+      base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(5));
+    }
+    base::TimeDelta drain_time = base::TimeTicks::Now() - start;
+    EXPECT_EQ(client.readback_count(),
+              base::subtle::Acquire_Load(&g_screenshot_files)) << trace;
+    handler.reset();
+
+    const double events = static_cast<double>(script.size());
+    const int snapshots = client.readback_count();
+    PrintValue("events_per_second", test_name, trace,
+               events / elapsed.InSecondsF(), "events/s");
+    PrintValue("time_per_event", test_name, trace,
+               elapsed.InNanoseconds() / events, "ns");
+    if (counting) {
+      PrintValue("allocations_per_event", test_name, trace,
+                 allocations / events, "allocations");
+    }
+    PrintValue("snapshots_per_event", test_name, trace, snapshots / events,
+               "snapshots");
+    PrintValue("snapshot_decisions_per_second", test_name, trace,
+               snapshots / script_duration.InSecondsF(), "snapshots/s");
+    PrintValue("ipc_bytes_per_event", test_name, trace,
+               sender.sent_bytes() / events, "bytes");
+    if (snapshots) {
+      PrintValue("screenshot_bytes_per_snapshot", test_name, trace,
+                 static_cast<uint32_t>(
+                     base::subtle::NoBarrier_Load(&g_screenshot_bytes)) /
+                     static_cast<double>(snapshots),
+                 "bytes");
+      PrintValue("screenshots_per_second", test_name, trace,
+                 snapshots / drain_time.InSecondsF(), "screenshots/s");
+      PrintQueueWait(test_name, trace, SnapshotScheduler::RESOURCE_ENCODE,
+                     encode_before);
+      PrintQueueWait(test_name, trace, SnapshotScheduler::RESOURCE_WRITE,
+                     write_before);
+    }
+  }
+
+  SetScreenshotFileWriterForTesting(nullptr);
+}
+
+}  // namespace
+
+TEST(SnapshotHandlerPerfTest, TypingBursts) {
+  RunScript("TypingBursts", CreateTypingBursts(), gfx::Size(1280, 720));
+}
+
+TEST(SnapshotHandlerPerfTest, ClickStorms) {
+  RunScript("ClickStorms", CreateClickStorms(), gfx::Size(1280, 720));
+}
+
+TEST(SnapshotHandlerPerfTest, MouseMoveIdleGaps) {
+  RunScript("MouseMoveIdleGaps", CreateMouseMoveIdleGaps(),
+            gfx::Size(1280, 720));
+}
+
+TEST(SnapshotHandlerPerfTest, ClickStormsFullHD) {
+  RunScript("ClickStormsFullHD", CreateClickStorms(), gfx::Size(1920, 1080));
+}
+
+}  // namespace content
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_PRIORITY_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_PRIORITY_H_
+
+namespace content {
+
+// Whose snapshot work goes first when the browser is short of capacity.
+enum SnapshotPriority {
+  SNAPSHOT_PRIORITY_HIDDEN,
+  SNAPSHOT_PRIORITY_VISIBLE,
+  // The widget the user is typing or clicking into.
+  SNAPSHOT_PRIORITY_FOCUSED,
+  SNAPSHOT_PRIORITY_COUNT,
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_PRIORITY_H_
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/browser/renderer_host/snapshot/snapshot_scheduler.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/location.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/sys_info.h"
+#include "content/browser/renderer_host/snapshot/logger.h"
+
+namespace content {
+
+namespace {
+
+// Stats of a resource are logged after every |kLogInterval| of its tasks.
+const int64_t kLogInterval = 500;
+
+const char* const kResourceNames[] = {"readback", "encode", "write"};
+const char* const kLimitSwitches[] = {"snapshot-max-readbacks",
+                                      "snapshot-max-encodes",
+                                      "snapshot-max-writes"};
+
+base::LazyInstance<SnapshotScheduler>::Leaky g_snapshot_scheduler =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+SnapshotScheduler::Slot::Slot(Resource resource) : resource_(resource) {}
+
+SnapshotScheduler::Slot::~Slot() {
+  SnapshotScheduler::GetInstance()->Release(resource_);
+}
+
+SnapshotScheduler::Stats::Stats()
+    : limit(1),
+      in_use(0),
+      queue_depth(0),
+      max_queue_depth(0),
+      tasks(0),
+      queued_tasks(0) {}
+
+SnapshotScheduler::QueuedTask::QueuedTask() : owner(nullptr) {}
+
+SnapshotScheduler::QueuedTask::~QueuedTask() {}
+
+SnapshotScheduler::ResourceState::ResourceState() {}
+
+SnapshotScheduler::ResourceState::~ResourceState() {}
+
+// static
+SnapshotScheduler* SnapshotScheduler::GetInstance() {
+  return g_snapshot_scheduler.Pointer();
+}
+
+SnapshotScheduler::SnapshotScheduler() {
+  // A readback stalls the compositor of its tab and the GPU process for all
+  // of them, so only a couple run at once. Encodes use one core each, like
+  // the encoder pool.
+  resources_[RESOURCE_READBACK].stats.limit = 2;
+  resources_[RESOURCE_ENCODE].stats.limit = base::SysInfo::NumberOfProcessors();
+  resources_[RESOURCE_WRITE].stats.limit = 2;
+
+  const base::CommandLine& command_line = *base::CommandLine::ForCurrentProcess();
+  std::ostringstream log_stream;
+  log_stream << "SnapshotScheduler::";
+  for (int i = 0; i < RESOURCE_COUNT; ++i) {
+    int limit;
+    if (base::StringToInt(command_line.GetSwitchValueASCII(kLimitSwitches[i]), &limit) &&
+        limit > 0)
+      resources_[i].stats.limit = limit;
+    log_stream << (i ? ", " : " ") << "Max " << kResourceNames[i]
+               << "s: " << resources_[i].stats.limit;
+  }
+  Logger::LogLineScreen(log_stream.str(), true);
+}
+
+SnapshotScheduler::~SnapshotScheduler() {}
+
+void SnapshotScheduler::Schedule(Resource resource,
+                                 SnapshotPriority priority,
+                                 const void* owner,
+                                 const scoped_refptr<base::TaskRunner>& task_runner,
+                                 const Task& task) {
+  bool run_now = false;
+  bool log_stats = false;
+  Stats stats;
+  {
+    base::AutoLock lock(lock_);
+    ResourceState& state = resources_[resource];
+    ++state.stats.tasks;
+    if (state.stats.in_use < state.stats.limit) {
+      ++state.stats.in_use;
+      run_now = true;
+    } else {
+      QueuedTask queued;
+      queued.owner = owner;
+      queued.task_runner = task_runner;
+      queued.task = task;
+      queued.enqueued_time = base::TimeTicks::Now();
+      state.queues[priority].push_back(queued);
+      ++state.stats.queue_depth;
+      state.stats.max_queue_depth =
+          std::max(state.stats.max_queue_depth, state.stats.queue_depth);
+    }
+    if (!(state.stats.tasks % kLogInterval)) {
+      log_stats = true;
+      stats = state.stats;
+    }
+  }
+  if (log_stats)
+    LogStats(resource, stats);
+  if (!run_now)
+    return;
+
+  scoped_ptr<Slot> slot(new Slot(resource));
+  if (task_runner->RunsTasksOnCurrentThread())
+    task.Run(std::move(slot));
+  else
+    task_runner->PostTask(FROM_HERE, base::Bind(task, base::Passed(&slot)));
+}
+
+scoped_ptr<SnapshotScheduler::Slot> SnapshotScheduler::AcquireNow(Resource resource) {
+  {
+    base::AutoLock lock(lock_);
+    ++resources_[resource].stats.tasks;
+    ++resources_[resource].stats.in_use;
+  }
+  return make_scoped_ptr(new Slot(resource));
+}
+
+void SnapshotScheduler::CancelTasks(const void* owner) {
+  // The tasks are destroyed outside the lock, in case they own slots.
+  std::vector<QueuedTask> cancelled;
+  {
+    base::AutoLock lock(lock_);
+    for (int i = 0; i < RESOURCE_COUNT; ++i) {
+      for (int priority = 0; priority < SNAPSHOT_PRIORITY_COUNT; ++priority) {
+        std::deque<QueuedTask>& queue = resources_[i].queues[priority];
+        for (auto it = queue.begin(); it != queue.end();) {
+          if (it->owner == owner) {
+            cancelled.push_back(*it);
+            it = queue.erase(it);
+            --resources_[i].stats.queue_depth;
+          } else {
+            ++it;
+          }
+        }
+      }
+    }
+  }
+}
+
+SnapshotScheduler::Stats SnapshotScheduler::GetStats(Resource resource) {
+  base::AutoLock lock(lock_);
+  return resources_[resource].stats;
+}
+
+// static
+const char* SnapshotScheduler::ResourceName(Resource resource) {
+  return kResourceNames[resource];
+}
+
+void SnapshotScheduler::Release(Resource resource) {
+  QueuedTask next;
+  {
+    base::AutoLock lock(lock_);
+    ResourceState& state = resources_[resource];
+    --state.stats.in_use;
+    if (state.stats.in_use >= state.stats.limit)
+      return;
+    int priority = SNAPSHOT_PRIORITY_COUNT - 1;
+    while (priority >= 0 && state.queues[priority].empty())
+      --priority;
+    if (priority < 0)
+      return;
+    next = state.queues[priority].front();
+    state.queues[priority].pop_front();
+    --state.stats.queue_depth;
+    ++state.stats.in_use;
+
+    base::TimeDelta wait = base::TimeTicks::Now() - next.enqueued_time;
+    ++state.stats.queued_tasks;
+    state.stats.total_wait += wait;
+    state.stats.max_wait = std::max(state.stats.max_wait, wait);
+  }
+
+  // Always posted: the slot may be released deep inside the previous task.
+  scoped_ptr<Slot> slot(new Slot(resource));
+  next.task_runner->PostTask(FROM_HERE, base::Bind(next.task, base::Passed(&slot)));
+}
+
+// static
+void SnapshotScheduler::LogStats(Resource resource, const Stats& stats) {
+  std::ostringstream log_stream;
+  log_stream << "SnapshotScheduler:: Resource: " << kResourceNames[resource]
+             << ", Limit: " << stats.limit << ", In Use: " << stats.in_use
+             << ", Queue Depth: " << stats.queue_depth
+             << ", Max Queue Depth: " << stats.max_queue_depth
+             << ", # Tasks: " << stats.tasks << ", # Queued: " << stats.queued_tasks
+             << ", Avg Wait (us): "
+             << (stats.queued_tasks ? stats.total_wait.InMicroseconds() / stats.queued_tasks : 0)
+             << ", Max Wait (us): " << stats.max_wait.InMicroseconds();
+  Logger::LogLineScreen(log_stream.str(), true);
+}
+
+}  // namespace content
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_SCHEDULER_H_
+#define CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <deque>
+
+#include "base/callback.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "base/task_runner.h"
+#include "base/time/time.h"
+#include "content/browser/renderer_host/snapshot/snapshot_priority.h"
+
+namespace content {
+
+// Shares the capture capacity of the browser between the snapshots of all
+// tabs. Each resource has a fixed number of slots (--snapshot-max-readbacks,
+// --snapshot-max-encodes, --snapshot-max-writes); work that finds them all
+// taken waits in a queue, focused widgets first and in order within a
+// priority. Queue depth and wait time are logged every few hundred tasks.
+// Thread-safe.
+class SnapshotScheduler {
+ public:
+  enum Resource {
+    // GPU readbacks of screenshots.
+    RESOURCE_READBACK,
+    // Screenshot encodes on the encoder pool.
+    RESOURCE_ENCODE,
+    // Screenshot and DOM snapshot files being written.
+    RESOURCE_WRITE,
+    RESOURCE_COUNT,
+  };
+
+  // One unit of a resource. Destroying it, on any thread, hands the unit to
+  // the next queued task, so a dropped callback cannot leak its slot.
+  class Slot {
+   public:
+    ~Slot();
+
+   private:
+    friend class SnapshotScheduler;
+    explicit Slot(Resource resource);
+
+    const Resource resource_;
+
+    DISALLOW_COPY_AND_ASSIGN(Slot);
+  };
+
+  typedef base::Callback<void(scoped_ptr<Slot>)> Task;
+
+  struct Stats {
+    Stats();
+
+    int limit;
+    int in_use;
+    int queue_depth;
+    int max_queue_depth;
+    int64_t tasks;
+    // Tasks that had to wait for a slot, and how long they waited.
+    int64_t queued_tasks;
+    base::TimeDelta total_wait;
+    base::TimeDelta max_wait;
+  };
+
+  static SnapshotScheduler* GetInstance();
+
+  // Runs |task| on |task_runner| with a slot of |resource|: at once, and
+  // inline if |task_runner| runs tasks on this thread, when one is free,
+  // otherwise once its turn comes. |owner|, if not null, lets the task be
+  // dropped with CancelTasks().
+  void Schedule(Resource resource,
+                SnapshotPriority priority,
+                const void* owner,
+                const scoped_refptr<base::TaskRunner>& task_runner,
+                const Task& task);
+
+  // Takes a slot of |resource| even if none is free, for work that cannot
+  // wait, like a DOM snapshot written while the renderer holds the event.
+  // Queued tasks wait until usage is back under the limit.
+  scoped_ptr<Slot> AcquireNow(Resource resource);
+
+  // Drops the queued tasks of |owner|, e.g. when its widget goes away.
+  void CancelTasks(const void* owner);
+
+  Stats GetStats(Resource resource);
+
+  static const char* ResourceName(Resource resource);
+
+ private:
+  friend struct base::DefaultLazyInstanceTraits<SnapshotScheduler>;
+
+  struct QueuedTask {
+    QueuedTask();
+    ~QueuedTask();
+
+    const void* owner;
+    scoped_refptr<base::TaskRunner> task_runner;
+    Task task;
+    base::TimeTicks enqueued_time;
+  };
+
+  struct ResourceState {
+    ResourceState();
+    ~ResourceState();
+
+    Stats stats;
+    std::deque<QueuedTask> queues[SNAPSHOT_PRIORITY_COUNT];
+  };
+
+  SnapshotScheduler();
+  ~SnapshotScheduler();
+
+  // Returns a slot to |resource| and starts the next queued task, if any.
+  void Release(Resource resource);
+
+  static void LogStats(Resource resource, const Stats& stats);
+
+  base::Lock lock_;
+  ResourceState resources_[RESOURCE_COUNT];
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotScheduler);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_RENDERER_HOST_SNAPSHOT_SNAPSHOT_SCHEDULER_H_
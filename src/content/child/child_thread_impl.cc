@@ -64,13 +64,6 @@
 #include "ipc/mojo/ipc_channel_mojo.h"
 #include "third_party/mojo/src/mojo/edk/embedder/embedder.h"
 
-//ChromePic
-#include "content/common/input/web_input_event_traits.h"
-#include "content/common/input_messages.h"
-#include "content/browser/renderer_host/snapshot/logger.h"
-using blink::WebInputEvent;
-//ChromePic
-
 #if defined(TCMALLOC_TRACE_MEMORY_SUPPORTED)
 #include "third_party/tcmalloc/chromium/src/gperftools/heap-profiler.h"
 #endif
@@ -603,20 +596,6 @@ scoped_ptr<base::SharedMemory> ChildThreadImpl::AllocateSharedMemory(
 }
 
 bool ChildThreadImpl::OnMessageReceived(const IPC::Message& msg) {
-    //ChromePic
-  // Copying InputMsg_HandleInputEvent 
-  if (IPC_MESSAGE_ID_CLASS(msg.type()) == 3 &&  IPC_MESSAGE_ID_LINE(msg.type()) == 119)
-  {
-    InputMsg_HandleInputEvent::Param params;
-    if (InputMsg_HandleInputEvent::Read(&msg, &params)) {
-      const WebInputEvent* event = base::get<0>(params);
-      if (event->type == WebInputEvent::RawKeyDown) {
-          Logger::LogLineScreen("ChildThreadImpl: OnMessageReceived", true);
-      }
-    }
-  }
-    //ChromePic
-
   if (mojo_application_->OnMessageReceived(msg))
     return true;
 
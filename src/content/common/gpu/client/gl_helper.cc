@@ -7,7 +7,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <list>
+#include <map>
 #include <queue>
+#include <sstream>
 #include <string>
 
 #include "base/bind.h"
@@ -33,9 +36,11 @@
 #include "ui/gfx/geometry/size.h"
 
 //ChromePic
+#include "base/location.h"
+#include "base/memory/weak_ptr.h"
+#include "base/thread_task_runner_handle.h"
 #include "content/browser/renderer_host/snapshot/logger.h"
-#include "base/threading/platform_thread.h"
-#include "base/process/process_handle.h"
+#include "content/common/snapshot/event_journal.h"
 //ChromePic
 
 using gpu::gles2::GLES2Interface;
@@ -113,6 +118,257 @@ class ScalerHolder {
   DISALLOW_COPY_AND_ASSIGN(ScalerHolder);
 };
 
+//ChromePic
+// Transfer buffers, queries and scratch textures of finished readbacks, kept
+// for the next requests instead of being deleted and generated again for
+// every screenshot. Buffers are bucketed by size and textures by size and
+// format; whatever stays unused for kMaxIdleSeconds, or exceeds kMaxPooledBytes
+// starting with the least recently used, is deleted. Expiry runs on every
+// acquire and release, and from a delayed trim task while the pool is not
+// empty, so an idle pool does not hold on to its resources.
+class ReadbackResourcePool {
+ public:
+  enum Kind { BUFFER, QUERY, TEXTURE, KIND_COUNT };
+
+  explicit ReadbackResourcePool(GLES2Interface* gl)
+      : gl_(gl), pooled_bytes_(0), acquired_(0), trim_scheduled_(false),
+        weak_factory_(this) {
+    for (int i = 0; i < KIND_COUNT; i++)
+      hits_[i] = misses_[i] = 0;
+  }
+
+  ~ReadbackResourcePool() {
+    while (!entries_.empty())
+      DeleteOldest();
+  }
+
+  // Returns a transfer buffer of at least |size| bytes, bound to
+  // GL_PIXEL_PACK_TRANSFER_BUFFER_CHROMIUM.
+  GLuint AcquireBuffer(size_t size) {
+    const size_t bucket = BucketSize(size);
+    GLuint buffer = Take(BUFFER, bucket, 0, 0);
+    if (buffer) {
+      gl_->BindBuffer(GL_PIXEL_PACK_TRANSFER_BUFFER_CHROMIUM, buffer);
+      return buffer;
+    }
+    gl_->GenBuffers(1, &buffer);
+    gl_->BindBuffer(GL_PIXEL_PACK_TRANSFER_BUFFER_CHROMIUM, buffer);
+    gl_->BufferData(GL_PIXEL_PACK_TRANSFER_BUFFER_CHROMIUM, bucket, NULL,
+                    GL_STREAM_READ);
+    buffer_sizes_[buffer] = bucket;
+    return buffer;
+  }
+
+  // A buffer whose readback never completed may still be written to, so it
+  // is deleted rather than reused unless |reusable|.
+  void ReleaseBuffer(GLuint buffer, bool reusable) {
+    if (!reusable) {
+      gl_->DeleteBuffers(1, &buffer);
+      buffer_sizes_.erase(buffer);
+      return;
+    }
+    const size_t bucket = buffer_sizes_[buffer];
+    Release(BUFFER, buffer, bucket, 0, 0, bucket);
+  }
+
+  GLuint AcquireQuery() {
+    GLuint query = Take(QUERY, 0, 0, 0);
+    if (!query)
+      gl_->GenQueriesEXT(1, &query);
+    return query;
+  }
+
+  void ReleaseQuery(GLuint query) { Release(QUERY, query, 0, 0, 0, 0); }
+
+  // Returns a texture holding |size| pixels of |format| and |type|.
+  GLuint AcquireTexture(const gfx::Size& size, GLenum format, GLenum type) {
+    const size_t key = TextureKey(size);
+    GLuint texture = Take(TEXTURE, key, format, type);
+    if (texture)
+      return texture;
+    gl_->GenTextures(1, &texture);
+    content::ScopedTextureBinder<GL_TEXTURE_2D> texture_binder(gl_, texture);
+    gl_->TexImage2D(GL_TEXTURE_2D, 0, format, size.width(), size.height(), 0,
+                    format, type, NULL);
+    TextureInfo& info = textures_[texture];
+    info.size = size;
+    info.format = format;
+    info.type = type;
+    return texture;
+  }
+
+  void ReleaseTexture(GLuint texture) {
+    const TextureInfo& info = textures_[texture];
+    Release(TEXTURE, texture, TextureKey(info.size), info.format, info.type,
+            info.size.GetArea() * (info.type == GL_UNSIGNED_SHORT_5_6_5 ? 2 : 4));
+  }
+
+  int64_t hits(Kind kind) const { return hits_[kind]; }
+  int64_t misses(Kind kind) const { return misses_[kind]; }
+
+ private:
+  static const size_t kMaxPooledBytes = 64 * 1024 * 1024;
+  static const int kMaxIdleSeconds = 10;
+  static const int kStatsInterval = 100;
+
+  struct TextureInfo {
+    gfx::Size size;
+    GLenum format;
+    GLenum type;
+  };
+
+  struct Entry {
+    Kind kind;
+    GLuint id;
+    // Bucket size for buffers, TextureKey() for textures.
+    size_t key;
+    GLenum format;
+    GLenum type;
+    size_t bytes;
+    base::TimeTicks released;
+  };
+
+  // Powers of two up to 1MB, then whole megabytes.
+  static size_t BucketSize(size_t size) {
+    const size_t kMegabyte = 1024 * 1024;
+    if (size > kMegabyte)
+      return (size + kMegabyte - 1) / kMegabyte * kMegabyte;
+    size_t bucket = 4096;
+    while (bucket < size)
+      bucket *= 2;
+    return bucket;
+  }
+
+  static size_t TextureKey(const gfx::Size& size) {
+    return static_cast<size_t>(size.width()) << 16 | size.height();
+  }
+
+  // Takes the most recently released match out of the pool; 0 if none.
+  GLuint Take(Kind kind, size_t key, GLenum format, GLenum type) {
+    DeleteExpired(base::TimeTicks::Now());
+    auto match = entries_.end();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->kind == kind && it->key == key && it->format == format &&
+          it->type == type)
+        match = it;
+    }
+    GLuint id = 0;
+    if (match != entries_.end()) {
+      id = match->id;
+      pooled_bytes_ -= match->bytes;
+      entries_.erase(match);
+    }
+    if (id)
+      hits_[kind]++;
+    else
+      misses_[kind]++;
+
+    if (++acquired_ % kStatsInterval == 0) {
+      TRACE_COUNTER2("gpu.capture", "GLHelperReadbackPoolHits", "buffers",
+                     hits_[BUFFER], "textures", hits_[TEXTURE]);
+      TRACE_COUNTER2("gpu.capture", "GLHelperReadbackPoolMisses", "buffers",
+                     misses_[BUFFER], "textures", misses_[TEXTURE]);
+      std::ostringstream log_stream;
+      log_stream << "GLHelper:: Readback pool, Buffer Hits: " << hits_[BUFFER]
+                 << "/" << hits_[BUFFER] + misses_[BUFFER]
+                 << ", Query Hits: " << hits_[QUERY] << "/"
+                 << hits_[QUERY] + misses_[QUERY]
+                 << ", Texture Hits: " << hits_[TEXTURE] << "/"
+                 << hits_[TEXTURE] + misses_[TEXTURE]
+                 << ", Pooled Bytes: " << pooled_bytes_;
+      content::Logger::LogLineScreen(log_stream.str(), true);
+    }
+    return id;
+  }
+
+  void Release(Kind kind, GLuint id, size_t key, GLenum format, GLenum type,
+               size_t bytes) {
+    Entry entry = {kind, id, key, format, type, bytes, base::TimeTicks::Now()};
+    entries_.push_back(entry);
+    pooled_bytes_ += bytes;
+    DeleteExpired(entry.released);
+    ScheduleTrim();
+  }
+
+  // Deletes what has been idle for kMaxIdleSeconds at |now|, and the least
+  // recently used entries while the pool is over kMaxPooledBytes. Returns
+  // whether anything was deleted.
+  bool DeleteExpired(base::TimeTicks now) {
+    const base::TimeTicks expired =
+        now - base::TimeDelta::FromSeconds(kMaxIdleSeconds);
+    bool deleted = false;
+    while (!entries_.empty() && (pooled_bytes_ > kMaxPooledBytes ||
+                                 entries_.front().released < expired)) {
+      DeleteOldest();
+      deleted = true;
+    }
+    return deleted;
+  }
+
+  // Posts Trim() for when the least recently released entry expires. Without
+  // a task runner, expiry only happens on acquire and release.
+  void ScheduleTrim() {
+    if (trim_scheduled_ || entries_.empty() ||
+        !base::ThreadTaskRunnerHandle::IsSet())
+      return;
+    trim_scheduled_ = true;
+    base::TimeDelta delay = entries_.front().released +
+                            base::TimeDelta::FromSeconds(kMaxIdleSeconds) -
+                            base::TimeTicks::Now();
+    if (delay < base::TimeDelta())
+      delay = base::TimeDelta();
+    // Just past the expiry, since DeleteExpired() only drops older entries.
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&ReadbackResourcePool::Trim, weak_factory_.GetWeakPtr()),
+        delay + base::TimeDelta::FromMilliseconds(1));
+  }
+
+  void Trim() {
+    trim_scheduled_ = false;
+    // Deletions are otherwise only flushed by the next readback.
+    if (DeleteExpired(base::TimeTicks::Now()))
+      gl_->ShallowFlushCHROMIUM();
+    ScheduleTrim();
+  }
+
+  void DeleteOldest() {
+    const Entry& entry = entries_.front();
+    switch (entry.kind) {
+      case BUFFER:
+        gl_->DeleteBuffers(1, &entry.id);
+        buffer_sizes_.erase(entry.id);
+        break;
+      case QUERY:
+        gl_->DeleteQueriesEXT(1, &entry.id);
+        break;
+      case TEXTURE:
+        gl_->DeleteTextures(1, &entry.id);
+        textures_.erase(entry.id);
+        break;
+      case KIND_COUNT:
+        NOTREACHED();
+    }
+    pooled_bytes_ -= entry.bytes;
+    entries_.pop_front();
+  }
+
+  GLES2Interface* gl_;
+  // Least recently released first.
+  std::list<Entry> entries_;
+  std::map<GLuint, size_t> buffer_sizes_;
+  std::map<GLuint, TextureInfo> textures_;
+  size_t pooled_bytes_;
+  int64_t acquired_;
+  int64_t hits_[KIND_COUNT];
+  int64_t misses_[KIND_COUNT];
+  bool trim_scheduled_;
+  base::WeakPtrFactory<ReadbackResourcePool> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadbackResourcePool);
+};
+//ChromePic
+
 }  // namespace
 
 namespace content {
@@ -130,6 +386,7 @@ class GLHelper::CopyTextureToImpl
         context_support_(context_support),
         helper_(helper),
         flush_(gl),
+        pool_(gl),
         max_draw_buffers_(0) {
     const GLubyte* extensions = gl_->GetString(GL_EXTENSIONS);
     if (!extensions)
@@ -347,6 +604,8 @@ class GLHelper::CopyTextureToImpl
   // Copies the block of pixels specified with |src_subrect| from |src_texture|,
   // scales it to |dst_size|, writes it into a texture, and returns its ID.
   // |src_size| is the size of |src_texture|.
+  // ChromePic: with |pooled|, the texture comes from |pool_| and goes back
+  // with pool_.ReleaseTexture() instead of being deleted.
   GLuint ScaleTexture(GLuint src_texture,
                       const gfx::Size& src_size,
                       const gfx::Rect& src_subrect,
@@ -354,7 +613,8 @@ class GLHelper::CopyTextureToImpl
                       bool vertically_flip_texture,
                       bool swizzle,
                       SkColorType color_type,
-                      GLHelper::ScalerQuality quality);
+                      GLHelper::ScalerQuality quality,
+                      bool pooled);
 
   // Converts each four consecutive pixels of the source texture into one pixel
   // in the result texture with each pixel channel representing the grayscale
@@ -369,6 +629,7 @@ class GLHelper::CopyTextureToImpl
   // useful data.
   // If swizzle is set to true, the transformed pixels are reordered:
   // R1G1B1A1 R2G2B2A2 R3G3B3A3 R4G4B4A4 -> X3X2X1X4.
+  // ChromePic: the texture comes from |pool_|.
   GLuint EncodeTextureAsGrayscale(GLuint src_texture,
                                   const gfx::Size& src_size,
                                   gfx::Size* const encoded_texture_size,
@@ -395,6 +656,10 @@ class GLHelper::CopyTextureToImpl
   // this object is destroyed. Must be declared before other Scoped* fields.
   ScopedFlush flush_;
 
+  //ChromePic
+  ReadbackResourcePool pool_;
+  //ChromePic
+
   std::queue<Request*> request_queue_;
   GLint max_draw_buffers_;
 };
@@ -422,18 +687,15 @@ GLuint GLHelper::CopyTextureToImpl::ScaleTexture(
     bool vertically_flip_texture,
     bool swizzle,
     SkColorType color_type,
-    GLHelper::ScalerQuality quality) {
+    GLHelper::ScalerQuality quality,
+    bool pooled) {
   GLuint dst_texture = 0u;
-  gl_->GenTextures(1, &dst_texture);
   {
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG GLHelper::ScaleTexture" << ", Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  JournalEntry journal_entry(JOURNAL_STAGE_GL_SCALE_TEXTURE);
+  EventJournal::Record(&journal_entry);
   //ChromePic
     GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
-    ScopedTextureBinder<GL_TEXTURE_2D> texture_binder(gl_, dst_texture);
 
     // Use GL_RGBA for destination/temporary texture unless we're working with
     // 16-bit data
@@ -442,6 +704,13 @@ GLuint GLHelper::CopyTextureToImpl::ScaleTexture(
       type = GL_UNSIGNED_SHORT_5_6_5;
     }
 
+    //ChromePic
+    if (pooled) {
+      dst_texture = pool_.AcquireTexture(dst_size, format, type);
+    } else {
+    //ChromePic
+    gl_->GenTextures(1, &dst_texture);
+    ScopedTextureBinder<GL_TEXTURE_2D> texture_binder(gl_, dst_texture);
     gl_->TexImage2D(GL_TEXTURE_2D,
                     0,
                     format,
@@ -451,6 +720,9 @@ GLuint GLHelper::CopyTextureToImpl::ScaleTexture(
                     format,
                     type,
                     NULL);
+    //ChromePic
+    }
+    //ChromePic
   }
   scoped_ptr<ScalerInterface> scaler(
       helper_->CreateScaler(quality,
@@ -469,23 +741,13 @@ GLuint GLHelper::CopyTextureToImpl::EncodeTextureAsGrayscale(
     gfx::Size* const encoded_texture_size,
     bool vertically_flip_texture,
     bool swizzle) {
-  GLuint dst_texture = 0u;
-  gl_->GenTextures(1, &dst_texture);
   // The size of the encoded texture.
   *encoded_texture_size =
       gfx::Size((src_size.width() + 3) / 4, src_size.height());
-  {
-    ScopedTextureBinder<GL_TEXTURE_2D> texture_binder(gl_, dst_texture);
-    gl_->TexImage2D(GL_TEXTURE_2D,
-                    0,
-                    GL_RGBA,
-                    encoded_texture_size->width(),
-                    encoded_texture_size->height(),
-                    0,
-                    GL_RGBA,
-                    GL_UNSIGNED_BYTE,
-                    NULL);
-  }
+  //ChromePic
+  GLuint dst_texture =
+      pool_.AcquireTexture(*encoded_texture_size, GL_RGBA, GL_UNSIGNED_BYTE);
+  //ChromePic
 
   helper_->InitScalerImpl();
   scoped_ptr<ScalerInterface> grayscale_scaler(
@@ -510,26 +772,17 @@ void GLHelper::CopyTextureToImpl::ReadbackAsync(
     size_t bytes_per_pixel,
     const base::Callback<void(bool)>& callback) {
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG GLHelper::ReadbackAsync" << ", Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  JournalEntry journal_entry(JOURNAL_STAGE_GL_READBACK_ASYNC);
+  EventJournal::Record(&journal_entry);
   //ChromePic
   TRACE_EVENT0("gpu.capture", "GLHelper::CopyTextureToImpl::ReadbackAsync");
   Request* request =
       new Request(dst_size, bytes_per_row, row_stride_bytes, out, callback);
   request_queue_.push(request);
-  request->buffer = 0u;
-
-  gl_->GenBuffers(1, &request->buffer);
-  gl_->BindBuffer(GL_PIXEL_PACK_TRANSFER_BUFFER_CHROMIUM, request->buffer);
-  gl_->BufferData(GL_PIXEL_PACK_TRANSFER_BUFFER_CHROMIUM,
-                  bytes_per_pixel * dst_size.GetArea(),
-                  NULL,
-                  GL_STREAM_READ);
-
-  request->query = 0u;
-  gl_->GenQueriesEXT(1, &request->query);
+  //ChromePic
+  request->buffer = pool_.AcquireBuffer(bytes_per_pixel * dst_size.GetArea());
+  request->query = pool_.AcquireQuery();
+  //ChromePic
   gl_->BeginQueryEXT(GL_ASYNC_PIXEL_PACK_COMPLETED_CHROMIUM, request->query);
   gl_->ReadPixels(0,
                   0,
@@ -598,7 +851,8 @@ void GLHelper::CopyTextureToImpl::CropScaleReadbackAndCleanTexture(
                      scale_swizzle,
                      out_color_type == kAlpha_8_SkColorType ? kN32_SkColorType
                                                             : out_color_type,
-                     quality);
+                     quality,
+                     true);
     DCHECK(texture);
   }
 
@@ -618,8 +872,10 @@ void GLHelper::CopyTextureToImpl::CropScaleReadbackAndCleanTexture(
                                  encode_as_grayscale_vertical_flip,
                                  encode_as_grayscale_swizzle);
     // If the scaled texture was created - delete it
+    //ChromePic
     if (scale_texture)
-      gl_->DeleteTextures(1, &texture);
+      pool_.ReleaseTexture(texture);
+    //ChromePic
     texture = tmp_texture;
     DCHECK(texture);
   }
@@ -647,7 +903,9 @@ void GLHelper::CopyTextureToImpl::CropScaleReadbackAndCleanTexture(
                 type,
                 bytes_per_pixel,
                 callback);
-  gl_->DeleteTextures(1, &texture);
+  //ChromePic
+  pool_.ReleaseTexture(texture);
+  //ChromePic
 }
 
 void GLHelper::CopyTextureToImpl::ReadbackTextureSync(
@@ -725,7 +983,8 @@ GLuint GLHelper::CopyTextureToImpl::CopyAndScaleTexture(
                       vertically_flip_texture,
                       false,
                       kRGBA_8888_SkColorType,  // GL_RGBA
-                      quality);
+                      quality,
+                      false);
 }
 
 void GLHelper::CopyTextureToImpl::ReadbackDone(Request* finished_request,
@@ -776,24 +1035,28 @@ void GLHelper::CopyTextureToImpl::FinishRequest(
     bool result,
     FinishRequestHelper* finish_request_helper) {
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG GLHelper::FinishRequest" << ", Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  JournalEntry journal_entry(JOURNAL_STAGE_GL_FINISH_REQUEST);
+  EventJournal::Record(&journal_entry);
   //ChromePic
   TRACE_EVENT0("gpu.capture", "GLHelper::CopyTextureToImpl::FinishRequest");
   DCHECK(request_queue_.front() == request);
   request_queue_.pop();
   request->result = result;
   ScopedFlush flush(gl_);
+  //ChromePic
+  // The query and buffer of a cancelled request may still be in use.
   if (request->query != 0) {
-    gl_->DeleteQueriesEXT(1, &request->query);
+    if (request->done)
+      pool_.ReleaseQuery(request->query);
+    else
+      gl_->DeleteQueriesEXT(1, &request->query);
     request->query = 0;
   }
   if (request->buffer != 0) {
-    gl_->DeleteBuffers(1, &request->buffer);
+    pool_.ReleaseBuffer(request->buffer, request->done);
     request->buffer = 0;
   }
+  //ChromePic
   finish_request_helper->Add(request);
 }
 
@@ -853,10 +1116,8 @@ void GLHelper::CropScaleReadbackAndCleanMailbox(
     const base::Callback<void(bool)>& callback,
     GLHelper::ScalerQuality quality) {
   //ChromePic
-  std::ostringstream ss;
-  ss << "DEBUG GLHelper::CropScaleReadbackAndCleanMailbox " << ", Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-  Logger::LogLineScreen(ss.str(), true);
-  ss.str("");
+  JournalEntry journal_entry(JOURNAL_STAGE_GL_CROP_SCALE_READBACK);
+  EventJournal::Record(&journal_entry);
   //ChromePic
   GLuint mailbox_texture = ConsumeMailboxToTexture(src_mailbox, sync_token);
   CropScaleReadbackAndCleanTexture(mailbox_texture,
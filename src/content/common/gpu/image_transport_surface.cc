@@ -23,7 +23,7 @@
 #include "ui/gl/gl_switches.h"
 
 //ChromePic
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/common/snapshot/event_journal.h"
 //ChromePic
 
 namespace content {
@@ -291,9 +291,9 @@ void PassThroughImageTransportSurface::FinishSwapBuffers(
         ui::INPUT_EVENT_LATENCY_TERMINATED_FRAME_SWAP_COMPONENT, 0, 0,
         swap_ack_time, 1);
     //ChromePic
-    std::stringstream log_stream;
-    log_stream << "PassThroughImageTransportSurface: FinishSwapBuffers, Trace ID: " <<  latency.trace_id();
-    Logger::LogLineScreen(log_stream.str(), true);
+    JournalEntry journal_entry(JOURNAL_STAGE_FRAME_SWAP);
+    journal_entry.trace_id = latency.trace_id();
+    EventJournal::Record(&journal_entry);
     //ChromePic
   }
 
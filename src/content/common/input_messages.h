@@ -34,6 +34,8 @@
 #include "ui/gfx/range/range.h"
 
 //ChromePic
+#include "base/debug/snapshot_token.h"
+#include "base/memory/shared_memory.h"
 #include "ipc/ipc_platform_file.h"
 //ChromePic
 
@@ -119,12 +121,21 @@ IPC_STRUCT_TRAITS_BEGIN(content::InputEventAck)
 IPC_STRUCT_TRAITS_END()
 
 //ChromePic 
+IPC_STRUCT_TRAITS_BEGIN(base::debug::SnapshotToken)
+  IPC_STRUCT_TRAITS_MEMBER(site_id)
+  IPC_STRUCT_TRAITS_MEMBER(trace_id)
+  IPC_STRUCT_TRAITS_MEMBER(url_id)
+IPC_STRUCT_TRAITS_END()
+
 IPC_STRUCT_BEGIN(MHTML_Params)
   // Snapshot ID.
   IPC_STRUCT_MEMBER(int, snapshot_id)
 
   // Event ID
-  IPC_STRUCT_MEMBER(std::string, event_id)
+  IPC_STRUCT_MEMBER(base::debug::SnapshotToken, event_id)
+
+  // ID of the page (URL) within the tab the snapshot was taken on.
+  IPC_STRUCT_MEMBER(int, url_id)
 
   // Flag indicating whether we should wait for a ScreenshotCaptured IPC message
   // before passing the HandleInputEvent Msg to the rest of the code 
@@ -132,6 +143,18 @@ IPC_STRUCT_BEGIN(MHTML_Params)
 
   // Indicates whether or not a DOM snapshot was taken
   IPC_STRUCT_MEMBER(bool, dom_snapshot_active)
+
+  // If set, only the first DOM snapshot of a |url_id| is stored in full and
+  // later ones only store the parts that changed since then.
+  IPC_STRUCT_MEMBER(bool, dom_snapshot_delta)
+
+  // If set, subresources are stored once per session in the browser's
+  // content-addressed resource store and referenced from the MHTML by digest.
+  IPC_STRUCT_MEMBER(bool, dom_snapshot_resource_store)
+
+  // Maximum time (in ms) the renderer holds the input event back while
+  // waiting for the ScreenshotCaptured IPC message. 0 means wait forever.
+  IPC_STRUCT_MEMBER(int, screenshot_wait_timeout_ms)
     
   // Destination file handle.
   IPC_STRUCT_MEMBER(IPC::PlatformFileForTransit, destination_file)
@@ -154,8 +177,28 @@ IPC_MESSAGE_ROUTED3(InputMsg_HandleInputEvent,
 
 IPC_MESSAGE_ROUTED3(InputMsg_ScreenshotCaptured,
                     int  /* snapshot_id */,
-                    std::string /* event_id */,
+                    base::debug::SnapshotToken /* event_id */,
                     bool /* optimized - whether the notification is optimized */)
+
+// Hands the renderer the shared-memory ring its forensic log lines go to; the
+// browser writes them out (see base/debug/forensic_log.h). Handled on the IO
+// thread by InputEventFilter.
+IPC_MESSAGE_ROUTED2(InputMsg_AttachForensicLog,
+                    base::SharedMemoryHandle /* ring */,
+                    uint32_t /* size */)
+
+// Counts every |sampling_interval|th IPC message the renderer receives, by
+// type; 0 stops counting (see content/renderer/input/ipc_message_stats.h).
+IPC_MESSAGE_ROUTED1(InputMsg_SetIPCMessageStats,
+                    int /* sampling_interval */)
+
+// Writes the renderer's IPC message counters to the forensic log.
+IPC_MESSAGE_ROUTED0(InputMsg_DumpIPCMessageStats)
+
+// Tells the renderer the browser could not store a DOM snapshot subresource,
+// so that the next snapshot using it sends it again.
+IPC_MESSAGE_ROUTED1(InputMsg_SnapshotResourceStoreFailed,
+                    std::string /* digest (hex SHA-256) */)
 //ChromePic 
 
 // Sends the cursor visibility state to the render widget.
@@ -308,6 +351,20 @@ IPC_MESSAGE_ROUTED1(InputHostMsg_DidOverscroll,
 // Sent by the compositor when a fling animation is stopped.
 IPC_MESSAGE_ROUTED0(InputHostMsg_DidStopFlinging)
 
+//ChromePic
+// Hands a DOM snapshot subresource to the browser's content-addressed
+// resource store. Sent once per resource digest per renderer process.
+IPC_MESSAGE_ROUTED2(InputHostMsg_StoreSnapshotResource,
+                    std::string /* digest (hex SHA-256) */,
+                    std::vector<char> /* data */)
+
+// Tells the browser a DOM snapshot has been written, so it can stop tracking
+// the snapshot once its screenshot is in as well.
+IPC_MESSAGE_ROUTED2(InputHostMsg_DOMSnapshotCaptured,
+                    int /* snapshot_id */,
+                    int64_t /* size in bytes, -1 on failure */)
+//ChromePic
+
 // Acknowledges receipt of a InputMsg_MoveCaret message.
 IPC_MESSAGE_ROUTED0(InputHostMsg_MoveCaret_ACK)
 
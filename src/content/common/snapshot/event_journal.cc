@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/common/snapshot/event_journal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/debug/forensic_log.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/path_service.h"
+#include "base/process/process_handle.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/time/time.h"
+
+using base::subtle::Atomic32;
+
+namespace content {
+
+namespace {
+
+// 2048 records of 48 bytes per thread: ~40k records/s between drains.
+const uint32_t kRingSize = 2048;
+const uint32_t kRingMask = kRingSize - 1;
+const int kDrainIntervalMs = 50;
+
+const char kJournalMagic[] = "CHROMEPIC-JOURNAL\n";
+const uint32_t kJournalVersion = 1;
+
+// Indexed by JournalStage.
+const char* const kStageNames[] = {
+    "SnapshotHandler:: Input Event",
+    "SnapshotHandler:: Snapshot Worthy Event",
+    "SnapshotHandler:: Snapshot Event",
+    "SnapshotHandler:: Event Metadata",
+    "SnapshotHandler:: Pending Snapshot Found",
+    "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_BEGIN_RWH_COMPONENT",
+    "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_GESTURE_COMPONENT",
+    "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_TOUCH_COMPONENT",
+    "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_MOUSE_WHEEL_COMPONENT",
+    "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_MOUSE_COMPONENT",
+    "RenderWidgetHostLatencyTracker:: INPUT_EVENT_LATENCY_TERMINATED_KEYBOARD_COMPONENT",
+    "OutputSurface:: Frame Swap",
+    "DelegatedFrameHost:: PrepareTextureCopyOutputResult BEGIN",
+    "DelegatedFrameHost:: PrepareTextureCopyOutputResult END",
+    "GLHelper:: ScaleTexture",
+    "GLHelper:: ReadbackAsync",
+    "GLHelper:: FinishRequest",
+    "GLHelper:: CropScaleReadbackAndCleanMailbox",
+    "InputEventFilter:: Received InputMsg_Screenshot",
+    "RenderWidget:: Handing input to the input handling code",
+    "EventJournal:: Dropped Records",
+    "SnapshotHandler:: Screenshot Request",
+    "View:: Screenshot Copy Request",
+    "DelegatedFrameHost:: Screenshot Copy Result",
+    "SnapshotHandler:: Screenshot Captured",
+    "OutputSurface:: Screenshot Ack Sent",
+    "ScreenshotEncoderPool:: Screenshot Written",
+    "RenderWidget:: Input Event Received",
+    "RenderWidget:: Input Event Held",
+    "RenderWidget:: Input Event Released",
+    "RenderWidget:: DOM Snapshot Copied",
+    "SnapshotHandler:: DOM Snapshot Captured",
+    "SnapshotGovernor:: Decision",
+};
+static_assert(arraysize(kStageNames) == JOURNAL_STAGE_COUNT,
+              "kStageNames must name every JournalStage");
+static_assert(sizeof(JournalEntry) == 48,
+              "JournalEntry is part of the journal file format");
+
+// Precedes the records of one ring in a drain.
+struct ChunkHeader {
+  uint32_t thread_id;
+  uint32_t count;
+};
+
+base::LazyInstance<EventJournal>::Leaky g_event_journal =
+    LAZY_INSTANCE_INITIALIZER;
+
+base::ThreadLocalStorage::StaticSlot g_ring_slot = TLS_INITIALIZER;
+
+void Append(std::vector<char>* buffer, const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  buffer->insert(buffer->end(), bytes, bytes + size);
+}
+
+}  // namespace
+
+base::FilePath GetSnapshotLogDirectory() {
+  base::FilePath directory;
+#if defined(OS_ANDROID)
+  PathService::Get(base::DIR_ANDROID_EXTERNAL_STORAGE, &directory);
+  directory = directory.Append(FILE_PATH_LITERAL("Download"));
+#else
+  PathService::Get(base::DIR_HOME, &directory);
+#endif
+
+  directory = directory.Append(FILE_PATH_LITERAL("snapshot_logs"));
+  base::File::Error error;
+  if (!base::CreateDirectoryAndGetError(directory, &error)) {
+    fprintf(stderr, "Error in creating an output directory for snapshot logs!\n");
+    return base::FilePath();
+  }
+  return directory;
+}
+
+void SetJournalEventId(const base::debug::SnapshotToken& event_id,
+                       JournalEntry* entry) {
+  if (event_id.is_null())
+    return;
+  entry->site_id = static_cast<int64_t>(event_id.site_id);
+  entry->url_id = event_id.url_id;
+  entry->trace_id = event_id.trace_id;
+}
+
+// Single producer (the owning thread), single consumer (Drain() on the
+// drain thread). The indices only grow and are masked on use; each sits on
+// its own cache line so the two sides do not contend.
+struct EventJournal::Ring {
+  Ring()
+      : write_index(0),
+        read_index(0),
+        dropped(0),
+        retired(0),
+        thread_id(static_cast<uint32_t>(base::PlatformThread::CurrentId())) {}
+
+  Atomic32 write_index;
+  char write_padding[64 - sizeof(Atomic32)];
+  Atomic32 read_index;
+  char read_padding[64 - sizeof(Atomic32)];
+  Atomic32 dropped;
+  // Set once the owning thread has exited; the drainer then frees the ring.
+  Atomic32 retired;
+  uint32_t thread_id;
+  JournalEntry entries[kRingSize];
+};
+
+// static
+EventJournal* EventJournal::GetInstance() {
+  return g_event_journal.Pointer();
+}
+
+// static
+void EventJournal::Record(JournalEntry* entry) {
+  EventJournal* journal = g_event_journal.Pointer();
+  Ring* ring = static_cast<Ring*>(g_ring_slot.Get());
+  if (!ring)
+    ring = journal->RegisterThread();
+
+  entry->time = base::TimeTicks::Now().ToInternalValue();
+  uint32_t write = static_cast<uint32_t>(
+      base::subtle::NoBarrier_Load(&ring->write_index));
+  uint32_t read = static_cast<uint32_t>(
+      base::subtle::Acquire_Load(&ring->read_index));
+  if (write - read >= kRingSize) {
+    base::subtle::NoBarrier_AtomicIncrement(&ring->dropped, 1);
+    return;
+  }
+  ring->entries[write & kRingMask] = *entry;
+  base::subtle::Release_Store(&ring->write_index,
+                              static_cast<Atomic32>(write + 1));
+}
+
+EventJournal::EventJournal() : drain_thread_("ChromePicJournal") {
+  g_ring_slot.Initialize(&EventJournal::RetireRing);
+  drain_thread_.Start();
+  drain_thread_.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&EventJournal::OpenFile, base::Unretained(this)));
+  drain_thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, base::Bind(&EventJournal::DrainAndReschedule,
+                            base::Unretained(this)),
+      base::TimeDelta::FromMilliseconds(kDrainIntervalMs));
+}
+
+EventJournal::~EventJournal() {
+  // Leaky; never destroyed.
+  NOTREACHED();
+}
+
+EventJournal::Ring* EventJournal::RegisterThread() {
+  Ring* ring = new Ring();
+  g_ring_slot.Set(ring);
+  base::AutoLock lock(rings_lock_);
+  rings_.push_back(ring);
+  return ring;
+}
+
+// static
+void EventJournal::RetireRing(void* ring) {
+  base::subtle::Release_Store(&static_cast<Ring*>(ring)->retired, 1);
+}
+
+void EventJournal::OpenFile() {
+  base::FilePath directory = GetSnapshotLogDirectory();
+  if (directory.empty())
+    return;
+
+  base::Time::Exploded now;
+  base::Time::Now().LocalExplode(&now);
+  std::stringstream ss;
+  ss << "journal_" << base::GetCurrentProcId() << "_" << now.month << "_"
+     << now.day_of_month << "_" << now.year << "__" << now.hour << "_"
+     << now.minute << "_" << now.second << ".bin";
+  file_.Initialize(directory.AppendASCII(ss.str()),
+                   base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  if (!file_.IsValid())
+    return;
+
+  // Header: magic, version, record size, process ID, then the NUL-terminated
+  // stage names so old journals stay readable as stages are added.
+  std::vector<char> header;
+  Append(&header, kJournalMagic, strlen(kJournalMagic));
+  const uint32_t fields[] = {kJournalVersion, sizeof(JournalEntry),
+                             static_cast<uint32_t>(base::GetCurrentProcId()),
+                             JOURNAL_STAGE_COUNT};
+  Append(&header, fields, sizeof(fields));
+  for (size_t i = 0; i < arraysize(kStageNames); ++i)
+    Append(&header, kStageNames[i], strlen(kStageNames[i]) + 1);
+  if (file_.WriteAtCurrentPos(header.data(), header.size()) < 0)
+    file_.Close();
+}
+
+void EventJournal::DrainAndReschedule() {
+  Drain();
+  drain_thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, base::Bind(&EventJournal::DrainAndReschedule,
+                            base::Unretained(this)),
+      base::TimeDelta::FromMilliseconds(kDrainIntervalMs));
+}
+
+void EventJournal::Flush() {
+  drain_thread_.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&EventJournal::Drain, base::Unretained(this)));
+}
+
+void EventJournal::Drain() {
+  std::vector<Ring*> rings;
+  {
+    base::AutoLock lock(rings_lock_);
+    rings = rings_;
+  }
+
+  buffer_.clear();
+  std::vector<Ring*> retired;
+  for (Ring* ring : rings) {
+    // Read |retired| first: once it is set every record is visible.
+    bool is_retired = base::subtle::Acquire_Load(&ring->retired) != 0;
+    uint32_t write = static_cast<uint32_t>(
+        base::subtle::Acquire_Load(&ring->write_index));
+    uint32_t read = static_cast<uint32_t>(
+        base::subtle::NoBarrier_Load(&ring->read_index));
+    Atomic32 dropped = base::subtle::NoBarrier_AtomicExchange(&ring->dropped, 0);
+
+    ChunkHeader chunk = {ring->thread_id, write - read};
+    if (dropped)
+      chunk.count++;
+    if (chunk.count) {
+      Append(&buffer_, &chunk, sizeof(chunk));
+      for (uint32_t i = read; i != write; ++i)
+        Append(&buffer_, &ring->entries[i & kRingMask], sizeof(JournalEntry));
+      if (dropped) {
+        JournalEntry entry(JOURNAL_STAGE_DROPPED);
+        entry.time = base::TimeTicks::Now().ToInternalValue();
+        entry.arg0 = dropped;
+        Append(&buffer_, &entry, sizeof(entry));
+      }
+    }
+    base::subtle::Release_Store(&ring->read_index,
+                                static_cast<Atomic32>(write));
+    if (is_retired)
+      retired.push_back(ring);
+  }
+
+  if (!retired.empty()) {
+    base::AutoLock lock(rings_lock_);
+    for (Ring* ring : retired) {
+      rings_.erase(std::find(rings_.begin(), rings_.end(), ring));
+      delete ring;
+    }
+  }
+
+  if (buffer_.empty())
+    return;
+  if (file_.IsValid() &&
+      file_.WriteAtCurrentPos(buffer_.data(), buffer_.size()) >= 0)
+    return;
+  WriteText();
+}
+
+// Same layout as tools/chromepic/journal_to_text.py, for processes that cannot
+// open the journal file. The lines go through the forensic log, which in a
+// renderer forwards them to the browser.
+void EventJournal::WriteText() {
+  size_t offset = 0;
+  while (offset + sizeof(ChunkHeader) <= buffer_.size()) {
+    ChunkHeader chunk;
+    memcpy(&chunk, &buffer_[offset], sizeof(chunk));
+    offset += sizeof(chunk);
+    for (uint32_t i = 0; i < chunk.count; ++i) {
+      JournalEntry entry;
+      memcpy(&entry, &buffer_[offset], sizeof(entry));
+      offset += sizeof(entry);
+      std::stringstream ss;
+      ss << (entry.stage < JOURNAL_STAGE_COUNT ? kStageNames[entry.stage]
+                                               : "Unknown Stage")
+         << ", Process ID: " << base::GetCurrentProcId()
+         << ", Thread ID: " << chunk.thread_id << ", Event ID: ";
+      if (entry.site_id)
+        ss << "0x" << std::hex << entry.site_id << std::dec;
+      else
+        ss << "?";
+      ss << "_" << entry.url_id << "_" << entry.trace_id
+         << ", Snapshot ID: " << entry.snapshot_id
+         << ", Event Type: " << entry.event_type << ", Args: " << entry.arg0
+         << ", " << entry.arg1 << ",\tTime: " << entry.time;
+      base::debug::WriteForensicLog(base::debug::FORENSIC_LOG_CATEGORY_SNAPSHOT,
+                                    ss.str(), false);
+    }
+  }
+}
+
+}  // namespace content
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_COMMON_SNAPSHOT_EVENT_JOURNAL_H_
+#define CONTENT_COMMON_SNAPSHOT_EVENT_JOURNAL_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/debug/snapshot_token.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+
+namespace content {
+
+// The point in the snapshot pipeline a journal record was written at. The
+// names in event_journal.cc are written into every journal file, so new stages
+// go at the end and tools/chromepic/journal_to_text.py needs no update.
+enum JournalStage {
+  // SnapshotHandler (browser UI thread).
+  JOURNAL_STAGE_INPUT_EVENT,
+  JOURNAL_STAGE_SNAPSHOT_WORTHY_EVENT,
+  // arg0: pending snapshots, arg1: evicted snapshots.
+  JOURNAL_STAGE_SNAPSHOT_EVENT,
+  // arg0, arg1: coordinates, or arg0: key code.
+  JOURNAL_STAGE_EVENT_METADATA,
+  JOURNAL_STAGE_PENDING_SNAPSHOT_FOUND,
+  // RenderWidgetHostLatencyTracker.
+  JOURNAL_STAGE_LATENCY_BEGIN_RWH,
+  JOURNAL_STAGE_LATENCY_TERMINATED_GESTURE,
+  JOURNAL_STAGE_LATENCY_TERMINATED_TOUCH,
+  JOURNAL_STAGE_LATENCY_TERMINATED_MOUSE_WHEEL,
+  JOURNAL_STAGE_LATENCY_TERMINATED_MOUSE,
+  JOURNAL_STAGE_LATENCY_TERMINATED_KEYBOARD,
+  // Output surfaces, one record per LatencyInfo of a swap.
+  JOURNAL_STAGE_FRAME_SWAP,
+  // Screenshot readback.
+  JOURNAL_STAGE_COPY_OUTPUT_RESULT_BEGIN,
+  JOURNAL_STAGE_COPY_OUTPUT_RESULT_END,
+  JOURNAL_STAGE_GL_SCALE_TEXTURE,
+  JOURNAL_STAGE_GL_READBACK_ASYNC,
+  JOURNAL_STAGE_GL_FINISH_REQUEST,
+  JOURNAL_STAGE_GL_CROP_SCALE_READBACK,
+  // Renderer. arg0 of SCREENSHOT_ACK is 1 for optimized screenshots.
+  JOURNAL_STAGE_RENDERER_SCREENSHOT_ACK,
+  JOURNAL_STAGE_RENDERER_DISPATCH,
+  // Written by the drainer. arg0: records a full ring had to drop.
+  JOURNAL_STAGE_DROPPED,
+  // Per-snapshot timeline, keyed by snapshot ID and event ID; see
+  // tools/chromepic/snapshot_latency.py.
+  JOURNAL_STAGE_SCREENSHOT_REQUEST,
+  // The view turned the request into a cc::CopyOutputRequest.
+  JOURNAL_STAGE_SCREENSHOT_COPY_REQUEST,
+  // The compositor drew and copied the frame (DelegatedFrameHost only).
+  JOURNAL_STAGE_SCREENSHOT_COPY_RESULT,
+  // arg0: content::ReadbackResponse.
+  JOURNAL_STAGE_SCREENSHOT_CAPTURED,
+  // Optimized acknowledgement from the output surface.
+  JOURNAL_STAGE_SCREENSHOT_ACK_SENT,
+  // arg0: encode time, arg1: write time (us). arg0 is -1 for duplicates.
+  JOURNAL_STAGE_SCREENSHOT_WRITTEN,
+  JOURNAL_STAGE_RENDERER_INPUT_RECEIVED,
+  JOURNAL_STAGE_RENDERER_INPUT_HELD,
+  // arg0: hold time (us), arg1: 1 if the wait timed out.
+  JOURNAL_STAGE_RENDERER_INPUT_RELEASED,
+  // arg0: main thread copy time (us).
+  JOURNAL_STAGE_DOM_SNAPSHOT_COPIED,
+  // arg0: size in KB.
+  JOURNAL_STAGE_DOM_SNAPSHOT_CAPTURED,
+  // arg0: SnapshotGovernor::Decision, arg1: load in percent of the budget.
+  JOURNAL_STAGE_GOVERNOR_DECISION,
+  JOURNAL_STAGE_COUNT,
+};
+
+// One journal record. Plain data so that writing one is a copy; the event ID
+// string is kept as its parts (site ID, URL ID, trace ID) and put back together
+// offline. Fields a stage does not know stay at their defaults.
+struct JournalEntry {
+  explicit JournalEntry(JournalStage stage = JOURNAL_STAGE_COUNT)
+      : time(0),
+        site_id(0),
+        trace_id(-1),
+        url_id(-1),
+        snapshot_id(-1),
+        arg0(0),
+        arg1(0),
+        stage(static_cast<uint16_t>(stage)),
+        event_type(-1),
+        reserved(0) {}
+
+  // TimeTicks internal value, the same clock as Logger's "Time:" column.
+  int64_t time;
+  int64_t site_id;
+  int64_t trace_id;
+  int32_t url_id;
+  int32_t snapshot_id;
+  int32_t arg0;
+  int32_t arg1;
+  uint16_t stage;
+  // blink::WebInputEvent::Type.
+  int16_t event_type;
+  uint32_t reserved;
+};
+
+// snapshot_logs under the home directory (Download on Android), where the
+// loggers and journals write. Creates it if needed; empty on failure.
+base::FilePath GetSnapshotLogDirectory();
+
+// Fills the site, URL and trace IDs of |entry| from an event ID. Leaves them
+// unset for a null token.
+void SetJournalEventId(const base::debug::SnapshotToken& event_id,
+                       JournalEntry* entry);
+
+// Per-process binary journal of the snapshot pipeline, replacing
+// Logger::LogLineScreen on paths that run for every input event or frame.
+// Each thread appends to its own single-producer ring without locks or
+// allocation; a "ChromePicJournal" thread drains all rings every 50ms into
+// snapshot_logs/journal_<pid>_<time>.bin, which
+// tools/chromepic/journal_to_text.py turns back into text. Where the file
+// cannot be created (sandboxed processes) the drainer formats the records to
+// stderr instead, still off the recording thread.
+class EventJournal {
+ public:
+  static EventJournal* GetInstance();
+
+  // Timestamps |entry| and appends it to the calling thread's ring. If the
+  // ring is full the record is dropped and counted.
+  static void Record(JournalEntry* entry);
+
+  // Drains every ring without waiting for the next 50ms tick. Safe to call
+  // from any thread; the drain itself happens on the drain thread.
+  void Flush();
+
+ private:
+  friend struct base::DefaultLazyInstanceTraits<EventJournal>;
+  struct Ring;
+
+  EventJournal();
+  ~EventJournal();
+
+  Ring* RegisterThread();
+  static void RetireRing(void* ring);
+
+  void OpenFile();
+  void DrainAndReschedule();
+  void Drain();
+  void WriteText();
+
+  // Opens the journal file and runs every drain, so the rings have a single
+  // consumer and no recording thread does file IO.
+  base::Thread drain_thread_;
+  // Guards |rings_|. Taken once per thread and by the drainer, never per
+  // record.
+  base::Lock rings_lock_;
+  std::vector<Ring*> rings_;
+  base::File file_;
+  std::vector<char> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventJournal);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_SNAPSHOT_EVENT_JOURNAL_H_
@@ -28,7 +28,10 @@
 #include "content/common/frame_messages.h"
 #include "base/trace_event/trace_event.h"
 #include "base/threading/platform_thread.h"
-#include "content/browser/renderer_host/snapshot/logger.h"
+#include "base/debug/forensic_log.h"
+#include "base/memory/shared_memory.h"
+#include "content/common/snapshot/event_journal.h"
+#include "content/renderer/input/ipc_message_stats.h"
 #include "content/renderer/input/screenshot_status.h"
 //ChromePic
 
@@ -49,6 +52,18 @@ const char* GetInputMessageTypeName(const IPC::Message& message) {
   return "NonInputMsgType";
 }
 
+//ChromePic
+// For IPCMessageStats, which sees messages of every class.
+const char* GetInputMessageTypeNameOrNull(uint32_t type) {
+  switch (type) {
+#include "content/common/input_messages.h"
+    default:
+      break;
+  };
+  return nullptr;
+}
+//ChromePic
+
 namespace content {
 
 InputEventFilter::InputEventFilter(
@@ -127,13 +142,37 @@ static bool RequiresThreadBounce(const IPC::Message& message) {
 bool InputEventFilter::OnMessageReceived(const IPC::Message& message) {
 
   //ChromePic
-  fprintf(stderr, "IPC message received: %s", GetInputMessageTypeName(message));
+  IPCMessageStats::GetInstance()->Record(message);
   //ChromePic
   if (!RequiresThreadBounce(message))
     return false;
 
   TRACE_EVENT0("input", "InputEventFilter::OnMessageReceived::InputMessage");
 
+  //ChromePic
+  // Process-wide, not tied to a route.
+  if (message.type() == InputMsg_SetIPCMessageStats::ID) {
+    InputMsg_SetIPCMessageStats::Param params;
+    if (InputMsg_SetIPCMessageStats::Read(&message, &params))
+      IPCMessageStats::GetInstance()->SetSamplingInterval(base::get<0>(params));
+    return true;
+  }
+  if (message.type() == InputMsg_DumpIPCMessageStats::ID) {
+    IPCMessageStats::GetInstance()->Dump(&GetInputMessageTypeNameOrNull);
+    return true;
+  }
+  if (message.type() == InputMsg_AttachForensicLog::ID) {
+    InputMsg_AttachForensicLog::Param params;
+    if (InputMsg_AttachForensicLog::Read(&message, &params)) {
+      scoped_ptr<base::SharedMemory> memory(
+          new base::SharedMemory(base::get<0>(params), false));
+      base::debug::ForensicLogSink::GetInstance()->AttachSharedRing(
+          std::move(memory), base::get<1>(params));
+    }
+    return true;
+  }
+  //ChromePic
+
   {
     base::AutoLock locked(routes_lock_);
     if (routes_.find(message.routing_id()) == routes_.end())
@@ -161,19 +200,22 @@ void InputEventFilter::ForwardToHandler(const IPC::Message& message) {
     InputMsg_ScreenshotCaptured::Param screenshot_params;
     InputMsg_ScreenshotCaptured::Read(&message, &screenshot_params);
     int snapshot_id = base::get<0>(screenshot_params);
-    std::string event_id = base::get<1>(screenshot_params);
     bool optimized = base::get<2>(screenshot_params);
+    TRACE_EVENT_WITH_FLOW2("forensics", "InputEventFilter::ScreenshotCaptured",
+                           base::debug::ForensicFlowId(
+                               base::get<1>(screenshot_params), snapshot_id),
+                           TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+                           "snapshot_id", snapshot_id, "optimized", optimized);
     ScreenshotStatus::GetInstance()->ss_lock.Acquire();
-    ScreenshotStatus::GetInstance()->captured_screenshots.insert(snapshot_id);
+    if (!ScreenshotStatus::GetInstance()->abandoned_screenshots.erase(snapshot_id))
+      ScreenshotStatus::GetInstance()->captured_screenshots.insert(snapshot_id);
     ScreenshotStatus::GetInstance()->ss_lock.Release();
-    
-    std::stringstream log_stream;
-    if (!optimized)
-        log_stream << "InputEventFilter: Received InputMsg_Screenshot, Event ID: " << event_id;
-    else
-        log_stream << "InputEventFilter: Received InputMsg_Screenshot_Optimized, Event ID: " << event_id;
-
-    Logger::LogLineScreen(log_stream.str(), true);
+
+    // The browser journals the full event ID with this snapshot ID.
+    JournalEntry journal_entry(JOURNAL_STAGE_RENDERER_SCREENSHOT_ACK);
+    journal_entry.snapshot_id = snapshot_id;
+    journal_entry.arg0 = optimized;
+    EventJournal::Record(&journal_entry);
   }
   //ChromePic
 
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/renderer/input/ipc_message_stats.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "base/debug/forensic_log.h"
+#include "ipc/ipc_message.h"
+#include "ipc/ipc_message_macros.h"
+
+using base::subtle::Atomic32;
+
+namespace content {
+
+namespace {
+
+base::LazyInstance<IPCMessageStats>::Leaky g_ipc_message_stats =
+    LAZY_INSTANCE_INITIALIZER;
+
+struct DumpEntry {
+  uint32_t type;
+  int64_t count;
+  int64_t bytes;
+
+  bool operator<(const DumpEntry& other) const {
+    return bytes > other.bytes;
+  }
+};
+
+}  // namespace
+
+// static
+IPCMessageStats* IPCMessageStats::GetInstance() {
+  return g_ipc_message_stats.Pointer();
+}
+
+IPCMessageStats::IPCMessageStats() : interval_(0), sequence_(0), overflow_(0) {
+  memset(slots_, 0, sizeof(slots_));
+}
+
+IPCMessageStats::~IPCMessageStats() {}
+
+void IPCMessageStats::SetSamplingInterval(int interval) {
+  base::subtle::NoBarrier_Store(&interval_, std::max(interval, 0));
+}
+
+void IPCMessageStats::Record(const IPC::Message& message) {
+  Atomic32 interval = base::subtle::NoBarrier_Load(&interval_);
+  if (!interval)
+    return;
+  if (interval > 1) {
+    uint32_t sequence = static_cast<uint32_t>(
+        base::subtle::NoBarrier_AtomicIncrement(&sequence_, 1));
+    if (sequence % static_cast<uint32_t>(interval))
+      return;
+  }
+
+  Slot* slot = FindSlot(message.type());
+  if (!slot) {
+    base::subtle::NoBarrier_AtomicIncrement(&overflow_, 1);
+    return;
+  }
+  base::subtle::NoBarrier_AtomicIncrement(&slot->count, 1);
+  const uint32_t size = static_cast<uint32_t>(message.size());
+  uint32_t bytes_low = static_cast<uint32_t>(
+      base::subtle::NoBarrier_AtomicIncrement(&slot->bytes_low,
+                                              static_cast<Atomic32>(size)));
+  if (bytes_low < size)
+    base::subtle::NoBarrier_AtomicIncrement(&slot->bytes_high, 1);
+}
+
+IPCMessageStats::Slot* IPCMessageStats::FindSlot(uint32_t type) {
+  // Message types are never 0: line numbers start at 1.
+  Atomic32 key = static_cast<Atomic32>(type);
+  uint32_t index = (type * 2654435761u) % kNumSlots;
+  for (int probe = 0; probe < kNumSlots; ++probe) {
+    Slot* slot = &slots_[(index + probe) % kNumSlots];
+    Atomic32 slot_type = base::subtle::Acquire_Load(&slot->type);
+    if (slot_type == key)
+      return slot;
+    if (slot_type)
+      continue;
+    slot_type = base::subtle::Acquire_CompareAndSwap(&slot->type, 0, key);
+    if (!slot_type || slot_type == key)
+      return slot;
+  }
+  return nullptr;
+}
+
+void IPCMessageStats::Dump(MessageNameFunction name_function) {
+  Atomic32 interval = base::subtle::NoBarrier_Load(&interval_);
+  int64_t scale = interval ? interval : 1;
+
+  std::vector<DumpEntry> entries;
+  int64_t total_count = 0;
+  int64_t total_bytes = 0;
+  for (int i = 0; i < kNumSlots; ++i) {
+    Atomic32 type = base::subtle::Acquire_Load(&slots_[i].type);
+    if (!type)
+      continue;
+    DumpEntry entry;
+    entry.type = static_cast<uint32_t>(type);
+    entry.count = scale * base::subtle::NoBarrier_Load(&slots_[i].count);
+    // A Record() carrying between the two loads can skew this by 4GB; the
+    // dump is a sample anyway.
+    uint32_t bytes_high = static_cast<uint32_t>(
+        base::subtle::NoBarrier_Load(&slots_[i].bytes_high));
+    uint32_t bytes_low = static_cast<uint32_t>(
+        base::subtle::NoBarrier_Load(&slots_[i].bytes_low));
+    entry.bytes =
+        scale * (static_cast<int64_t>(bytes_high) << 32 | bytes_low);
+    total_count += entry.count;
+    total_bytes += entry.bytes;
+    entries.push_back(entry);
+  }
+  std::sort(entries.begin(), entries.end());
+
+  std::ostringstream ss;
+  ss << "IPCMessageStats:: Sampling Interval: " << interval
+     << ", # Types: " << entries.size() << ", Messages: " << total_count
+     << ", Bytes: " << total_bytes << ", Overflow: "
+     << scale * base::subtle::NoBarrier_Load(&overflow_);
+  base::debug::WriteForensicLog(base::debug::FORENSIC_LOG_CATEGORY_INPUT,
+                                ss.str(), true);
+  for (const DumpEntry& entry : entries) {
+    const char* name = name_function ? name_function(entry.type) : nullptr;
+    ss.str("");
+    ss << "IPCMessageStats:: Type: " << (name ? name : "?") << " (class "
+       << IPC_MESSAGE_ID_CLASS(entry.type) << ", line "
+       << IPC_MESSAGE_ID_LINE(entry.type) << "), Messages: " << entry.count
+       << ", Bytes: " << entry.bytes;
+    base::debug::WriteForensicLog(base::debug::FORENSIC_LOG_CATEGORY_INPUT,
+                                  ss.str(), false);
+  }
+}
+
+}  // namespace content
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_RENDERER_INPUT_IPC_MESSAGE_STATS_H_
+#define CONTENT_RENDERER_INPUT_IPC_MESSAGE_STATS_H_
+
+#include <stdint.h>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+
+namespace IPC {
+class Message;
+}
+
+namespace content {
+
+// Per-message-type counts and byte totals of the IPC messages a renderer
+// receives, kept in atomics and sampled so that the IO thread pays a couple
+// of atomic operations per sampled message and nothing when it is off.
+// Turned on and off, and dumped to the forensic log, by the browser with
+// InputMsg_SetIPCMessageStats and InputMsg_DumpIPCMessageStats
+// (--ipc-message-stats[=<sampling interval>]).
+class IPCMessageStats {
+ public:
+  // Names the message types the dump knows; returns null for the others.
+  typedef const char* (*MessageNameFunction)(uint32_t type);
+
+  static IPCMessageStats* GetInstance();
+
+  // Counts every |interval|th message; 0 turns counting off. Any thread.
+  void SetSamplingInterval(int interval);
+
+  // Any thread.
+  void Record(const IPC::Message& message);
+
+  // Writes the counters, scaled by the sampling interval, to the forensic
+  // log. Any thread; concurrent Record()s may or may not be included.
+  void Dump(MessageNameFunction name_function);
+
+ private:
+  friend struct base::DefaultLazyInstanceTraits<IPCMessageStats>;
+
+  // Open addressing on the message type. A slot's type is claimed once with
+  // a compare-and-swap and never freed.
+  struct Slot {
+    base::subtle::Atomic32 type;
+    base::subtle::Atomic32 count;
+    // Sampled bytes. Atomic64 does not exist on 32-bit builds, so the total
+    // is split in two words; whoever wraps |bytes_low| carries into
+    // |bytes_high|.
+    base::subtle::Atomic32 bytes_low;
+    base::subtle::Atomic32 bytes_high;
+  };
+
+  static const int kNumSlots = 512;
+
+  IPCMessageStats();
+  ~IPCMessageStats();
+
+  Slot* FindSlot(uint32_t type);
+
+  base::subtle::Atomic32 interval_;
+  base::subtle::Atomic32 sequence_;
+  // Sampled messages that found the table full.
+  base::subtle::Atomic32 overflow_;
+  Slot slots_[kNumSlots];
+
+  DISALLOW_COPY_AND_ASSIGN(IPCMessageStats);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_RENDERER_INPUT_IPC_MESSAGE_STATS_H_
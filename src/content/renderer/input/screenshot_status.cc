@@ -19,4 +19,5 @@ ScreenshotStatus::ScreenshotStatus() {
 
 ScreenshotStatus::~ScreenshotStatus() {
     captured_screenshots.clear();
+    abandoned_screenshots.clear();
 }
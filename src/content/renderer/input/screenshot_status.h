@@ -15,6 +15,9 @@ class ScreenshotStatus {
    public:
     static ScreenshotStatus* GetInstance(); 
     std::unordered_set<int> captured_screenshots;
+    // Screenshots the renderer stopped waiting for; not recorded as
+    // captured when they arrive late.
+    std::unordered_set<int> abandoned_screenshots;
     ScreenshotStatus(); 
     ~ScreenshotStatus(); 
     base::Lock ss_lock;
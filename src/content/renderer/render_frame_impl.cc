@@ -1309,6 +1309,14 @@ bool RenderFrameImpl::OnMessageReceived(const IPC::Message& msg) {
   if (!frame_->document().isNull())
     GetContentClient()->SetActiveURL(frame_->document().url());
 
+  //ChromePic
+  // Edit and selection commands wait behind input events held for their
+  // screenshots, like the widget's own input.
+  RenderWidget* render_widget = GetRenderWidget();
+  if (render_widget && render_widget->HoldInputMessage(msg))
+    return true;
+  //ChromePic
+
   base::ObserverListBase<RenderFrameObserver>::Iterator it(&observers_);
   RenderFrameObserver* observer;
   while ((observer = it.GetNext()) != NULL) {
@@ -107,12 +107,18 @@
 //ChromePic
 #include "base/process/process_handle.h"
 #include "base/threading/platform_thread.h"
+#include "content/common/snapshot/event_journal.h"
+#include "base/debug/forensic_log.h"
 #include "content/browser/renderer_host/snapshot/logger.h"
+#include "content/child/thread_safe_sender.h"
 #include "content/common/frame_messages.h"
 #include "content/public/renderer/render_view.h"
 #include "content/renderer/input/screenshot_status.h"
 #include "content/renderer/render_frame_impl.h"
+#include "content/renderer/snapshot/dom_snapshot_writer.h"
 #include "third_party/WebKit/public/web/WebFrameSerializer.h"
+#include "crypto/sha2.h"
+#include "url/gurl.h"
 using blink::WebData;
 using blink::WebFrame;
 using blink::WebFrameSerializer;
@@ -219,16 +225,28 @@ class MHTMLPartsGenerationDelegate
  public:
   MHTMLPartsGenerationDelegate(
       const FrameMsg_SerializeAsMHTML_Params& params,
-      std::set<std::string>* digests_of_uris_of_serialized_resources)
+      std::set<std::string>* digests_of_uris_of_serialized_resources,
+      const std::set<std::string>* base_resource_urls = nullptr,
+      std::vector<std::string>* skipped_resource_urls = nullptr)
       : params_(params),
         digests_of_uris_of_serialized_resources_(
-            digests_of_uris_of_serialized_resources) {
-    //DCHECK(digests_of_uris_of_serialized_resources_);
+            digests_of_uris_of_serialized_resources),
+        base_resource_urls_(base_resource_urls),
+        skipped_resource_urls_(skipped_resource_urls) {
+    DCHECK(digests_of_uris_of_serialized_resources_);
   }
 
   bool shouldSkipResource(const WebURL& url) override {
-    return false;
-    /*
+    // Delta DOM snapshots: subresources that the base snapshot of this page
+    // already holds are neither copied nor written again.
+    if (base_resource_urls_) {
+      std::string spec = GURL(url).spec();
+      if (ContainsKey(*base_resource_urls_, spec)) {
+        skipped_resource_urls_->push_back(spec);
+        return true;
+      }
+    }
+
     std::string digest =
         crypto::SHA256HashString(params_.salt + GURL(url).spec());
 
@@ -240,13 +258,11 @@ class MHTMLPartsGenerationDelegate
     auto pair = digests_of_uris_of_serialized_resources_->insert(digest);
 
     //ChromePic
-    //This fails on sites like cnn.com
-    //bool insertion_took_place = pair.second;
-    //DCHECK(insertion_took_place);  // Blink should dedupe within a frame.
+    // Blink dedupes within a frame, so a failed insertion means an earlier
+    // frame of this snapshot already serialized |url| (e.g. on cnn.com).
+    bool insertion_took_place = pair.second;
+    return !insertion_took_place;
     //ChromePic
-
-    return false;
-    */
   }
 
   WebString getContentID(const WebFrame& frame) override {
@@ -266,9 +282,71 @@ class MHTMLPartsGenerationDelegate
  private:
   const FrameMsg_SerializeAsMHTML_Params& params_;
   std::set<std::string>* digests_of_uris_of_serialized_resources_;
+  const std::set<std::string>* base_resource_urls_;
+  std::vector<std::string>* skipped_resource_urls_;
 
   DISALLOW_COPY_AND_ASSIGN(MHTMLPartsGenerationDelegate);
 };
+
+// An input event that is held back on the main thread until the screenshot
+// of its snapshot has been captured, or that is queued behind such an event.
+// Other input IPCs queued behind one only have |message| set.
+struct RenderWidget::HeldInputEvent {
+  scoped_ptr<IPC::Message> message;
+  ScopedWebInputEvent input_event;
+  ui::LatencyInfo latency_info;
+  MHTML_Params mhtml_params;
+  bool dom_snapshot_taken;
+  bool timed_out;
+  base::TimeTicks held_since;
+};
+
+namespace {
+
+// Input IPCs other than input events, which have to wait behind held input
+// events. The snapshot pipeline's own messages and acks are not input.
+bool IsHeldBehindInputEvents(const IPC::Message& message) {
+  if (IPC_MESSAGE_ID_CLASS(message.type()) != InputMsgStart)
+    return false;
+  switch (message.type()) {
+    case InputMsg_HandleInputEvent::ID:
+    case InputMsg_ScreenshotCaptured::ID:
+    case InputMsg_AttachForensicLog::ID:
+    case InputMsg_SetIPCMessageStats::ID:
+    case InputMsg_DumpIPCMessageStats::ID:
+    case InputMsg_SnapshotResourceStoreFailed::ID:
+    case InputMsg_ImeEventAck::ID:
+    case InputMsg_SyntheticGestureCompleted::ID:
+      return false;
+    default:
+      return true;
+  }
+}
+
+// Snapshot events carry their full event ID; for the others
+// tools/chromepic/journal_to_text.py fills the site ID in from the browser's
+// records of the same trace ID.
+JournalEntry CreateJournalEntry(JournalStage stage,
+                                const ui::LatencyInfo& latency_info,
+                                const MHTML_Params& mhtml_params) {
+  JournalEntry entry(stage);
+  entry.trace_id = latency_info.trace_id();
+  entry.url_id = mhtml_params.url_id;
+  if (mhtml_params.screenshot_active || mhtml_params.dom_snapshot_active) {
+    SetJournalEventId(mhtml_params.event_id, &entry);
+    entry.snapshot_id = mhtml_params.snapshot_id;
+  }
+  return entry;
+}
+
+// Trace flow flags for an event that may belong to a snapshot.
+unsigned int ForensicFlowFlags(const MHTML_Params& mhtml_params) {
+  if (!mhtml_params.screenshot_active && !mhtml_params.dom_snapshot_active)
+    return TRACE_EVENT_FLAG_NONE;
+  return TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT;
+}
+
+}  // namespace
 //ChromePic
 
 // RenderWidget::ScreenMetricsEmulator ----------------------------------------
@@ -551,7 +629,8 @@ RenderWidget::RenderWidget(CompositorDependencies* compositor_deps,
       popup_origin_scale_for_emulation_(0.f),
       frame_swap_message_queue_(new FrameSwapMessageQueue()),
       resizing_mode_selector_(new ResizingModeSelector()),
-      has_host_context_menu_location_(false) {
+      has_host_context_menu_location_(false),
+      replaying_held_message_(false) {
   if (!swapped_out)
     RenderProcess::current()->AddRefProcess();
   DCHECK(RenderThread::Get());
@@ -759,9 +838,18 @@ void RenderWidget::OnShowHostContextMenu(ContextMenuParams* params) {
 }
 
 bool RenderWidget::OnMessageReceived(const IPC::Message& message) {
+  //ChromePic
+  if (HoldInputMessage(message))
+    return true;
+  //ChromePic
   bool handled = true;
   IPC_BEGIN_MESSAGE_MAP(RenderWidget, message)
     IPC_MESSAGE_HANDLER(InputMsg_HandleInputEvent, OnHandleInputEvent)
+    //ChromePic
+    IPC_MESSAGE_HANDLER(InputMsg_ScreenshotCaptured, OnScreenshotCaptured)
+    IPC_MESSAGE_HANDLER(InputMsg_SnapshotResourceStoreFailed,
+                        OnSnapshotResourceStoreFailed)
+    //ChromePic
     IPC_MESSAGE_HANDLER(InputMsg_CursorVisibilityChange,
                         OnCursorVisibilityChange)
     IPC_MESSAGE_HANDLER(InputMsg_ImeSetComposition, OnImeSetComposition)
@@ -1150,111 +1238,325 @@ void RenderWidget::OnSwapBuffersComplete() {
 void RenderWidget::OnHandleInputEvent(const blink::WebInputEvent* input_event,
                                       const ui::LatencyInfo& latency_info,
                                       MHTML_Params mhtml_params) {
-//ChromePic
- std::stringstream log_stream;
- if (mhtml_params.dom_snapshot_active) {
-      //log_stream << "Received an input event, Thread ID: " << base::PlatformThread::CurrentId() << " # Notifications of screenshots: " << ScreenshotStatus::GetInstance()->captured_screenshots.size();
-      log_stream << "DEBUG RenderWidget::Begin DOM Snapshot,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
-      Logger::LogLineScreen(log_stream.str(), true);
-      log_stream.str("");
+  TRACE_EVENT_WITH_FLOW1("forensics", "RenderWidget::OnHandleInputEvent",
+                         base::debug::ForensicFlowId(mhtml_params.event_id,
+                                                     mhtml_params.snapshot_id),
+                         ForensicFlowFlags(mhtml_params),
+                         "snapshot_id", mhtml_params.snapshot_id);
+  JournalEntry journal_entry = CreateJournalEntry(
+      JOURNAL_STAGE_RENDERER_INPUT_RECEIVED, latency_info, mhtml_params);
+  if (input_event)
+    journal_entry.event_type = input_event->type;
+  EventJournal::Record(&journal_entry);
+
+  // Preserve the input order: if anything is already held, this event has to
+  // wait behind it, including its DOM snapshot.
+  if (!held_input_events_.empty()) {
+    HoldInputEvent(input_event, latency_info, mhtml_params, false);
+    return;
+  }
 
-      log_stream << "Begin DOM Snapshot" << ", Event ID: " <<  mhtml_params.event_id;
-      //log_stream << "Received an input event, Thread ID: " << base::PlatformThread::CurrentId();
-      Logger::LogLineScreen(log_stream.str(), true);
-      log_stream.str("");
-      int route_id = routing_id();
-      //route_id = 2;
-      blink::WebLocalFrame* web_frame = RenderView::FromRoutingID(route_id)->GetWebView()->mainFrame()->toWebLocalFrame();
-      if(!web_frame){
-          log_stream << "Did not get web frame via RenderView,  route_id:" << route_id;
-          Logger::LogLineScreen(log_stream.str(), true);
-          log_stream.str("");
-      }
+  if (mhtml_params.dom_snapshot_active)
+    TakeDOMSnapshot(mhtml_params);
 
-      // Unpack IPC payload.
-      base::File file = IPC::PlatformFileForTransitToFile(mhtml_params.destination_file);
-      const WebString mhtml_boundary =
-          WebString::fromUTF8(mhtml_params.mhtml_boundary_marker);
-      DCHECK(!mhtml_boundary.isEmpty());
-
-      WebData data;
-      //bool success = true;
-      std::set<std::string> digests_of_uris_of_serialized_resources;
-      FrameMsg_SerializeAsMHTML_Params params;
-      //mhtml_params
-      MHTMLPartsGenerationDelegate delegate(
-          params, &digests_of_uris_of_serialized_resources);
-
-      ///*   
-      // Generate MHTML header if needed.
-      data = WebFrameSerializer::generateMHTMLHeader(mhtml_boundary, web_frame);
-
-      //log_stream << "Experimental: Got header";
-      //Logger::LogLineScreen(log_stream.str(), true);
-      //log_stream.str("");
-      log_stream << "Start write a part of DOM to the file, Event ID: " <<  mhtml_params.event_id;
-      Logger::LogLineScreen(log_stream.str(), true);
-      log_stream.str("");
-      int bytes_written = file.WriteAtCurrentPos(data.data(), data.size());
-      log_stream << "Wrote a part of DOM to the file: " << bytes_written << ", Event ID: " <<  mhtml_params.event_id;
-      Logger::LogLineScreen(log_stream.str(), true);
-      log_stream.str("");
+  if (mhtml_params.screenshot_active &&
+      !IsScreenshotCaptured(mhtml_params.snapshot_id)) {
+    HoldInputEvent(input_event, latency_info, mhtml_params, true);
+    return;
+  }
+  DispatchInputEvent(input_event, latency_info, mhtml_params);
+}
 
-      if (bytes_written < 0) {
-        log_stream << "It is not main frame";
-        Logger::LogLineScreen(log_stream.str(), true);
-        log_stream.str("");
-      }
+void RenderWidget::TakeDOMSnapshot(const MHTML_Params& mhtml_params) {
+  TRACE_EVENT_WITH_FLOW1("forensics", "RenderWidget::TakeDOMSnapshot",
+                         base::debug::ForensicFlowId(mhtml_params.event_id,
+                                                     mhtml_params.snapshot_id),
+                         TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+                         "snapshot_id", mhtml_params.snapshot_id);
+  FORENSIC_LOG(DEBUG) << "DEBUG RenderWidget::Begin DOM Snapshot,\t Process ID: " << base::GetUniqueIdForProcess() << ", Thread ID: " << base::PlatformThread::CurrentId();
 
-      //log_stream << "Experimental: wrote header";
-      //Logger::LogLineScreen(log_stream.str(), true);
-      //log_stream.str("");
-      
-      // Generate MHTML parts.
-      std::vector<WebData> data_vector = WebFrameSerializer::generateMHTMLPartsForAllFrames(
-                                                  mhtml_boundary, web_frame, 
-                                                  true,      //Use Binary Encoding?
-                                                  &delegate);
-
-      //log_stream << "Experimental: got all parts of the MHTML file";
-      //Logger::LogLineScreen(log_stream.str(), true);
-      //log_stream.str("");
-
-      for(std::vector<WebData>::iterator it = data_vector.begin(); it != data_vector.end(); ++it) {
-        log_stream << "Start write a part of DOM to the file, Event ID: " <<  mhtml_params.event_id;
-        Logger::LogLineScreen(log_stream.str(), true);
-        log_stream.str("");
-        bytes_written = file.WriteAtCurrentPos((*it).data(), (*it).size());
-        log_stream << "Wrote a part of DOM to the file: " << bytes_written << ", Event ID: " <<  mhtml_params.event_id;
-        Logger::LogLineScreen(log_stream.str(), true);
-        log_stream.str("");
-     }
-  log_stream << "DOM Snapshot captured" << ", Event ID: " <<  mhtml_params.event_id;
+  std::stringstream log_stream;
+  log_stream << "Begin DOM Snapshot" << ", Event ID: " <<  mhtml_params.event_id;
   Logger::LogLineScreen(log_stream.str(), true);
   log_stream.str("");
+  int route_id = routing_id();
+  RenderView* render_view = RenderView::FromRoutingID(route_id);
+  blink::WebFrame* main_frame = render_view && render_view->GetWebView()
+      ? render_view->GetWebView()->mainFrame() : nullptr;
+  blink::WebLocalFrame* web_frame = main_frame && main_frame->isWebLocalFrame()
+      ? main_frame->toWebLocalFrame() : nullptr;
+  if(!web_frame){
+      log_stream << "Did not get web frame via RenderView,  route_id:" << route_id;
+      Logger::LogLineScreen(log_stream.str(), true);
+      // Close the snapshot file and let the browser stop tracking the
+      // snapshot instead of waiting for it.
+      IPC::PlatformFileForTransitToFile(mhtml_params.destination_file);
+      Send(new InputHostMsg_DOMSnapshotCaptured(
+          route_id, mhtml_params.snapshot_id, -1));
+      return;
+  }
+
+  // Unpack IPC payload.
+  scoped_ptr<DOMSnapshotJob> job(new DOMSnapshotJob);
+  job->file = IPC::PlatformFileForTransitToFile(mhtml_params.destination_file);
+  job->boundary = mhtml_params.mhtml_boundary_marker;
+  job->snapshot_id = mhtml_params.snapshot_id;
+  job->event_id = mhtml_params.event_id;
+  job->use_resource_store = mhtml_params.dom_snapshot_resource_store;
+  job->routing_id = routing_id();
+  if (RenderThreadImpl::current())
+    job->sender = RenderThreadImpl::current()->thread_safe_sender();
+  const WebString mhtml_boundary =
+      WebString::fromUTF8(mhtml_params.mhtml_boundary_marker);
+  DCHECK(!mhtml_boundary.isEmpty());
+
+  // In delta mode the first snapshot of a page becomes the base that later
+  // snapshots of the same url_id are diffed against.
+  if (mhtml_params.dom_snapshot_delta) {
+    if (!dom_snapshot_baseline_ ||
+        dom_snapshot_baseline_->url_id != mhtml_params.url_id) {
+      dom_snapshot_baseline_ = new DOMSnapshotBaseline(mhtml_params.url_id,
+                                                       mhtml_params.snapshot_id);
+      job->is_base = true;
+    }
+    job->baseline = dom_snapshot_baseline_;
+  }
+
+  std::set<std::string> digests_of_uris_of_serialized_resources;
+  FrameMsg_SerializeAsMHTML_Params params;
+  MHTMLPartsGenerationDelegate delegate(
+      params, &digests_of_uris_of_serialized_resources,
+      job->baseline && !job->is_base ? &job->baseline->resource_urls : nullptr,
+      &job->skipped_resource_urls);
+
+  // Main thread phase: copy out the header and the serialized frames and
+  // resources. Nothing below this point looks at the DOM, so the input event
+  // can be released as soon as this returns.
+  base::TimeTicks copy_start = base::TimeTicks::Now();
+  WebData header = WebFrameSerializer::generateMHTMLHeader(mhtml_boundary, web_frame);
+  job->header.assign(header.data(), header.size());
+  job->resources = WebFrameSerializer::serializeAllFramesForMHTML(web_frame, &delegate);
+  job->copy_finished = base::TimeTicks::Now();
+  JournalEntry journal_entry = CreateJournalEntry(
+      JOURNAL_STAGE_DOM_SNAPSHOT_COPIED, ui::LatencyInfo(), mhtml_params);
+  journal_entry.arg0 =
+      static_cast<int32_t>((job->copy_finished - copy_start).InMicroseconds());
+  EventJournal::Record(&journal_entry);
+  if (job->is_base) {
+    for (const WebFrameSerializer::MHTMLResource& resource : job->resources) {
+      if (!resource.url.empty())
+        job->baseline->resource_urls.insert(resource.url);
+    }
   }
+
+  log_stream << "DOM Snapshot copied, # Parts: " << job->resources.size()
+             << ", Event ID: " <<  mhtml_params.event_id;
+  Logger::LogLineScreen(log_stream.str(), true);
+  log_stream.str("");
+
+  // MIME encoding and file writes happen on the renderer FILE thread.
+  RenderThreadImpl* render_thread = RenderThreadImpl::current();
+  if (!render_thread) {
+    WriteDOMSnapshot(std::move(job));
+    return;
+  }
+  render_thread->GetFileThreadMessageLoopProxy()->PostTask(
+      FROM_HERE, base::Bind(&WriteDOMSnapshot, base::Passed(&job)));
+}
+
+bool RenderWidget::IsScreenshotCaptured(int snapshot_id) {
+  base::AutoLock locked(ScreenshotStatus::GetInstance()->ss_lock);
+  return ScreenshotStatus::GetInstance()->captured_screenshots.count(
+      snapshot_id) != 0;
+}
+
+void RenderWidget::HoldInputEvent(const blink::WebInputEvent* input_event,
+                                  const ui::LatencyInfo& latency_info,
+                                  const MHTML_Params& mhtml_params,
+                                  bool dom_snapshot_taken) {
+  scoped_ptr<HeldInputEvent> held_event(new HeldInputEvent);
+  if (input_event)
+    held_event->input_event = WebInputEventTraits::Clone(*input_event);
+  held_event->latency_info = latency_info;
+  held_event->mhtml_params = mhtml_params;
+  held_event->dom_snapshot_taken = dom_snapshot_taken;
+  held_event->timed_out = false;
+  held_event->held_since = base::TimeTicks::Now();
+  held_input_events_.push_back(std::move(held_event));
+  // The gate: how long the event waits for its screenshot.
+  TRACE_EVENT_ASYNC_BEGIN1("forensics", "RenderWidget::HeldInputEvent",
+                           base::debug::ForensicFlowId(mhtml_params.event_id,
+                                                       mhtml_params.snapshot_id),
+                           "snapshot_id", mhtml_params.snapshot_id);
+
+  JournalEntry journal_entry = CreateJournalEntry(
+      JOURNAL_STAGE_RENDERER_INPUT_HELD, latency_info, mhtml_params);
+  if (input_event)
+    journal_entry.event_type = input_event->type;
+  EventJournal::Record(&journal_entry);
+
+  std::stringstream log_stream;
+  log_stream << "Holding input event until screenshot is captured, # Held: "
+             << held_input_events_.size() << ", Event ID: " << mhtml_params.event_id;
+  Logger::LogLineScreen(log_stream.str(), true);
+
+  if (held_input_events_.size() == 1)
+    StartScreenshotWaitTimer(mhtml_params);
+}
+
+void RenderWidget::StartScreenshotWaitTimer(const MHTML_Params& mhtml_params) {
+  if (!mhtml_params.screenshot_active ||
+      mhtml_params.screenshot_wait_timeout_ms <= 0)
+    return;
+  screenshot_wait_timer_.Start(
+      FROM_HERE,
+      base::TimeDelta::FromMilliseconds(mhtml_params.screenshot_wait_timeout_ms),
+      this, &RenderWidget::OnScreenshotWaitTimeout);
+}
+
+void RenderWidget::OnScreenshotCaptured(int snapshot_id,
+                                        const base::debug::SnapshotToken& event_id,
+                                        bool optimized) {
+  // InputEventFilter has already recorded |snapshot_id| in ScreenshotStatus on
+  // the compositor thread; all that is left is to resume dispatch.
+  DispatchHeldInputEvents();
+}
+
+void RenderWidget::OnSnapshotResourceStoreFailed(const std::string& digest) {
+  RenderThreadImpl* render_thread = RenderThreadImpl::current();
+  if (!render_thread) {
+    ForgetStoredSnapshotResource(digest);
+    return;
+  }
+  render_thread->GetFileThreadMessageLoopProxy()->PostTask(
+      FROM_HERE, base::Bind(&ForgetStoredSnapshotResource, digest));
+}
+
+void RenderWidget::OnScreenshotWaitTimeout() {
+  if (held_input_events_.empty())
+    return;
+  HeldInputEvent* held_event = held_input_events_.front().get();
+  held_event->timed_out = true;
+  {
+    // Dispatch erases the status entry; a screenshot that is still on its
+    // way must not add it back.
+    base::AutoLock locked(ScreenshotStatus::GetInstance()->ss_lock);
+    if (!ScreenshotStatus::GetInstance()->captured_screenshots.count(
+            held_event->mhtml_params.snapshot_id))
+      ScreenshotStatus::GetInstance()->abandoned_screenshots.insert(
+          held_event->mhtml_params.snapshot_id);
+  }
+
+  std::stringstream log_stream;
+  log_stream << "Timed out waiting for screenshot, Snapshot ID: "
+             << held_event->mhtml_params.snapshot_id
+             << ", Event ID: " << held_event->mhtml_params.event_id;
+  Logger::LogLineScreen(log_stream.str(), true);
+  DispatchHeldInputEvents();
+}
+
+void RenderWidget::DispatchHeldInputEvents() {
+  while (!held_input_events_.empty()) {
+    HeldInputEvent* held_event = held_input_events_.front().get();
+    const MHTML_Params& mhtml_params = held_event->mhtml_params;
+
+    if (!held_event->dom_snapshot_taken) {
+      if (mhtml_params.dom_snapshot_active)
+        TakeDOMSnapshot(mhtml_params);
+      held_event->dom_snapshot_taken = true;
+    }
+
+    if (mhtml_params.screenshot_active && !held_event->timed_out &&
+        !IsScreenshotCaptured(mhtml_params.snapshot_id)) {
+      if (!screenshot_wait_timer_.IsRunning())
+        StartScreenshotWaitTimer(mhtml_params);
+      return;
+    }
+    screenshot_wait_timer_.Stop();
+
+    if (held_event->message) {
+      scoped_ptr<HeldInputEvent> released = std::move(held_input_events_.front());
+      held_input_events_.pop_front();
+      ReplayHeldMessage(*released->message);
+      continue;
+    }
+
+    int64_t hold_us =
+        (base::TimeTicks::Now() - held_event->held_since).InMicroseconds();
+    std::stringstream log_stream;
+    log_stream << "Released held input event, Hold time (us): " << hold_us
+               << ", Event ID: " << mhtml_params.event_id;
+    Logger::LogLineScreen(log_stream.str(), true);
+    TRACE_EVENT_ASYNC_END1("forensics", "RenderWidget::HeldInputEvent",
+                           base::debug::ForensicFlowId(mhtml_params.event_id,
+                                                       mhtml_params.snapshot_id),
+                           "timed_out", held_event->timed_out);
+    JournalEntry journal_entry = CreateJournalEntry(
+        JOURNAL_STAGE_RENDERER_INPUT_RELEASED, held_event->latency_info,
+        mhtml_params);
+    if (held_event->input_event)
+      journal_entry.event_type = held_event->input_event->type;
+    journal_entry.arg0 = static_cast<int32_t>(hold_us);
+    journal_entry.arg1 = held_event->timed_out;
+    EventJournal::Record(&journal_entry);
+
+    scoped_ptr<HeldInputEvent> released = std::move(held_input_events_.front());
+    held_input_events_.pop_front();
+    DispatchInputEvent(released->input_event.get(), released->latency_info,
+                       released->mhtml_params);
+  }
+}
+
+bool RenderWidget::HoldInputMessage(const IPC::Message& message) {
+  if (held_input_events_.empty() || replaying_held_message_ ||
+      !IsHeldBehindInputEvents(message))
+    return false;
+  scoped_ptr<HeldInputEvent> held_message(new HeldInputEvent);
+  held_message->message.reset(new IPC::Message(message));
+  held_message->dom_snapshot_taken = true;
+  held_message->timed_out = false;
+  held_message->held_since = base::TimeTicks::Now();
+  held_input_events_.push_back(std::move(held_message));
+  return true;
+}
+
+void RenderWidget::ReplayHeldMessage(const IPC::Message& message) {
+  base::AutoReset<bool> replaying(&replaying_held_message_, true);
+  if (message.routing_id() == routing_id_) {
+    OnMessageReceived(message);
+    return;
+  }
+  // Edit and selection commands go to a frame, which may be gone by now.
+  RenderFrameImpl* render_frame =
+      RenderFrameImpl::FromRoutingID(message.routing_id());
+  if (render_frame)
+    render_frame->OnMessageReceived(message);
+}
+
+void RenderWidget::DispatchInputEvent(const blink::WebInputEvent* input_event,
+                                      const ui::LatencyInfo& latency_info,
+                                      const MHTML_Params& mhtml_params) {
+  // The screenshot notification is consumed; keep ScreenshotStatus from
+  // growing for the lifetime of the renderer.
   if (mhtml_params.screenshot_active) {
-  int i = 0;
-  int count=0;
-   while(count == 0) {
-       i += 1;
-       ScreenshotStatus::GetInstance()->ss_lock.Acquire();
-       count = ScreenshotStatus::GetInstance()->captured_screenshots.count(mhtml_params.snapshot_id);
-       ScreenshotStatus::GetInstance()->ss_lock.Release();
-   }
-       
-   log_stream << "Screenshot found # iterations in wait loop: " << i << ", Event ID: " <<  mhtml_params.event_id;
-   Logger::LogLineScreen(log_stream.str(), true);
-   log_stream.str("");
+    base::AutoLock locked(ScreenshotStatus::GetInstance()->ss_lock);
+    ScreenshotStatus::GetInstance()->captured_screenshots.erase(
+        mhtml_params.snapshot_id);
   }
-//ChromePic
   if (!input_event)
     return;
-  log_stream << "Handing input to the input handling code" << ", Event ID: " <<  mhtml_params.event_id;
-  Logger::LogLineScreen(log_stream.str(), true);
-  log_stream.str("");
+  TRACE_EVENT_WITH_FLOW1("forensics", "RenderWidget::DispatchInputEvent",
+                         base::debug::ForensicFlowId(mhtml_params.event_id,
+                                                     mhtml_params.snapshot_id),
+                         ForensicFlowFlags(mhtml_params) & TRACE_EVENT_FLAG_FLOW_IN,
+                         "snapshot_id", mhtml_params.snapshot_id);
+  JournalEntry journal_entry = CreateJournalEntry(
+      JOURNAL_STAGE_RENDERER_DISPATCH, latency_info, mhtml_params);
+  journal_entry.event_type = input_event->type;
+  EventJournal::Record(&journal_entry);
   input_handler_->HandleInputEvent(*input_event, latency_info);
 }
+//ChromePic
 
 void RenderWidget::OnCursorVisibilityChange(bool is_visible) {
   if (webwidget_)
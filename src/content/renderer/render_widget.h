@@ -18,6 +18,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/observer_list.h"
 #include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "build/build_config.h"
 #include "content/common/content_export.h"
 #include "content/common/cursors/webcursor.h"
@@ -49,6 +50,10 @@
 #include "ui/gfx/range/range.h"
 #include "ui/surface/transport_dib.h"
 
+//ChromePic
+#include "base/debug/snapshot_token.h"
+//ChromePic
+
 struct ViewMsg_Resize_Params;
 //ChromePic
 struct MHTML_Params;
@@ -92,6 +97,7 @@ class RenderWidgetCompositor;
 class ResizingModeSelector;
 struct ContextMenuParams;
 struct DidOverscrollParams;
+struct DOMSnapshotBaseline;
 struct WebPluginGeometry;
 
 // RenderWidget provides a communication bridge between a WebWidget and
@@ -345,6 +351,14 @@ class CONTENT_EXPORT RenderWidget
 
   bool host_closing() const { return host_closing_; }
 
+  //ChromePic
+  // Queues an input IPC that arrives while input events are held for their
+  // screenshots, so that it is handled after them and input keeps its order.
+  // Returns false, and leaves |message| to the caller, if nothing is held or
+  // |message| is not input.
+  bool HoldInputMessage(const IPC::Message& message);
+  //ChromePic
+
  protected:
   // Friend RefCounted so that the dtor can be non-public. Using this class
   // without ref-counting is an error.
@@ -422,6 +436,10 @@ class CONTENT_EXPORT RenderWidget
   void OnHandleInputEvent(const blink::WebInputEvent* event,
                           const ui::LatencyInfo& latency_info,
                           MHTML_Params mhtml_params);
+  void OnScreenshotCaptured(int snapshot_id,
+                            const base::debug::SnapshotToken& event_id,
+                            bool optimized);
+  void OnSnapshotResourceStoreFailed(const std::string& digest);
   //ChromePic
   void OnCursorVisibilityChange(bool is_visible);
   void OnMouseCaptureLost();
@@ -761,6 +779,39 @@ class CONTENT_EXPORT RenderWidget
   scoped_ptr<scheduler::RenderWidgetSchedulingState>
       render_widget_scheduling_state_;
 
+  //ChromePic
+  struct HeldInputEvent;
+
+  // Serializes the DOM of the main frame into |mhtml_params.destination_file|.
+  void TakeDOMSnapshot(const MHTML_Params& mhtml_params);
+  bool IsScreenshotCaptured(int snapshot_id);
+  // Queues the input event instead of blocking the main thread until the
+  // browser reports that the screenshot for its snapshot has been captured.
+  void HoldInputEvent(const blink::WebInputEvent* input_event,
+                      const ui::LatencyInfo& latency_info,
+                      const MHTML_Params& mhtml_params,
+                      bool dom_snapshot_taken);
+  void StartScreenshotWaitTimer(const MHTML_Params& mhtml_params);
+  void OnScreenshotWaitTimeout();
+  // Dispatches held input events in order until one is still waiting.
+  void DispatchHeldInputEvents();
+  void DispatchInputEvent(const blink::WebInputEvent* input_event,
+                          const ui::LatencyInfo& latency_info,
+                          const MHTML_Params& mhtml_params);
+  // Hands a message queued by HoldInputMessage() to the widget or frame it
+  // was routed to.
+  void ReplayHeldMessage(const IPC::Message& message);
+
+  // Input events held back on the main thread, in arrival order.
+  std::deque<scoped_ptr<HeldInputEvent>> held_input_events_;
+  // Releases the head of |held_input_events_| if its screenshot never arrives.
+  base::OneShotTimer screenshot_wait_timer_;
+  // Set while ReplayHeldMessage() runs, so the message is not queued again.
+  bool replaying_held_message_;
+  // Base of the delta DOM snapshots of the current page.
+  scoped_refptr<DOMSnapshotBaseline> dom_snapshot_baseline_;
+  //ChromePic
+
   DISALLOW_COPY_AND_ASSIGN(RenderWidget);
 };
 
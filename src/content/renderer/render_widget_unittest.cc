@@ -4,12 +4,20 @@
 
 #include "content/renderer/render_widget.h"
 
+#include <string>
 #include <vector>
 
+#include "base/debug/snapshot_token.h"
+#include "base/location.h"
 #include "base/macros.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/thread_task_runner_handle.h"
+#include "base/time/time.h"
 #include "content/common/input/synthetic_web_input_event_builders.h"
 #include "content/common/input_messages.h"
 #include "content/public/test/mock_render_thread.h"
+#include "content/renderer/input/screenshot_status.h"
 #include "content/test/fake_compositor_dependencies.h"
 #include "content/test/mock_render_process.h"
 #include "ipc/ipc_test_sink.h"
@@ -44,6 +52,24 @@ class InteractiveRenderWidget : public RenderWidget {
     //ChromePic
   }
 
+  //ChromePic
+  // Sends |event| as the event of a snapshot whose screenshot has to be
+  // captured before the event is dispatched.
+  void SendHeldInputEvent(const blink::WebInputEvent& event,
+                          int snapshot_id,
+                          int screenshot_wait_timeout_ms) {
+    MHTML_Params mhtml_params;
+    mhtml_params.screenshot_active = true;
+    mhtml_params.snapshot_id = snapshot_id;
+    mhtml_params.screenshot_wait_timeout_ms = screenshot_wait_timeout_ms;
+    OnHandleInputEvent(&event, ui::LatencyInfo(), mhtml_params);
+  }
+
+  // What reached the widget, in order: "ack" for each input event ack and
+  // "focus" for each focus change.
+  const std::vector<std::string>& handled() const { return handled_; }
+  //ChromePic
+
   void set_always_overscroll(bool overscroll) {
     always_overscroll_ = overscroll;
   }
@@ -79,7 +105,18 @@ class InteractiveRenderWidget : public RenderWidget {
     return false;
   }
 
+  //ChromePic
+  void OnSetFocus(bool enable) override {
+    handled_.push_back("focus");
+    RenderWidget::OnSetFocus(enable);
+  }
+  //ChromePic
+
   bool Send(IPC::Message* msg) override {
+    //ChromePic
+    if (msg->type() == InputHostMsg_HandleInputEvent_ACK::ID)
+      handled_.push_back("ack");
+    //ChromePic
     sink_.OnMessageReceived(*msg);
     delete msg;
     return true;
@@ -87,6 +124,7 @@ class InteractiveRenderWidget : public RenderWidget {
 
  private:
   std::vector<gfx::Rect> rects_;
+  std::vector<std::string> handled_;
   IPC::TestSink sink_;
   bool always_overscroll_;
   static int next_routing_id_;
@@ -104,7 +142,38 @@ class RenderWidgetUnittest : public testing::Test {
 
   InteractiveRenderWidget* widget() const { return widget_.get(); }
 
+  //ChromePic
+  // What the compositor thread does when the browser reports a screenshot.
+  void CaptureScreenshot(int snapshot_id) {
+    {
+      base::AutoLock locked(ScreenshotStatus::GetInstance()->ss_lock);
+      ScreenshotStatus::GetInstance()->captured_screenshots.insert(snapshot_id);
+    }
+    widget()->OnMessageReceived(InputMsg_ScreenshotCaptured(
+        widget()->routing_id(), snapshot_id, base::debug::SnapshotToken(),
+        false));
+  }
+
+  bool IsScreenshotAbandoned(int snapshot_id) {
+    base::AutoLock locked(ScreenshotStatus::GetInstance()->ss_lock);
+    return ScreenshotStatus::GetInstance()->abandoned_screenshots.count(
+               snapshot_id) != 0;
+  }
+  //ChromePic
+
+ protected:
+  //ChromePic
+  void TearDown() override {
+    base::AutoLock locked(ScreenshotStatus::GetInstance()->ss_lock);
+    ScreenshotStatus::GetInstance()->captured_screenshots.clear();
+    ScreenshotStatus::GetInstance()->abandoned_screenshots.clear();
+  }
+  //ChromePic
+
  private:
+  //ChromePic
+  base::MessageLoop message_loop_;
+  //ChromePic
   MockRenderProcess render_process_;
   MockRenderThread render_thread_;
   FakeCompositorDependencies compositor_deps_;
@@ -224,4 +293,85 @@ TEST_F(RenderWidgetUnittest, FlingOverscroll) {
   widget()->sink()->ClearMessages();
 }
 
+//ChromePic
+TEST_F(RenderWidgetUnittest, HoldsInputEventUntilScreenshotCaptured) {
+  SyntheticWebTouchEvent touch;
+  touch.PressPoint(10, 10);
+
+  widget()->SendHeldInputEvent(touch, 1, 0);
+  EXPECT_EQ(0u, widget()->sink()->message_count());
+
+  // Events behind a held event wait for it, even when they take no snapshot.
+  widget()->SendInputEvent(touch);
+  EXPECT_EQ(0u, widget()->sink()->message_count());
+
+  // Another snapshot's screenshot releases nothing.
+  CaptureScreenshot(2);
+  EXPECT_EQ(0u, widget()->sink()->message_count());
+
+  CaptureScreenshot(1);
+  ASSERT_EQ(2u, widget()->sink()->message_count());
+  EXPECT_EQ(InputHostMsg_HandleInputEvent_ACK::ID,
+            widget()->sink()->GetMessageAt(0)->type());
+  EXPECT_EQ(InputHostMsg_HandleInputEvent_ACK::ID,
+            widget()->sink()->GetMessageAt(1)->type());
+  widget()->sink()->ClearMessages();
+
+  // Nothing is held any more.
+  widget()->SendInputEvent(touch);
+  EXPECT_EQ(1u, widget()->sink()->message_count());
+  widget()->sink()->ClearMessages();
+}
+
+TEST_F(RenderWidgetUnittest, HoldsInputMessagesBehindHeldInputEvents) {
+  SyntheticWebTouchEvent touch;
+  touch.PressPoint(10, 10);
+
+  widget()->SendHeldInputEvent(touch, 1, 0);
+  EXPECT_TRUE(widget()->OnMessageReceived(
+      InputMsg_SetFocus(widget()->routing_id(), true)));
+  widget()->SendHeldInputEvent(touch, 2, 0);
+  EXPECT_TRUE(widget()->handled().empty());
+
+  CaptureScreenshot(1);
+  ASSERT_EQ(2u, widget()->handled().size());
+  EXPECT_EQ("ack", widget()->handled()[0]);
+  EXPECT_EQ("focus", widget()->handled()[1]);
+
+  CaptureScreenshot(2);
+  ASSERT_EQ(3u, widget()->handled().size());
+  EXPECT_EQ("ack", widget()->handled()[2]);
+
+  // With nothing held, the message is handled right away.
+  widget()->OnMessageReceived(InputMsg_SetFocus(widget()->routing_id(), false));
+  ASSERT_EQ(4u, widget()->handled().size());
+  EXPECT_EQ("focus", widget()->handled()[3]);
+  widget()->sink()->ClearMessages();
+}
+
+TEST_F(RenderWidgetUnittest, ReleasesInputEventWhenScreenshotTimesOut) {
+  SyntheticWebTouchEvent touch;
+  touch.PressPoint(10, 10);
+
+  widget()->SendHeldInputEvent(touch, 1, 1);
+  EXPECT_EQ(0u, widget()->sink()->message_count());
+
+  base::RunLoop run_loop;
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, run_loop.QuitClosure(),
+      base::TimeDelta::FromMilliseconds(20));
+  run_loop.Run();
+
+  ASSERT_EQ(1u, widget()->sink()->message_count());
+  EXPECT_EQ(InputHostMsg_HandleInputEvent_ACK::ID,
+            widget()->sink()->GetMessageAt(0)->type());
+  EXPECT_TRUE(IsScreenshotAbandoned(1));
+  widget()->sink()->ClearMessages();
+
+  // The late screenshot releases nothing a second time.
+  CaptureScreenshot(1);
+  EXPECT_EQ(0u, widget()->sink()->message_count());
+}
+//ChromePic
+
 }  // namespace content
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/process/process_handle.h"
+#include "base/process/process_metrics.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/trace_event_analyzer.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "content/public/test/render_view_test.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "third_party/WebKit/public/platform/WebData.h"
+#include "third_party/WebKit/public/platform/WebString.h"
+#include "third_party/WebKit/public/platform/WebURL.h"
+#include "third_party/WebKit/public/web/WebFrameSerializer.h"
+#include "third_party/WebKit/public/web/WebLocalFrame.h"
+
+using blink::WebData;
+using blink::WebFrameSerializer;
+using blink::WebLocalFrame;
+using blink::WebString;
+
+namespace content {
+
+namespace {
+
+const int kIterations = 10;
+const char kBoundary[] = "----MultipartBoundary--ChromePicDOMSnapshotPerfTest----";
+
+// Trace events of FrameSerializer and WebFrameSerializer, in microseconds.
+const char kMarkupEvent[] = "FrameSerializer::serializeFrame HTML";
+const char kSubresourcesEvent[] =
+    "FrameSerializer::serializeFrame subresources";
+const char kStyleSheetEvent[] = "FrameSerializer::serializeCSSStyleSheet";
+const char kLegacyEncodingEvent[] =
+    "WebFrameSerializer::generateMHTMLParts MIME encoding";
+
+// Like the delegate of RenderWidget::TakeDOMSnapshot without delta or
+// resource store mode: every subresource once per snapshot.
+class SerializeOnceDelegate
+    : public WebFrameSerializer::MHTMLPartsGenerationDelegate {
+ public:
+  SerializeOnceDelegate() {}
+
+  bool shouldSkipResource(const blink::WebURL& url) override {
+    return !serialized_urls_.insert(url.string().utf8()).second;
+  }
+
+  WebString getContentID(const blink::WebFrame& frame) override {
+    return WebString();
+  }
+
+ private:
+  std::set<std::string> serialized_urls_;
+
+  DISALLOW_COPY_AND_ASSIGN(SerializeOnceDelegate);
+};
+
+// Peak resident memory of the process. The kernel's peak is reset before
+// every measurement, so it covers that measurement only.
+class PeakMemoryMeter {
+ public:
+  PeakMemoryMeter() : start_bytes_(0) {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    metrics_.reset(
+        base::ProcessMetrics::CreateProcessMetrics(base::GetCurrentProcessHandle()));
+#endif
+  }
+
+  void Start() {
+    if (!metrics_)
+      return;
+    // "5" resets VmHWM to the current resident size.
+    base::WriteFile(base::FilePath("/proc/self/clear_refs"), "5", 1);
+    start_bytes_ = metrics_->GetWorkingSetSize();
+  }
+
+  // Growth of the peak over the resident size at Start(); false where the
+  // platform cannot tell.
+  bool GetPeakGrowth(size_t* bytes) const {
+    if (!metrics_)
+      return false;
+    size_t peak_bytes = metrics_->GetPeakWorkingSetSize();
+    *bytes = peak_bytes > start_bytes_ ? peak_bytes - start_bytes_ : 0;
+    return true;
+  }
+
+ private:
+  scoped_ptr<base::ProcessMetrics> metrics_;
+  size_t start_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(PeakMemoryMeter);
+};
+
+struct SerializationResult {
+  SerializationResult() : bytes(0), parts(0) {}
+
+  base::TimeDelta total_time;
+  // Main thread half of the split pipeline, and MIME encoding, which
+  // RenderWidget does on the renderer FILE thread.
+  base::TimeDelta copy_time;
+  base::TimeDelta encode_time;
+  size_t bytes;
+  size_t parts;
+};
+
+// What RenderWidget::TakeDOMSnapshot and WriteDOMSnapshot do, minus the file.
+SerializationResult SerializeSplit(WebLocalFrame* frame) {
+  SerializationResult result;
+  base::TimeTicks start = base::TimeTicks::Now();
+  SerializeOnceDelegate delegate;
+  WebData header = WebFrameSerializer::generateMHTMLHeader(
+      WebString::fromUTF8(kBoundary), frame);
+  std::vector<WebFrameSerializer::MHTMLResource> resources =
+      WebFrameSerializer::serializeAllFramesForMHTML(frame, &delegate);
+  base::TimeTicks copy_finished = base::TimeTicks::Now();
+
+  std::string output(header.data(), header.size());
+  for (const WebFrameSerializer::MHTMLResource& resource : resources)
+    WebFrameSerializer::generateMHTMLPart(kBoundary, resource, false, &output);
+  WebData footer =
+      WebFrameSerializer::generateMHTMLFooter(WebString::fromUTF8(kBoundary));
+  output.append(footer.data(), footer.size());
+  base::TimeTicks end = base::TimeTicks::Now();
+
+  result.total_time = end - start;
+  result.copy_time = copy_finished - start;
+  result.encode_time = end - copy_finished;
+  result.bytes = output.size();
+  result.parts = resources.size();
+  return result;
+}
+
+// The original ChromePic snapshot, all of it on the main thread.
+SerializationResult SerializeLegacy(WebLocalFrame* frame) {
+  SerializationResult result;
+  base::TimeTicks start = base::TimeTicks::Now();
+  SerializeOnceDelegate delegate;
+  const WebString boundary = WebString::fromUTF8(kBoundary);
+  WebData header = WebFrameSerializer::generateMHTMLHeader(boundary, frame);
+  std::vector<WebData> parts =
+      WebFrameSerializer::generateMHTMLPartsForAllFrames(boundary, frame,
+                                                         false, &delegate);
+  WebData footer = WebFrameSerializer::generateMHTMLFooter(boundary);
+  result.total_time = base::TimeTicks::Now() - start;
+
+  result.bytes = header.size() + footer.size();
+  for (const WebData& part : parts)
+    result.bytes += part.size();
+  result.parts = parts.size();
+  return result;
+}
+
+double SumDurations(trace_analyzer::TraceAnalyzer* analyzer,
+                    const char* event_name) {
+  trace_analyzer::TraceEventVector events;
+  analyzer->FindEvents(trace_analyzer::Query::EventNameIs(event_name),
+                       &events);
+  double total_us = 0;
+  for (const trace_analyzer::TraceEvent* event : events)
+    total_us += event->duration;
+  return total_us;
+}
+
+bool EarlierEvent(const trace_analyzer::TraceEvent* a,
+                  const trace_analyzer::TraceEvent* b) {
+  return a->timestamp < b->timestamp;
+}
+
+// Like SumDurations() but leaves out events nested in another one of the
+// same name, such as stylesheets serialized for an @import.
+double SumOutermostDurations(trace_analyzer::TraceAnalyzer* analyzer,
+                             const char* event_name) {
+  trace_analyzer::TraceEventVector events;
+  analyzer->FindEvents(trace_analyzer::Query::EventNameIs(event_name),
+                       &events);
+  std::sort(events.begin(), events.end(), &EarlierEvent);
+  std::map<trace_analyzer::TraceEvent::ProcessThreadID, double> outer_end;
+  double total_us = 0;
+  for (const trace_analyzer::TraceEvent* event : events) {
+    auto end = outer_end.find(event->thread);
+    if (end != outer_end.end() && event->timestamp < end->second)
+      continue;
+    outer_end[event->thread] = event->timestamp + event->duration;
+    total_us += event->duration;
+  }
+  return total_us;
+}
+
+void PrintValue(const std::string& measurement, const std::string& trace,
+                double value, const std::string& units) {
+  perf_test::PrintResult(measurement, "", trace,
+                         base::StringPrintf("%.3f", value), units, true);
+}
+
+// Documents are built as strings so that their size is easy to scale.
+
+// About |element_count| elements: divs holding a span, a link and text.
+std::string CreateLargeDOM(int element_count) {
+  std::string html = "<html><head><title>Large DOM</title></head><body>";
+  for (int i = 0; i < element_count / 3; ++i) {
+    html += base::StringPrintf(
+        "<div class=\"row r%d\"><span id=\"s%d\">Item %d</span> "
+        "<a href=\"https://example.com/item/%d\">details</a></div>",
+        i % 7, i, i, i);
+  }
+  return html + "</body></html>";
+}
+
+// |frame_count| srcdoc iframes of |elements_per_frame| elements each.
+std::string CreateManyIframes(int frame_count, int elements_per_frame) {
+  std::string html = "<html><head><title>Many iframes</title></head><body>";
+  for (int i = 0; i < frame_count; ++i) {
+    html += "<iframe srcdoc=\"<p>Frame</p>";
+    for (int j = 0; j < elements_per_frame; ++j)
+      html += base::StringPrintf("<div class='f%d'>Cell %d</div>", i, j);
+    html += "\"></iframe>";
+  }
+  return html + "</body></html>";
+}
+
+// A stylesheet of |rule_count| rules with media queries and inline styles on
+// |styled_element_count| elements; all of it is walked for resources.
+std::string CreateHeavyCSS(int rule_count, int styled_element_count) {
+  std::string html = "<html><head><title>Heavy CSS</title><style>";
+  for (int i = 0; i < rule_count; ++i) {
+    html += base::StringPrintf(
+        ".c%d > span:hover { color: #%06x; margin: %dpx %dpx; "
+        "border: 1px solid rgb(%d, %d, %d); }\n",
+        i, i * 2654435761u % 0xffffff, i % 13, i % 17, i % 256,
+        (i * 3) % 256, (i * 7) % 256);
+    if (i % 50 == 49) {
+      html += base::StringPrintf(
+          "@media (max-width: %dpx) { .c%d { display: none; } }\n",
+          400 + i, i);
+    }
+  }
+  html += "</style></head><body>";
+  for (int i = 0; i < styled_element_count; ++i) {
+    html += base::StringPrintf(
+        "<div class=\"c%d\" style=\"padding: %dpx; font-size: %dpx\">"
+        "<span>Styled %d</span></div>",
+        i % rule_count, i % 11, 10 + i % 9, i);
+  }
+  return html + "</body></html>";
+}
+
+// |image_count| images inlined as data: URLs of |image_bytes| each. Data URLs
+// are not subresources, so they are serialized as part of the markup.
+std::string CreateInlineImages(int image_count, int image_bytes) {
+  std::string html = "<html><head><title>Inline images</title></head><body>";
+  // Base64 turns every 3 bytes into 4 characters.
+  std::string payload(image_bytes / 3 * 4, 'A');
+  for (int i = 0; i < image_count; ++i) {
+    payload[i % payload.size()] = 'B';
+    html += "<img width=\"64\" height=\"64\" src=\"data:image/png;base64," +
+            payload + "\">";
+  }
+  return html + "</body></html>";
+}
+
+}  // namespace
+
+class DOMSnapshotPerfTest : public RenderViewTest {
+ protected:
+  // Loads |html|, then reports serialization time, peak memory, output size
+  // and, from one traced run, where the time goes.
+  void RunBenchmark(const std::string& test_name, const std::string& html) {
+    LoadHTML(html.c_str());
+    // Let srcdoc frames finish loading.
+    ProcessPendingMessages();
+    WebLocalFrame* frame = GetMainFrame();
+
+    // Warm-up.
+    SerializeSplit(frame);
+    SerializeLegacy(frame);
+
+    PeakMemoryMeter memory_meter;
+    size_t peak_bytes;
+    SerializationResult split_total;
+    memory_meter.Start();
+    for (int i = 0; i < kIterations; ++i) {
+      SerializationResult result = SerializeSplit(frame);
+      split_total.total_time += result.total_time;
+      split_total.copy_time += result.copy_time;
+      split_total.encode_time += result.encode_time;
+      split_total.bytes = result.bytes;
+      split_total.parts = result.parts;
+    }
+    if (memory_meter.GetPeakGrowth(&peak_bytes))
+      PrintValue("peak_memory", test_name + ".split", peak_bytes / 1024.0, "KB");
+
+    SerializationResult legacy_total;
+    memory_meter.Start();
+    for (int i = 0; i < kIterations; ++i) {
+      SerializationResult result = SerializeLegacy(frame);
+      legacy_total.total_time += result.total_time;
+      legacy_total.bytes = result.bytes;
+      legacy_total.parts = result.parts;
+    }
+    if (memory_meter.GetPeakGrowth(&peak_bytes))
+      PrintValue("peak_memory", test_name + ".legacy", peak_bytes / 1024.0, "KB");
+
+    PrintValue("serialization_time", test_name + ".split",
+               split_total.total_time.InMillisecondsF() / kIterations, "ms");
+    PrintValue("main_thread_time", test_name + ".split",
+               split_total.copy_time.InMillisecondsF() / kIterations, "ms");
+    PrintValue("serialization_time", test_name + ".legacy",
+               legacy_total.total_time.InMillisecondsF() / kIterations, "ms");
+    PrintValue("output_bytes", test_name + ".split",
+               static_cast<double>(split_total.bytes), "bytes");
+    PrintValue("output_bytes", test_name + ".legacy",
+               static_cast<double>(legacy_total.bytes), "bytes");
+    PrintValue("parts", test_name + ".split",
+               static_cast<double>(split_total.parts), "parts");
+
+    // Tracing slows serialization down, so the phases come from separate
+    // runs. Phases are per run; what is left of the main thread time after
+    // markup and subresources is copying the result out of Blink. The
+    // subresources event contains the stylesheet ones, which are reported
+    // on their own.
+    trace_analyzer::Start("page-serialization");
+    SerializationResult split_traced;
+    for (int i = 0; i < kIterations; ++i) {
+      SerializationResult result = SerializeSplit(frame);
+      split_traced.copy_time += result.copy_time;
+      split_traced.encode_time += result.encode_time;
+    }
+    for (int i = 0; i < kIterations; ++i)
+      SerializeLegacy(frame);
+    scoped_ptr<trace_analyzer::TraceAnalyzer> analyzer =
+        trace_analyzer::Stop();
+    ASSERT_TRUE(analyzer.get());
+
+    // The split and legacy runs serialize the same frames.
+    const double runs = 2 * kIterations;
+    const double markup_ms = SumDurations(analyzer.get(), kMarkupEvent) / 1000;
+    const double subresources_ms =
+        SumDurations(analyzer.get(), kSubresourcesEvent) / 1000;
+    const double stylesheet_ms =
+        SumOutermostDurations(analyzer.get(), kStyleSheetEvent) / 1000;
+    PrintValue("phase_markup_accumulation", test_name, markup_ms / runs, "ms");
+    PrintValue("phase_css_resource_retrieval", test_name,
+               (subresources_ms - stylesheet_ms) / runs, "ms");
+    PrintValue("phase_stylesheet_serialization", test_name,
+               stylesheet_ms / runs, "ms");
+    PrintValue("phase_copy_out", test_name + ".split",
+               split_traced.copy_time.InMillisecondsF() / kIterations -
+                   (markup_ms + subresources_ms) / runs,
+               "ms");
+    PrintValue("phase_mime_encoding", test_name + ".split",
+               split_traced.encode_time.InMillisecondsF() / kIterations, "ms");
+    PrintValue("phase_mime_encoding", test_name + ".legacy",
+               SumDurations(analyzer.get(), kLegacyEncodingEvent) / 1000 /
+                   kIterations,
+               "ms");
+  }
+};
+
+TEST_F(DOMSnapshotPerfTest, LargeDOM) {
+  RunBenchmark("LargeDOM_10k", CreateLargeDOM(10000));
+}
+
+TEST_F(DOMSnapshotPerfTest, ManyIframes) {
+  RunBenchmark("ManyIframes_50", CreateManyIframes(50, 100));
+}
+
+TEST_F(DOMSnapshotPerfTest, HeavyCSS) {
+  RunBenchmark("HeavyCSS_5k_rules", CreateHeavyCSS(5000, 2000));
+}
+
+TEST_F(DOMSnapshotPerfTest, InlineImages) {
+  RunBenchmark("InlineImages_4KB", CreateInlineImages(64, 4 * 1024));
+  RunBenchmark("InlineImages_64KB", CreateInlineImages(32, 64 * 1024));
+  RunBenchmark("InlineImages_1MB", CreateInlineImages(8, 1024 * 1024));
+}
+
+}  // namespace content
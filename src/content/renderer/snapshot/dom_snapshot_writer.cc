@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+
+#include "content/renderer/snapshot/dom_snapshot_writer.h"
+
+#include "base/debug/forensic_log.h"
+#include "base/lazy_instance.h"
+#include "base/sha1.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
+#include "content/child/thread_safe_sender.h"
+#include "content/common/input_messages.h"
+#include "crypto/sha2.h"
+
+namespace content {
+
+namespace {
+
+const char kDeltaManifestMimeType[] = "text/x-chromepic-delta-manifest";
+
+// Digests of the subresources this renderer process has already handed to the
+// browser's resource store. Only used on the FILE thread.
+base::LazyInstance<std::set<std::string>>::Leaky g_stored_resource_digests =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Appends |resource| to |output|, either in full or, in resource store mode,
+// as a reference to its digest. Returns the number of body bytes that did not
+// have to be written because the store already has them.
+size_t AppendPart(DOMSnapshotJob* job,
+                  const blink::WebFrameSerializer::MHTMLResource& resource,
+                  std::string* output) {
+  if (!job->use_resource_store || resource.isFrame) {
+    blink::WebFrameSerializer::generateMHTMLPart(job->boundary, resource,
+                                                 true,  // Use Binary Encoding?
+                                                 output);
+    return 0;
+  }
+
+  std::string digest = base::ToLowerASCII(base::HexEncode(
+      crypto::SHA256HashString(
+          std::string(resource.data.begin(), resource.data.end())).data(),
+      crypto::kSHA256Length));
+  blink::WebFrameSerializer::generateMHTMLResourceReference(
+      job->boundary, resource, digest, output);
+  if (!g_stored_resource_digests.Get().insert(digest).second)
+    return resource.data.size();
+  if (job->sender) {
+    job->sender->Send(new InputHostMsg_StoreSnapshotResource(
+        job->routing_id, digest, resource.data));
+  }
+  return 0;
+}
+
+// Parts are matched against the base by their Content-Location. Parts
+// without one (about: frames) are matched by their order among themselves,
+// which skipped subresources do not affect.
+std::string GetPartKey(const blink::WebFrameSerializer::MHTMLResource& resource,
+                       size_t* unnamed_parts) {
+  if (!resource.url.empty())
+    return resource.url;
+  return "#" + base::SizeTToString((*unnamed_parts)++);
+}
+
+std::string GetPartDigest(const blink::WebFrameSerializer::MHTMLResource& resource) {
+  return base::SHA1HashString(
+      std::string(resource.data.begin(), resource.data.end()));
+}
+
+// Encodes a delta snapshot: a header naming the base, a manifest part listing
+// every part of the full snapshot in order (taken from the base or from this
+// file), and the parts that changed. tools/chromepic/reconstruct_dom_snapshot.py
+// replays it into a full MHTML file.
+void EncodeDeltaSnapshot(DOMSnapshotJob* job, std::string* output,
+                         size_t* reused_parts, size_t* deduplicated_bytes) {
+  DOMSnapshotBaseline* baseline = job->baseline.get();
+  std::string manifest;
+  std::string changed_parts;
+  size_t unnamed_parts = 0;
+  for (const blink::WebFrameSerializer::MHTMLResource& resource : job->resources) {
+    std::string key = GetPartKey(resource, &unnamed_parts);
+    auto it = baseline->part_digests.find(key);
+    if (it != baseline->part_digests.end() && it->second == GetPartDigest(resource)) {
+      manifest.append("base\t").append(key).append("\n");
+      (*reused_parts)++;
+      continue;
+    }
+    manifest.append("delta\t").append(key).append("\n");
+    *deduplicated_bytes += AppendPart(job, resource, &changed_parts);
+  }
+  for (const std::string& url : job->skipped_resource_urls) {
+    manifest.append("base\t").append(url).append("\n");
+    (*reused_parts)++;
+  }
+
+  blink::WebFrameSerializer::MHTMLResource manifest_part;
+  manifest_part.mimeType = kDeltaManifestMimeType;
+  manifest_part.data.assign(manifest.begin(), manifest.end());
+
+  output->append("X-ChromePic-Delta-Base: snapshot_")
+      .append(base::IntToString(baseline->snapshot_id))
+      .append(".mhtml\r\n");
+  output->append(job->header);
+  blink::WebFrameSerializer::generateMHTMLPart(job->boundary, manifest_part,
+                                               true, output);
+  output->append(changed_parts);
+}
+
+}  // namespace
+
+DOMSnapshotBaseline::DOMSnapshotBaseline(int url_id, int snapshot_id)
+    : url_id(url_id), snapshot_id(snapshot_id) {
+}
+
+DOMSnapshotBaseline::~DOMSnapshotBaseline() {
+}
+
+DOMSnapshotJob::DOMSnapshotJob()
+    : snapshot_id(-1),
+      is_base(false),
+      use_resource_store(false),
+      routing_id(MSG_ROUTING_NONE) {
+}
+
+DOMSnapshotJob::~DOMSnapshotJob() {
+}
+
+void WriteDOMSnapshot(scoped_ptr<DOMSnapshotJob> job) {
+  // End of the snapshot's flow on the renderer side.
+  TRACE_EVENT_WITH_FLOW1("forensics", "WriteDOMSnapshot",
+                         base::debug::ForensicFlowId(job->event_id,
+                                                     job->snapshot_id),
+                         TRACE_EVENT_FLAG_FLOW_IN, "snapshot_id", job->snapshot_id);
+  base::TimeTicks start = base::TimeTicks::Now();
+
+  // Encode everything first so the file sees one large sequential write
+  // instead of one write per part.
+  std::string output;
+  size_t reused_parts = 0;
+  size_t deduplicated_bytes = 0;
+  if (job->baseline && !job->is_base) {
+    EncodeDeltaSnapshot(job.get(), &output, &reused_parts, &deduplicated_bytes);
+  } else {
+    output.swap(job->header);
+    size_t unnamed_parts = 0;
+    for (const blink::WebFrameSerializer::MHTMLResource& resource : job->resources) {
+      deduplicated_bytes += AppendPart(job.get(), resource, &output);
+      if (job->baseline) {
+        job->baseline->part_digests[GetPartKey(resource, &unnamed_parts)] =
+            GetPartDigest(resource);
+      }
+    }
+  }
+  base::TimeTicks encoded = base::TimeTicks::Now();
+
+  int bytes_written = job->file.WriteAtCurrentPos(output.data(), output.size());
+  if (job->sender) {
+    job->sender->Send(new InputHostMsg_DOMSnapshotCaptured(
+        job->routing_id, job->snapshot_id, bytes_written));
+  }
+  if (bytes_written < 0) {
+    FORENSIC_LOG(SNAPSHOT) << "WriteDOMSnapshot: Failure in writing the DOM snapshot, Event ID: " << job->event_id;
+    return;
+  }
+
+  FORENSIC_LOG(SNAPSHOT) << "DOM Snapshot written: " << bytes_written << " bytes, "
+                         << job->resources.size() << " parts, Reused from base: " << reused_parts
+                         << ", Deduplicated bytes: " << deduplicated_bytes
+                         << ", Queued (us): "
+                         << (start - job->copy_finished).InMicroseconds() << ", Encode (us): "
+                         << (encoded - start).InMicroseconds() << ", Write (us): "
+                         << (base::TimeTicks::Now() - encoded).InMicroseconds()
+                         << ", Event ID: " << job->event_id;
+}
+
+void ForgetStoredSnapshotResource(const std::string& digest) {
+  g_stored_resource_digests.Get().erase(digest);
+}
+
+}  // namespace content
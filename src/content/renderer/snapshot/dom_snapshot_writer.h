@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_RENDERER_SNAPSHOT_DOM_SNAPSHOT_WRITER_H_
+#define CONTENT_RENDERER_SNAPSHOT_DOM_SNAPSHOT_WRITER_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/debug/snapshot_token.h"
+#include "base/files/file.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time/time.h"
+#include "third_party/WebKit/public/web/WebFrameSerializer.h"
+
+namespace content {
+
+class ThreadSafeSender;
+
+typedef std::vector<blink::WebFrameSerializer::MHTMLResource> MHTMLResources;
+
+// The full DOM snapshot that later snapshots of the same page (url_id) are
+// stored as deltas against. |resource_urls| is only used on the main thread,
+// to skip copying subresources the base already holds. |part_digests| is only
+// used on the FILE thread, which always writes the base before its deltas.
+struct DOMSnapshotBaseline
+    : public base::RefCountedThreadSafe<DOMSnapshotBaseline> {
+  DOMSnapshotBaseline(int url_id, int snapshot_id);
+
+  const int url_id;
+  const int snapshot_id;
+  std::set<std::string> resource_urls;
+  std::map<std::string, std::string> part_digests;
+
+ private:
+  friend class base::RefCountedThreadSafe<DOMSnapshotBaseline>;
+  ~DOMSnapshotBaseline();
+};
+
+// Everything the second half of a DOM snapshot needs. It is built on the main
+// thread from a consistent copy of the frame tree and then handed over to the
+// renderer FILE thread, so it must not reference any Blink objects.
+struct DOMSnapshotJob {
+  DOMSnapshotJob();
+  ~DOMSnapshotJob();
+
+  base::File file;
+  std::string boundary;
+  std::string header;
+  MHTMLResources resources;
+  int snapshot_id;
+  base::debug::SnapshotToken event_id;
+  base::TimeTicks copy_finished;
+
+  // Set in delta mode. |is_base| marks the snapshot that becomes |baseline|;
+  // otherwise only the parts that differ from |baseline| are written, and
+  // |skipped_resource_urls| lists subresources that were not even copied
+  // because the base already has them.
+  scoped_refptr<DOMSnapshotBaseline> baseline;
+  bool is_base;
+  std::vector<std::string> skipped_resource_urls;
+
+  // |sender| acknowledges the snapshot to the browser, routed to
+  // |routing_id|. In resource store mode it also delivers the subresources.
+  bool use_resource_store;
+  scoped_refptr<ThreadSafeSender> sender;
+  int routing_id;
+};
+
+// MIME-encodes the resources of |job| and writes the MHTML file. Safe to run
+// on any thread; the input event that triggered the snapshot has already been
+// released by the time this runs.
+void WriteDOMSnapshot(scoped_ptr<DOMSnapshotJob> job);
+
+// Forgets that the subresource |digest| was handed to the browser's resource
+// store, after the browser failed to store it. Runs where WriteDOMSnapshot
+// does.
+void ForgetStoredSnapshotResource(const std::string& digest);
+
+}  // namespace content
+
+#endif  // CONTENT_RENDERER_SNAPSHOT_DOM_SNAPSHOT_WRITER_H_
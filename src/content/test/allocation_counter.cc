@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#include "content/test/allocation_counter.h"
+
+#include <stddef.h>
+
+#include "base/atomicops.h"
+#include "base/threading/platform_thread.h"
+
+#if defined(USE_TCMALLOC)
+#include "third_party/tcmalloc/chromium/src/gperftools/malloc_hook.h"
+#endif
+
+namespace content {
+
+namespace {
+
+// Allocations made on the counting thread while counting is on.
+base::subtle::Atomic32 g_counting_allocations = 0;
+base::subtle::Atomic32 g_allocation_count = 0;
+base::PlatformThreadRef g_counting_thread;
+
+#if defined(USE_TCMALLOC)
+void CountAllocation(const void* ptr, size_t size) {
+  if (base::subtle::NoBarrier_Load(&g_counting_allocations) &&
+      base::PlatformThread::CurrentRef() == g_counting_thread)
+    base::subtle::NoBarrier_AtomicIncrement(&g_allocation_count, 1);
+}
+#endif
+
+}  // namespace
+
+bool StartCountingAllocations() {
+#if defined(USE_TCMALLOC)
+  static bool hook_added = MallocHook::AddNewHook(&CountAllocation);
+  if (!hook_added)
+    return false;
+  g_counting_thread = base::PlatformThread::CurrentRef();
+  base::subtle::NoBarrier_Store(&g_allocation_count, 0);
+  base::subtle::NoBarrier_Store(&g_counting_allocations, 1);
+  return true;
+#else
+  return false;
+#endif
+}
+
+int StopCountingAllocations() {
+  base::subtle::NoBarrier_Store(&g_counting_allocations, 0);
+  return base::subtle::NoBarrier_Load(&g_allocation_count);
+}
+
+}  // namespace content
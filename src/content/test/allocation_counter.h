@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2017 University of Georgia. All rights reserved.
+ *
+ * This file is subject to the terms and conditions defined at
+ * https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+ *
+ */
+
+#ifndef CONTENT_TEST_ALLOCATION_COUNTER_H_
+#define CONTENT_TEST_ALLOCATION_COUNTER_H_
+
+namespace content {
+
+// Counts the allocations the calling thread makes between the two calls, for
+// perftests that check a path does not allocate. Needs tcmalloc's new hook.
+
+// Returns false if allocations cannot be counted with this allocator.
+bool StartCountingAllocations();
+
+// Returns the allocations since StartCountingAllocations().
+int StopCountingAllocations();
+
+}  // namespace content
+
+#endif  // CONTENT_TEST_ALLOCATION_COUNTER_H_
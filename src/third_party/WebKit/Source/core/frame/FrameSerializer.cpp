@@ -60,6 +60,7 @@
 #include "core/style/StyleFetchedImage.h"
 #include "core/style/StyleImage.h"
 #include "platform/SerializedResource.h"
+#include "platform/TraceEvent.h"
 #include "platform/graphics/Image.h"
 #include "platform/heap/Handle.h"
 #include "wtf/HashSet.h"
@@ -264,13 +265,21 @@ void FrameSerializer::serializeFrame(const LocalFrame& frame)
         return;
     }
 
+    //ChromePic
+    // The phases are traced for the DOM snapshot benchmark
+    // (content/renderer/snapshot/dom_snapshot_perftest.cc).
     WillBeHeapVector<RawPtrWillBeMember<Node>> serializedNodes;
-    SerializerMarkupAccumulator accumulator(m_delegate, document, serializedNodes);
-    String text = serializeNodes<EditingStrategy>(accumulator, document, IncludeNode);
+    {
+        TRACE_EVENT0("page-serialization", "FrameSerializer::serializeFrame HTML");
+        SerializerMarkupAccumulator accumulator(m_delegate, document, serializedNodes);
+        String text = serializeNodes<EditingStrategy>(accumulator, document, IncludeNode);
 
-    CString frameHTML = document.encoding().encode(text, WTF::EntitiesForUnencodables);
-    m_resources->append(SerializedResource(url, document.suggestedMIMEType(), SharedBuffer::create(frameHTML.data(), frameHTML.length())));
+        CString frameHTML = document.encoding().encode(text, WTF::EntitiesForUnencodables);
+        m_resources->append(SerializedResource(url, document.suggestedMIMEType(), SharedBuffer::create(frameHTML.data(), frameHTML.length())));
+    }
 
+    TRACE_EVENT0("page-serialization", "FrameSerializer::serializeFrame subresources");
+    //ChromePic
     for (Node* node: serializedNodes) {
         ASSERT(node);
         if (!node->isElementNode())
@@ -311,6 +320,9 @@ void FrameSerializer::serializeFrame(const LocalFrame& frame)
 
 void FrameSerializer::serializeCSSStyleSheet(CSSStyleSheet& styleSheet, const KURL& url)
 {
+    //ChromePic
+    TRACE_EVENT0("page-serialization", "FrameSerializer::serializeCSSStyleSheet");
+    //ChromePic
     StringBuilder cssText;
     cssText.appendLiteral("@charset \"");
     cssText.append(styleSheet.contents()->charset().lower());
@@ -46,8 +46,10 @@
 #include "core/loader/DocumentLoader.h"
 #include "platform/SerializedResource.h"
 #include "platform/SharedBuffer.h"
+#include "platform/TraceEvent.h"
 #include "platform/mhtml/MHTMLArchive.h"
 #include "platform/mhtml/MHTMLParser.h"
+#include "platform/text/QuotedPrintable.h"
 #include "platform/weborigin/KURL.h"
 #include "public/platform/WebCString.h"
 #include "public/platform/WebString.h"
@@ -64,11 +66,11 @@
 #include "wtf/HashSet.h"
 #include "wtf/Noncopyable.h"
 #include "wtf/Vector.h"
+#include "wtf/text/Base64.h"
 #include "wtf/text/StringConcatenate.h"
 
 //ChromePic
-#include "content/browser/renderer_host/snapshot/logger.h"
-using content::Logger;
+#include "base/debug/forensic_log.h"
 //ChromePic
 
 namespace blink {
@@ -179,6 +181,7 @@ WebData generateMHTMLPartsForAFrame(
     serializer.serializeFrame(*frame);
 
     // Encode serializer's output as MHTML.
+    TRACE_EVENT0("page-serialization", "WebFrameSerializer::generateMHTMLParts MIME encoding");
     RefPtr<SharedBuffer> output = SharedBuffer::create();
     //bool isFirstResource = true;
     for (const SerializedResource& resource : resources) {
@@ -209,10 +212,7 @@ std::vector<WebData> WebFrameSerializer::generateMHTMLPartsForAllFrames(
     return_data.push_back(generateMHTMLPartsForAFrame(boundary,
                 frame, useBinaryEncoding, webDelegate));
 
- //std::stringstream log_stream;
-  //log_stream << "Experimental: got data for main frame";
-  //Logger::LogLineScreen(log_stream.str(), true);
-  //log_stream.str("");
+  //FORENSIC_LOG(DEBUG) << "Experimental: got data for main frame";
 
     // Recursively walk the children.
     const FrameTree& frameTree = frame->tree();
@@ -223,13 +223,108 @@ std::vector<WebData> WebFrameSerializer::generateMHTMLPartsForAllFrames(
         return_data.push_back(generateMHTMLPartsForAFrame(boundary,
                     curLocalChild, useBinaryEncoding, webDelegate));
 
-  //log_stream << "Experimental: got data for another frame";
-  //Logger::LogLineScreen(log_stream.str(), true);
-  //log_stream.str("");
+  //FORENSIC_LOG(DEBUG) << "Experimental: got data for another frame";
     }
     return return_data;
 }
 
+std::vector<WebFrameSerializer::MHTMLResource> WebFrameSerializer::serializeAllFramesForMHTML(
+    WebLocalFrame* webFrame, MHTMLPartsGenerationDelegate* webDelegate)
+{
+    ASSERT(webFrame);
+    ASSERT(webDelegate);
+
+    Vector<SerializedResource> resources;
+    MHTMLFrameSerializerDelegate coreDelegate(*webDelegate);
+
+    // Same traversal as generateMHTMLPartsForAllFrames: the main frame and
+    // its direct local children.
+    // The frame is the first resource of each serializeFrame() call.
+    Vector<size_t> frameIndexes;
+    LocalFrame* frame = toWebLocalFrameImpl(webFrame)->frame();
+    frameIndexes.append(resources.size());
+    FrameSerializer(resources, coreDelegate).serializeFrame(*frame);
+    for (Frame* curChild = frame->tree().firstChild(); curChild; curChild = curChild->tree().nextSibling()) {
+        if (!curChild->isLocalFrame())
+            continue;
+        frameIndexes.append(resources.size());
+        FrameSerializer(resources, coreDelegate).serializeFrame(*toLocalFrame(curChild));
+    }
+
+    std::vector<MHTMLResource> result(resources.size());
+    for (size_t frameIndex : frameIndexes) {
+        if (frameIndex < result.size())
+            result[frameIndex].isFrame = true;
+    }
+    for (size_t i = 0; i < resources.size(); ++i) {
+        const SerializedResource& resource = resources[i];
+        // about: URLs do not get a Content-Location header.
+        if (!resource.url.protocolIsAbout())
+            result[i].url = resource.url.string().utf8().data();
+        result[i].mimeType = resource.mimeType.utf8().data();
+        if (resource.data) {
+            RefPtr<SharedBuffer> data = resource.data;
+            result[i].data.reserve(data->size());
+            const char* segment;
+            size_t position = 0;
+            while (size_t length = data->getSomeData(segment, position)) {
+                result[i].data.insert(result[i].data.end(), segment, segment + length);
+                position += length;
+            }
+        }
+    }
+    return result;
+}
+
+void WebFrameSerializer::generateMHTMLPart(
+    const std::string& boundary, const MHTMLResource& resource,
+    bool useBinaryEncoding, std::string* output)
+{
+    ASSERT(output);
+
+    // Mirrors MHTMLArchive::generateMHTMLPart, but only touches std:: types
+    // and the thread-agnostic WTF encoders.
+    const char* contentEncoding = "binary";
+    if (!useBinaryEncoding)
+        contentEncoding = resource.mimeType.compare(0, 5, "text/") ? "base64" : "quoted-printable";
+
+    output->append("--").append(boundary).append("\r\n");
+    output->append("Content-Type: ").append(resource.mimeType).append("\r\n");
+    output->append("Content-Transfer-Encoding: ").append(contentEncoding).append("\r\n");
+    if (!resource.url.empty())
+        output->append("Content-Location: ").append(resource.url).append("\r\n");
+    output->append("\r\n");
+
+    if (useBinaryEncoding) {
+        output->append(resource.data.begin(), resource.data.end());
+        output->append("\r\n");
+        return;
+    }
+
+    Vector<char> encodedData;
+    if (!strcmp(contentEncoding, "base64"))
+        base64Encode(resource.data.data(), resource.data.size(), encodedData, InsertLFs);
+    else
+        quotedPrintableEncode(resource.data.data(), resource.data.size(), encodedData);
+    output->append(encodedData.data(), encodedData.size());
+    output->append("\r\n");
+}
+
+void WebFrameSerializer::generateMHTMLResourceReference(
+    const std::string& boundary, const MHTMLResource& resource,
+    const std::string& digest, std::string* output)
+{
+    ASSERT(output);
+
+    output->append("--").append(boundary).append("\r\n");
+    output->append("Content-Type: ").append(resource.mimeType).append("\r\n");
+    output->append("Content-Transfer-Encoding: binary\r\n");
+    if (!resource.url.empty())
+        output->append("Content-Location: ").append(resource.url).append("\r\n");
+    output->append("X-ChromePic-Resource-Digest: ").append(digest).append("\r\n");
+    output->append("\r\n\r\n");
+}
+
 //ChromePic
 WebData WebFrameSerializer::generateMHTMLParts(
     const WebString& boundary, WebLocalFrame* webFrame, bool useBinaryEncoding,
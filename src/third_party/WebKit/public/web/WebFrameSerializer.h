@@ -41,6 +41,7 @@
 #include <utility>
 
 //ChromePic
+#include <string>
 #include <vector> 
 //ChromePic
 
@@ -85,6 +86,37 @@ public:
     BLINK_EXPORT static std::vector<WebData> generateMHTMLPartsForAllFrames(
         const WebString& boundary, WebLocalFrame*, bool useBinaryEncoding,
         MHTMLPartsGenerationDelegate*);
+
+    // A frame or subresource captured by serializeAllFramesForMHTML. It owns
+    // plain copies of the serialized data so that it can be handed to
+    // another thread once the main thread is done with the DOM.
+    struct MHTMLResource {
+        MHTMLResource() : isFrame(false) { }
+
+        std::string url;
+        std::string mimeType;
+        std::vector<char> data;
+        // True for the document of a frame, false for its subresources.
+        bool isFrame;
+    };
+
+    // First (main thread) half of generateMHTMLPartsForAllFrames: walks the
+    // frame tree and copies out the serialized frames and subresources,
+    // without doing any MIME encoding.
+    BLINK_EXPORT static std::vector<MHTMLResource> serializeAllFramesForMHTML(
+        WebLocalFrame*, MHTMLPartsGenerationDelegate*);
+
+    // Second half: encodes |resource| as an MHTML part and appends it to
+    // |output|. Uses no DOM or Blink heap state, so it may run on any thread.
+    BLINK_EXPORT static void generateMHTMLPart(
+        const std::string& boundary, const MHTMLResource&,
+        bool useBinaryEncoding, std::string* output);
+
+    // Like generateMHTMLPart, but the part carries no body and instead names
+    // the content-addressed store entry holding |resource|'s data.
+    BLINK_EXPORT static void generateMHTMLResourceReference(
+        const std::string& boundary, const MHTMLResource&,
+        const std::string& digest, std::string* output);
     // ChromePic
 
 
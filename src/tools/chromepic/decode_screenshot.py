@@ -0,0 +1,108 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 University of Georgia. All rights reserved.
+#
+# This file is subject to the terms and conditions defined at
+# https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+#
+
+"""Rebuilds the full frame of a ChromePic screenshot as a PNG.
+
+A screenshot snapshot_N in a tab's snapshots directory is stored as one of:
+  snapshot_N.png / .webp   a full frame
+  snapshot_N.raw           a full frame, --screenshot-format=raw or
+                           --screenshot-pixel-format=i420
+  snapshot_N.ref           a duplicate; names the snapshot it is equal to
+  snapshot_N.tiles         the 64x64 tiles that changed since the screenshot
+                           it names (--enable-tile-diff-screenshots)
+References and tile deltas are followed back to the last full frame.
+Needs PIL (Pillow), and python-snappy for raw screenshots.
+
+Usage: decode_screenshot.py <snapshots directory> <N> <output.png>
+"""
+
+import io
+import os
+import sys
+
+from PIL import Image
+
+EXTENSIONS = ('.tiles', '.ref', '.png', '.webp', '.raw')
+
+
+def LoadImage(data):
+  """Decodes a full frame or a tile strip in any screenshot format."""
+  if data.startswith(b'CHROMEPIC-RAW '):
+    import snappy
+    header, _, compressed = data.partition(b'\n')
+    _, order, width, height, row_bytes = header.split()
+    width, height, row_bytes = int(width), int(height), int(row_bytes)
+    pixels = snappy.decompress(compressed)
+    if order == b'I420':
+      # --screenshot-pixel-format=i420. PIL's YCbCr is full range while the
+      # GPU writes BT.601 studio range, so colors come out slightly flat.
+      y_size, uv_size = width * height, (width // 2) * (height // 2)
+      planes = [Image.frombytes('L', (width, height), pixels[:y_size])]
+      for offset in (y_size, y_size + uv_size):
+        planes.append(Image.frombytes('L', (width // 2, height // 2),
+                                      pixels[offset:offset + uv_size])
+                      .resize((width, height)))
+      return Image.merge('YCbCr', planes).convert('RGBA')
+    return Image.frombuffer('RGBA', (width, height), pixels, 'raw',
+                            order.decode(), row_bytes, 1)
+  return Image.open(io.BytesIO(data)).convert('RGBA')
+
+
+def Decode(directory, name, seen=None):
+  seen = seen or set()
+  if name in seen:
+    raise ValueError('Reference loop at ' + name)
+  seen.add(name)
+
+  for extension in EXTENSIONS:
+    path = os.path.join(directory, name + extension)
+    if os.path.exists(path):
+      break
+  else:
+    raise IOError('No screenshot file for ' + name)
+  with open(path, 'rb') as f:
+    data = f.read()
+
+  if extension == '.ref':
+    return Decode(directory, data.strip().decode(), seen)
+  if extension != '.tiles':
+    return LoadImage(data)
+
+  header, _, strip_data = data.partition(b'\n\n')
+  lines = header.split(b'\n')
+  magic, previous = lines[0].split()
+  if magic != b'CHROMEPIC-TILES':
+    raise ValueError('Not a tile delta: ' + path)
+  width, height, tile_size = [int(value) for value in lines[1].split()]
+  tiles = [int(index) for index in lines[2].split()] if len(lines) > 2 else []
+
+  frame = Decode(directory, previous.decode(), seen).copy()
+  if frame.size != (width, height):
+    raise ValueError('Frame size changed within a tile delta: ' + path)
+  if tiles:
+    strip = LoadImage(strip_data)
+    tiles_x = (width + tile_size - 1) // tile_size
+    for i, index in enumerate(tiles):
+      x = (index % tiles_x) * tile_size
+      y = (index // tiles_x) * tile_size
+      tile = strip.crop((0, i * tile_size, min(tile_size, width - x),
+                         i * tile_size + min(tile_size, height - y)))
+      frame.paste(tile, (x, y))
+  return frame
+
+
+def main(argv):
+  if len(argv) != 4:
+    sys.stderr.write(__doc__)
+    return 1
+  Decode(argv[1], 'snapshot_' + argv[2]).save(argv[3], 'PNG')
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
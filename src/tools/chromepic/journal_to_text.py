@@ -0,0 +1,100 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 University of Georgia. All rights reserved.
+#
+# This file is subject to the terms and conditions defined at
+# https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+#
+
+"""Converts ChromePic event journals (snapshot_logs/journal_*.bin) to text.
+
+A journal starts with "CHROMEPIC-JOURNAL\\n", then version, record size,
+process ID and stage count as uint32s, then the NUL-terminated stage names.
+The rest is chunks of one thread's records: uint32 thread ID, uint32 count,
+then |count| 48 byte records (see content/browser/renderer_host/snapshot/
+event_journal.h).
+
+Records of all the given journals are merged in time order. Most stages only
+know the trace ID of their event; the site and URL IDs are filled in from
+SnapshotHandler's records of the same trace ID, so pass the browser journal
+along to get complete event IDs.
+
+Usage: journal_to_text.py <journal.bin> [<journal.bin> ...] > journal.txt
+"""
+
+import struct
+import sys
+
+MAGIC = b'CHROMEPIC-JOURNAL\n'
+HEADER = struct.Struct('<IIII')
+CHUNK = struct.Struct('<II')
+# time, site_id, trace_id, url_id, snapshot_id, arg0, arg1, stage, event_type,
+# reserved.
+RECORD = struct.Struct('<qqqiiiiHhI')
+
+
+def ReadJournal(path):
+  with open(path, 'rb') as f:
+    data = f.read()
+  if not data.startswith(MAGIC):
+    raise ValueError('%s is not a ChromePic journal' % path)
+  offset = len(MAGIC)
+  version, record_size, pid, stage_count = HEADER.unpack_from(data, offset)
+  if version != 1 or record_size != RECORD.size:
+    raise ValueError('%s: unsupported journal version %d' % (path, version))
+  offset += HEADER.size
+  stages = []
+  for _ in range(stage_count):
+    end = data.index(b'\0', offset)
+    stages.append(data[offset:end].decode('utf-8'))
+    offset = end + 1
+
+  records = []
+  while offset + CHUNK.size <= len(data):
+    thread_id, count = CHUNK.unpack_from(data, offset)
+    offset += CHUNK.size
+    # A journal cut short by a crash ends in a partial chunk.
+    count = min(count, (len(data) - offset) // RECORD.size)
+    for _ in range(count):
+      records.append((pid, thread_id, stages, RECORD.unpack_from(data, offset)))
+      offset += RECORD.size
+  return records
+
+
+def FormatRecord(pid, thread_id, stages, record, event_ids):
+  (time, site_id, trace_id, url_id, snapshot_id, arg0, arg1, stage,
+   event_type, _) = record
+  name = stages[stage] if stage < len(stages) else 'Unknown Stage %d' % stage
+  if not site_id and trace_id in event_ids:
+    site_id, known_url_id = event_ids[trace_id]
+    if url_id == -1:
+      url_id = known_url_id
+  site = '0x%x' % site_id if site_id else '?'
+  return ('%s, Process ID: %d, Thread ID: %d, Event ID: %s_%d_%d, '
+          'Snapshot ID: %d, Event Type: %d, Args: %d, %d,\tTime: %d' %
+          (name, pid, thread_id, site, url_id, trace_id, snapshot_id,
+           event_type, arg0, arg1, time))
+
+
+def main(argv):
+  if len(argv) < 2:
+    sys.stderr.write(__doc__)
+    return 1
+  records = []
+  for path in argv[1:]:
+    records.extend(ReadJournal(path))
+  # Time is the first field of a record; the sort is stable so records with
+  # the same timestamp keep their per-thread order.
+  records.sort(key=lambda r: r[3][0])
+  event_ids = {}
+  for _, _, _, record in records:
+    if record[1] and record[2] != -1 and record[3] != -1:
+      event_ids.setdefault(record[2], (record[1], record[3]))
+  for pid, thread_id, stages, record in records:
+    sys.stdout.write(FormatRecord(pid, thread_id, stages, record, event_ids))
+    sys.stdout.write('\n')
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 University of Georgia. All rights reserved.
+#
+# This file is subject to the terms and conditions defined at
+# https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+#
+
+"""Rebuilds a self-contained MHTML file from a ChromePic DOM snapshot.
+
+Delta snapshots (--enable-delta-dom-snapshots) start with an
+X-ChromePic-Delta-Base header naming the full snapshot of the same page they
+were diffed against, in the same directory. Their first part is a manifest
+listing every part of the full snapshot in order, each taken either from the
+base ("base") or from the delta file itself ("delta").
+
+With --enable-dom-snapshot-resource-store, subresource parts have no body and
+an X-ChromePic-Resource-Digest header instead; the body is the file of that
+name in the session's resource store directory.
+
+Usage: reconstruct_dom_snapshot.py <snapshot_N.mhtml> <output.mhtml>
+                                   [<resource store directory>]
+"""
+
+import os
+import re
+import sys
+
+DELTA_HEADER = b'X-ChromePic-Delta-Base: '
+MANIFEST_MIME_TYPE = b'text/x-chromepic-delta-manifest'
+DIGEST_HEADER_RE = re.compile(br'^X-ChromePic-Resource-Digest: ([0-9a-f]+)\r$', re.M)
+
+
+def SplitMHTML(data):
+  """Returns (header, boundary, [(key, mime_type, part_bytes)])."""
+  match = re.search(br'boundary="([^"]+)"', data)
+  if not match:
+    raise ValueError('No MIME boundary found')
+  boundary = match.group(1)
+  delimiter = b'--' + boundary + b'\r\n'
+  chunks = data.split(delimiter)
+  header = chunks[0]
+  parts = []
+  unnamed_parts = 0
+  for chunk in chunks[1:]:
+    part_header = chunk.split(b'\r\n\r\n', 1)[0]
+    location = re.search(br'^Content-Location: (.*)$', part_header, re.M)
+    mime_type = re.search(br'^Content-Type: (.*)$', part_header, re.M)
+    mime_type = mime_type.group(1).strip() if mime_type else b''
+    if location:
+      key = location.group(1).strip()
+    elif mime_type == MANIFEST_MIME_TYPE:
+      key = None
+    else:
+      # Must match GetPartKey() in content/renderer/snapshot.
+      key = b'#' + str(unnamed_parts).encode()
+      unnamed_parts += 1
+    parts.append((key, mime_type, delimiter + chunk))
+  return header, boundary, parts
+
+
+def ResolveResources(data, resource_dir):
+  """Fills in the bodies of parts that reference the resource store."""
+  if not resource_dir:
+    return data
+  header, _, parts = SplitMHTML(data)
+  output = [header]
+  for _, _, part in parts:
+    match = DIGEST_HEADER_RE.search(part.split(b'\r\n\r\n', 1)[0] + b'\r')
+    if match:
+      with open(os.path.join(resource_dir, match.group(1).decode()), 'rb') as f:
+        part = part.split(b'\r\n\r\n', 1)[0] + b'\r\n\r\n' + f.read() + b'\r\n'
+    output.append(part)
+  return b''.join(output)
+
+
+def Reconstruct(delta_path):
+  with open(delta_path, 'rb') as f:
+    data = f.read()
+  if not data.startswith(DELTA_HEADER):
+    return data  # Already a full snapshot.
+
+  base_line, data = data.split(b'\r\n', 1)
+  base_name = base_line[len(DELTA_HEADER):].strip().decode()
+  base_path = os.path.join(os.path.dirname(delta_path), base_name)
+  with open(base_path, 'rb') as f:
+    _, _, base_parts = SplitMHTML(f.read())
+  header, _, delta_parts = SplitMHTML(data)
+
+  manifest = delta_parts[0][2].split(b'\r\n\r\n', 1)[1]
+  base_by_key = dict((key, part) for key, _, part in base_parts)
+  delta_by_key = dict((key, part) for key, _, part in delta_parts[1:])
+
+  output = [header]
+  for line in manifest.splitlines():
+    if not line.strip():
+      continue
+    source, key = line.split(b'\t', 1)
+    parts = base_by_key if source == b'base' else delta_by_key
+    if key not in parts:
+      sys.stderr.write('Missing %s part: %s\n' % (source.decode(), key.decode()))
+      continue
+    output.append(parts[key])
+  return b''.join(output)
+
+
+def main(argv):
+  if len(argv) not in (3, 4):
+    sys.stderr.write(__doc__)
+    return 1
+  resource_dir = argv[3] if len(argv) == 4 else None
+  with open(argv[2], 'wb') as f:
+    f.write(ResolveResources(Reconstruct(argv[1]), resource_dir))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 University of Georgia. All rights reserved.
+#
+# This file is subject to the terms and conditions defined at
+# https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+#
+
+"""Reads ChromePic snapshot archives (--enable-snapshot-archive).
+
+An archive is a directory snapshots/archive_<time>_<pid> of segments:
+  segment_N.cpa   "CHROMEPIC-ARCHIVE\\n" padded to 24 bytes, then version and
+                  record header size as uint32s, then the records
+  segment_N.idx   "CHROMEPIC-INDEX\\n" padded likewise, then version and entry
+                  size, then one entry per record of segment_N.cpa
+A record is a 32 byte header (see content/browser/renderer_host/snapshot/
+snapshot_archive.h), the tab (its output directory name), the record name,
+the event ID and the payload, padded to 8 bytes. Screenshot records are
+named like the files they replace, so exporting an archive gives the usual
+snapshots/<tab>/snapshot_N.* layout that decode_screenshot.py reads.
+
+Segments are mapped, not read: payloads are slices of the mapping and only
+the pages of the records looked at are loaded. The index is written after
+its records, so a segment whose index is short (after a crash) is scanned
+from the last indexed record on.
+
+Usage:
+  snapshot_archive.py list <archive directory>
+  snapshot_archive.py extract <archive directory> <tab> <name> <output file>
+  snapshot_archive.py export <archive directory> <output directory>
+"""
+
+import collections
+import glob
+import mmap
+import os
+import re
+import struct
+import sys
+
+SEGMENT_MAGIC = b'CHROMEPIC-ARCHIVE\n'
+INDEX_MAGIC = b'CHROMEPIC-INDEX\n'
+# magic, version, entry size.
+FILE_HEADER = struct.Struct('<24sII')
+# magic, type, tab length, snapshot ID, name length, event ID length, time,
+# payload length, reserved.
+RECORD_HEADER = struct.Struct('<IHHiHHqII')
+# offset, length, type, reserved, snapshot ID, event ID hash.
+INDEX_ENTRY = struct.Struct('<QIHHiI')
+RECORD_MAGIC = 0x52415043
+
+RECORD_TYPES = ('screenshot', 'dom_snapshot', 'metadata')
+
+Record = collections.namedtuple(
+    'Record', 'type tab name snapshot_id event_id time payload segment offset')
+
+
+def _CheckFileHeader(data, magic, entry_size, path):
+  if len(data) < FILE_HEADER.size:
+    raise ValueError('%s is too short' % path)
+  file_magic, version, file_entry_size = FILE_HEADER.unpack_from(data, 0)
+  if file_magic.rstrip(b'\0') != magic or version != 1 or \
+      file_entry_size != entry_size:
+    raise ValueError('%s is not a version 1 ChromePic archive file' % path)
+
+
+def _Map(path):
+  with open(path, 'rb') as f:
+    if not os.fstat(f.fileno()).st_size:
+      return b''
+    return mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+
+class Segment(object):
+  def __init__(self, path):
+    self.path = path
+    self.number = int(re.search(r'segment_(\d+)\.cpa$', path).group(1))
+    self.data = _Map(path)
+    _CheckFileHeader(self.data, SEGMENT_MAGIC, RECORD_HEADER.size, path)
+    self.offsets = self._LoadIndex(path[:-len('.cpa')] + '.idx')
+
+  def _LoadIndex(self, path):
+    offsets = []
+    end = FILE_HEADER.size
+    if os.path.exists(path):
+      index = _Map(path)
+      if len(index) >= FILE_HEADER.size:
+        _CheckFileHeader(index, INDEX_MAGIC, INDEX_ENTRY.size, path)
+        for position in range(FILE_HEADER.size,
+                              len(index) - INDEX_ENTRY.size + 1,
+                              INDEX_ENTRY.size):
+          offset, length = INDEX_ENTRY.unpack_from(index, position)[:2]
+          if offset + length > len(self.data):
+            break
+          offsets.append(offset)
+          end = offset + length
+    # Records written after the last index entry.
+    while end + RECORD_HEADER.size <= len(self.data):
+      length = self._RecordLength(end)
+      if not length:
+        break
+      offsets.append(end)
+      end += length
+    return offsets
+
+  def _RecordLength(self, offset):
+    header = RECORD_HEADER.unpack_from(self.data, offset)
+    magic, _, tab_length, _, name_length, event_id_length, _, \
+        payload_length, _ = header
+    if magic != RECORD_MAGIC:
+      return 0
+    length = (RECORD_HEADER.size + tab_length + name_length + event_id_length +
+              payload_length + 7) & ~7
+    return length if offset + length <= len(self.data) else 0
+
+  def Read(self, offset):
+    (_, record_type, tab_length, snapshot_id, name_length, event_id_length,
+     time, payload_length, _) = RECORD_HEADER.unpack_from(self.data, offset)
+    position = offset + RECORD_HEADER.size
+    strings = []
+    for length in (tab_length, name_length, event_id_length):
+      strings.append(self.data[position:position + length].decode('utf-8'))
+      position += length
+    payload = memoryview(self.data)[position:position + payload_length] \
+        if payload_length else b''
+    type_name = RECORD_TYPES[record_type] \
+        if record_type < len(RECORD_TYPES) else str(record_type)
+    return Record(type_name, strings[0], strings[1], snapshot_id, strings[2],
+                  time, payload, self.number, offset)
+
+
+class SnapshotArchive(object):
+  """Random access to the records of an archive directory."""
+
+  def __init__(self, directory):
+    paths = glob.glob(os.path.join(directory, 'segment_*.cpa'))
+    self.segments = sorted((Segment(path) for path in paths),
+                           key=lambda segment: segment.number)
+    self._by_name = {}
+    self._by_snapshot = collections.defaultdict(list)
+    self._by_event = collections.defaultdict(list)
+    for segment in self.segments:
+      for offset in segment.offsets:
+        record = segment.Read(offset)
+        key = (segment, offset)
+        # A name seen twice (a rewritten file) resolves to the latest record.
+        self._by_name[(record.tab, record.name)] = key
+        self._by_snapshot[(record.tab, record.snapshot_id)].append(key)
+        if record.event_id:
+          self._by_event[record.event_id].append(key)
+
+  def Records(self):
+    for segment in self.segments:
+      for offset in segment.offsets:
+        yield segment.Read(offset)
+
+  def Find(self, tab, name):
+    key = self._by_name.get((tab, name))
+    return key[0].Read(key[1]) if key else None
+
+  def FindSnapshot(self, tab, snapshot_id):
+    return [segment.Read(offset)
+            for segment, offset in self._by_snapshot.get((tab, snapshot_id), [])]
+
+  def FindEvent(self, event_id):
+    return [segment.Read(offset)
+            for segment, offset in self._by_event.get(event_id, [])]
+
+
+def main(argv):
+  if len(argv) < 3 or argv[1] not in ('list', 'extract', 'export'):
+    sys.stderr.write(__doc__)
+    return 1
+  archive = SnapshotArchive(argv[2])
+
+  if argv[1] == 'list' and len(argv) == 3:
+    for record in archive.Records():
+      sys.stdout.write('%s, Tab: %s, Name: %s, Snapshot ID: %d, Event ID: %s, '
+                       'Bytes: %d, Segment: %d, Offset: %d,\tTime: %d\n' %
+                       (record.type, record.tab, record.name,
+                        record.snapshot_id, record.event_id,
+                        len(record.payload), record.segment, record.offset,
+                        record.time))
+    return 0
+
+  if argv[1] == 'extract' and len(argv) == 6:
+    record = archive.Find(argv[3], argv[4])
+    if not record:
+      sys.stderr.write('No record %s in tab %s\n' % (argv[4], argv[3]))
+      return 1
+    with open(argv[5], 'wb') as f:
+      f.write(record.payload)
+    return 0
+
+  if argv[1] == 'export' and len(argv) == 4:
+    for record in archive.Records():
+      if record.type != 'screenshot':
+        continue
+      directory = os.path.join(argv[3], record.tab)
+      if not os.path.isdir(directory):
+        os.makedirs(directory)
+      with open(os.path.join(directory, record.name), 'wb') as f:
+        f.write(record.payload)
+    return 0
+
+  sys.stderr.write(__doc__)
+  return 1
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,184 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 University of Georgia. All rights reserved.
+#
+# This file is subject to the terms and conditions defined at
+# https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+#
+
+"""Breaks the latency of ChromePic snapshots down by pipeline stage.
+
+Reads the event journals of a session (snapshot_logs/journal_*.bin, browser
+and renderers), rebuilds one timeline per snapshot from the records that
+carry its site ID and snapshot ID, and prints p50/p95/p99 and a log2
+histogram of each segment of the timeline, in microseconds.
+
+All processes stamp records with TimeTicks, which is the same monotonic clock
+across processes on Linux and Android, so segments that cross a process
+boundary are meaningful there.
+
+Usage: snapshot_latency.py [--timelines] <journal.bin> [<journal.bin> ...]
+  --timelines  also print every snapshot's timeline
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import journal_to_text  # pylint: disable=wrong-import-position
+
+# Stage names as written by content/browser/renderer_host/snapshot/
+# event_journal.cc.
+STAGES = {
+    'SnapshotHandler:: Snapshot Event': 'event',
+    'SnapshotHandler:: Screenshot Request': 'request',
+    'View:: Screenshot Copy Request': 'copy_request',
+    'DelegatedFrameHost:: Screenshot Copy Result': 'copy_result',
+    'SnapshotHandler:: Screenshot Captured': 'captured',
+    'OutputSurface:: Screenshot Ack Sent': 'ack',
+    'ScreenshotEncoderPool:: Screenshot Written': 'written',
+    'RenderWidget:: Input Event Received': 'renderer_received',
+    'RenderWidget:: Input Event Held': 'held',
+    'RenderWidget:: Input Event Released': 'released',
+    'RenderWidget:: Handing input to the input handling code': 'dispatch',
+    'RenderWidget:: DOM Snapshot Copied': 'dom_copied',
+    'SnapshotHandler:: DOM Snapshot Captured': 'dom_captured',
+}
+
+# Segments between two stages of a timeline: (name, from, to).
+INTERVALS = [
+    ('Event -> screenshot request', 'event', 'request'),
+    ('Request -> copy request', 'request', 'copy_request'),
+    ('Draw and copy (GLRenderer)', 'copy_request', 'copy_result'),
+    ('Readback (GLHelper)', 'copy_result', 'captured'),
+    ('Event -> screenshot captured', 'event', 'captured'),
+    ('Event -> optimized ack', 'event', 'ack'),
+    ('Event -> renderer received', 'event', 'renderer_received'),
+    ('Renderer received -> dispatch', 'renderer_received', 'dispatch'),
+    ('Event -> DOM snapshot captured', 'event', 'dom_captured'),
+    ('Event -> screenshot written', 'event', 'written'),
+]
+
+# Durations measured by a single record: (name, stage, argument index).
+DURATIONS = [
+    ('Input hold', 'released', 0),
+    ('DOM snapshot copy (main thread)', 'dom_copied', 0),
+    ('Screenshot encode', 'written', 0),
+    ('Screenshot write', 'written', 1),
+]
+
+
+class Timeline(object):
+
+  def __init__(self):
+    self.times = {}
+    self.args = {}
+
+  def Add(self, stage, time, args):
+    # The first record of a stage wins, e.g. the first attempt to hold.
+    if stage not in self.times:
+      self.times[stage] = time
+      self.args[stage] = args
+
+  def Interval(self, begin, end):
+    if begin in self.times and end in self.times:
+      return self.times[end] - self.times[begin]
+    return None
+
+  def Duration(self, stage, index):
+    if stage not in self.args:
+      return None
+    value = self.args[stage][index]
+    return value if value >= 0 else None
+
+
+def BuildTimelines(records):
+  # Renderer records only know the trace ID of non-snapshot events, and some
+  # browser records only the site and snapshot IDs.
+  sites = {}
+  for _, _, _, record in records:
+    site_id, trace_id = record[1], record[2]
+    if site_id and trace_id != -1:
+      sites.setdefault(trace_id, site_id)
+
+  timelines = {}
+  for _, _, stages, record in records:
+    (time, site_id, trace_id, _, snapshot_id, arg0, arg1, stage,
+     _, _) = record
+    if snapshot_id == -1 or stage >= len(stages):
+      continue
+    name = STAGES.get(stages[stage])
+    if not name:
+      continue
+    site_id = site_id or sites.get(trace_id)
+    if not site_id:
+      continue
+    key = (site_id, snapshot_id)
+    timelines.setdefault(key, Timeline()).Add(name, time, (arg0, arg1))
+  return timelines
+
+
+def Percentile(sorted_values, fraction):
+  index = int(round(fraction * (len(sorted_values) - 1)))
+  return sorted_values[index]
+
+
+def Histogram(sorted_values):
+  buckets = {}
+  for value in sorted_values:
+    bucket = max(value, 1).bit_length() - 1
+    buckets[bucket] = buckets.get(bucket, 0) + 1
+  return ' '.join('<%d:%d' % (2 ** (bucket + 1), count)
+                  for bucket, count in sorted(buckets.items()))
+
+
+def PrintSummary(name, values):
+  if not values:
+    return
+  values.sort()
+  sys.stdout.write('%-36s %6d %10d %10d %10d %10d   %s\n' % (
+      name, len(values), Percentile(values, 0.5), Percentile(values, 0.95),
+      Percentile(values, 0.99), values[-1], Histogram(values)))
+
+
+def PrintTimeline(key, timeline):
+  site_id, snapshot_id = key
+  begin = timeline.times.get('event', min(timeline.times.values()))
+  stages = sorted(timeline.times.items(), key=lambda item: item[1])
+  sys.stdout.write('Site ID: 0x%x, Snapshot ID: %d, %s\n' % (
+      site_id, snapshot_id,
+      ', '.join('%s: +%d' % (stage, time - begin) for stage, time in stages)))
+
+
+def main(argv):
+  args = argv[1:]
+  print_timelines = '--timelines' in args
+  paths = [arg for arg in args if arg != '--timelines']
+  if not paths:
+    sys.stderr.write(__doc__)
+    return 1
+  records = []
+  for path in paths:
+    records.extend(journal_to_text.ReadJournal(path))
+  records.sort(key=lambda r: r[3][0])
+  timelines = BuildTimelines(records)
+
+  if print_timelines:
+    for key in sorted(timelines):
+      PrintTimeline(key, timelines[key])
+    sys.stdout.write('\n')
+
+  sys.stdout.write('%d snapshots, times in us\n' % len(timelines))
+  sys.stdout.write('%-36s %6s %10s %10s %10s %10s   %s\n' % (
+      'Segment', 'Count', 'p50', 'p95', 'p99', 'Max', 'Histogram'))
+  for name, begin, end in INTERVALS:
+    values = [t.Interval(begin, end) for t in timelines.values()]
+    PrintSummary(name, [v for v in values if v is not None and v >= 0])
+  for name, stage, index in DURATIONS:
+    values = [t.Duration(stage, index) for t in timelines.values()]
+    PrintSummary(name, [v for v in values if v is not None])
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 University of Georgia. All rights reserved.
+#
+# This file is subject to the terms and conditions defined at
+# https://raw.githubusercontent.com/chromepic/chromepic-browser/master/LICENSE.txt
+#
+
+"""Converts a raw screenshot (--screenshot-format=raw) to PNG.
+
+A raw screenshot is a line "CHROMEPIC-RAW <BGRA|RGBA> <width> <height>
+<row bytes>\\n" followed by the snappy compressed pixel rows. Needs the
+python-snappy module.
+
+Usage: transcode_screenshot.py <snapshot_N.raw> <output.png>
+"""
+
+import struct
+import sys
+import zlib
+
+import snappy
+
+
+def PNGChunk(chunk_type, data):
+  chunk = chunk_type + data
+  return (struct.pack('>I', len(data)) + chunk +
+          struct.pack('>I', zlib.crc32(chunk) & 0xffffffff))
+
+
+def Transcode(data):
+  header, _, compressed = data.partition(b'\n')
+  magic, order, width, height, row_bytes = header.split()
+  if magic != b'CHROMEPIC-RAW':
+    raise ValueError('Not a raw ChromePic screenshot')
+  if order == b'I420':
+    raise ValueError('I420 screenshot, use decode_screenshot.py instead')
+  width, height, row_bytes = int(width), int(height), int(row_bytes)
+  pixels = snappy.decompress(compressed)
+
+  rows = []
+  for y in range(height):
+    row = bytearray(pixels[y * row_bytes:y * row_bytes + width * 4])
+    if order == b'BGRA':
+      row[0::4], row[2::4] = row[2::4], row[0::4]
+    rows.append(b'\x00' + bytes(row))  # Filter type None.
+
+  return (b'\x89PNG\r\n\x1a\n' +
+          PNGChunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 6, 0, 0, 0)) +
+          PNGChunk(b'IDAT', zlib.compress(b''.join(rows))) +
+          PNGChunk(b'IEND', b''))
+
+
+def main(argv):
+  if len(argv) != 3:
+    sys.stderr.write(__doc__)
+    return 1
+  with open(argv[1], 'rb') as f:
+    data = f.read()
+  with open(argv[2], 'wb') as f:
+    f.write(Transcode(data))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -13,6 +13,10 @@
 #include "build/build_config.h"
 #include "ui/gfx/gfx_export.h"
 
+//ChromePic
+#include "base/debug/snapshot_token.h"
+//ChromePic
+
 #if defined(OS_WIN)
 typedef struct tagSIZE SIZE;
 #elif defined(OS_MACOSX)
@@ -25,9 +29,9 @@ namespace gfx {
 class GFX_EXPORT Size {
  public:
   //ChromePic
-  Size() :  process_id(-1), routing_id(-1), snapshot_id(-1), width_(0), height_(0) {}
+  Size() :  process_id(-1), routing_id(-1), snapshot_id(-1), snapshot_scale(1.f), snapshot_i420(false), width_(0), height_(0) {}
   Size(int width, int height)
-      :process_id(-1), routing_id(-1), snapshot_id(-1), width_(width < 0 ? 0 : width), height_(height < 0 ? 0 : height) {}
+      :process_id(-1), routing_id(-1), snapshot_id(-1), snapshot_scale(1.f), snapshot_i420(false), width_(width < 0 ? 0 : width), height_(height < 0 ? 0 : height) {}
   //ChromePic
 #if defined(OS_MACOSX)
   explicit Size(const CGSize& s);
@@ -74,7 +78,11 @@ class GFX_EXPORT Size {
   int process_id;
   int routing_id;
   int snapshot_id;
-  std::string event_id;
+  base::debug::SnapshotToken event_id;
+  // Scale the snapshot readback to this fraction of the surface size on the
+  // GPU, and read it back as I420 planes instead of BGRA.
+  float snapshot_scale;
+  bool snapshot_i420;
   //ChromePic
 
  private: